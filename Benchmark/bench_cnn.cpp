@@ -0,0 +1,672 @@
+/*
+// Style network benchmarks: model compilation and per-frame inference
+*/
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include "opencv2/core/ocl.hpp"
+#include "opencv2/imgproc.hpp"
+#include "openvino/openvino.hpp"
+
+#include "batch_coalescer.hpp"
+#include "child_process.hpp"
+#include "cnn.hpp"
+#include "edf_scheduler.hpp"
+#include "flow_pipeline.hpp"
+#include "hot_model.hpp"
+#include "inference_client.hpp"
+#include "inference_server.hpp"
+#include "model_loader.hpp"
+#include "pipeline.hpp"
+#include "segment_job.hpp"
+#include "tensor_binding.hpp"
+#include "thread_budget.hpp"
+
+namespace
+{
+
+// network input, as fed by Cnn::Init for host frames
+const cv::Size CNN_INPUT(640, 480);
+
+// Read the model and attach the host-frame preprocessing of Cnn (u8 NHWC RGB in, resize
+// and f32 conversion done by the runtime).
+std::shared_ptr<ov::Model> read_model(ov::Core& core, const std::string& path)
+{
+    return prepare_host_input(core.read_model(path), CNN_INPUT);
+}
+
+bool model_available(BenchContext& ctx)
+{
+    if (ctx.options().model.empty() || !std::ifstream(ctx.options().model).good())
+    {
+        ctx.skip("model not found: " + ctx.options().model);
+        return false;
+    }
+    return true;
+}
+
+void bench_compile(BenchContext& ctx)
+{
+    if (!model_available(ctx))
+        return;
+
+    ctx.measure([&]() {
+        ov::Core core;
+        ov::CompiledModel compiled = core.compile_model(read_model(core, ctx.options().model), ctx.options().device);
+        compiled.create_infer_request();
+    }, 3);
+}
+
+ov::CompiledModel compile(const BenchOptions& options, const ov::AnyMap& config = ov::AnyMap())
+{
+    ov::Core core;
+    return core.compile_model(read_model(core, options.model), options.device, config);
+}
+
+// with `pages` >= 0 the input and output tensors come from a HugePageArena asking for them
+void bench_infer(BenchContext& ctx, int pages)
+{
+    if (!model_available(ctx))
+        return;
+
+    SyntheticSource source(CNN_INPUT, FRAME_BGR, 8);
+    Frame frame;
+    source.read(frame);
+    cv::Mat rgba;
+    cv::cvtColor(frame.data, rgba, cv::COLOR_BGR2RGBA);
+
+    std::unique_ptr<HugePageArena> arena;
+    if (pages >= 0)
+    {
+        HugePageArena::Config config;
+        config.pages = (HugePageArena::Pages)pages;
+        arena.reset(new HugePageArena(config));
+    }
+
+    ov::CompiledModel compiled = compile(ctx.options());
+    HostNetwork cnn(compiled, CNN_INPUT, ctx.options().model, arena.get());
+    ctx.measure([&]() { cnn.infer(rgba); });
+}
+
+// OpenCV's OpenCL switch is process wide: set for a scope, restored after
+struct ScopedUseOpenCL
+{
+    explicit ScopedUseOpenCL(bool use) : previous(cv::ocl::useOpenCL()) { cv::ocl::setUseOpenCL(use); }
+    ~ScopedUseOpenCL() { cv::ocl::setUseOpenCL(previous); }
+
+    bool previous;
+};
+
+// 720p RGBA frames through a Cnn binding: host frames are resized and converted on the
+// CPU, OpenCL frames on the device without leaving it
+void bench_binding(BenchContext& ctx, bool opencl)
+{
+    if (!model_available(ctx))
+        return;
+    if (opencl && !cv::ocl::haveOpenCL())
+    {
+        ctx.skip("OpenCL is not available");
+        return;
+    }
+
+    SyntheticSource source(cv::Size(1280, 720), FRAME_BGR, 8);
+    Frame frame;
+    source.read(frame);
+    cv::Mat rgba;
+    cv::cvtColor(frame.data, rgba, cv::COLOR_BGR2RGBA);
+
+    Cnn cnn;
+    if (opencl)
+    {
+        ScopedUseOpenCL use_opencl(true);
+        cnn.Init(ctx.options().model, std::make_shared<OpenCLBinding>(CNN_INPUT));
+
+        cv::UMat urgba = rgba.getUMat(cv::ACCESS_READ);
+        ctx.measure([&]() {
+            cnn.binding<OpenCLBinding>().set_input(urgba);
+            cnn.Infer();
+        });
+    }
+    else
+    {
+        cnn.Init(ctx.options().model, std::make_shared<HostBinding>(ctx.options().device, CNN_INPUT));
+
+        ctx.measure([&]() {
+            cnn.binding<HostBinding>().set_input(rgba);
+            cnn.Infer();
+        });
+    }
+    ctx.metric("infer_ms", cnn.time_elapsed() / std::max<size_t>(cnn.ncalls(), 1));
+}
+
+void bench_pipeline_cnn(BenchContext& ctx)
+{
+    if (!model_available(ctx))
+        return;
+
+    ov::CompiledModel compiled = compile(ctx.options());
+    cv::Ptr<HostNetwork> cnn = cv::makePtr<HostNetwork>(compiled, CNN_INPUT, ctx.options().model);
+
+    FramePipeline::Config config;
+    FramePipeline pipeline(config, cv::makePtr<SyntheticSource>(SIZE_720P, FRAME_BGR, 8), cv::makePtr<NullSink>(),
+                           [cnn](const cv::Mat& rgba, cv::Mat&) { cnn->infer(rgba); });
+
+    ctx.measure([&]() { pipeline.step(); });
+}
+
+// EdfScheduler::networks() behind EdfScheduler::stream(), as a pipeline's network: every
+// frame that ran must come back stylized, at the frame's size
+void bench_edf_networks(BenchContext& ctx)
+{
+    if (!model_available(ctx))
+        return;
+
+    SyntheticSource source(SIZE_720P, FRAME_BGR, 8);
+    Frame frame;
+    source.read(frame);
+    cv::Mat rgba;
+    cv::cvtColor(frame.data, rgba, cv::COLOR_BGR2RGBA);
+
+    const size_t workers = 2;
+    EdfScheduler::Config config;
+    config.workers = workers;
+    EdfScheduler scheduler(config, EdfScheduler::networks(compile(ctx.options()), CNN_INPUT, workers));
+    const EdfScheduler::InferFn infer = scheduler.stream(0, 10000);
+
+    size_t styled = 0;
+    cv::Mat output;
+    ctx.measure([&]() {
+        infer(rgba, output);
+        if (output.size() == rgba.size() && output.type() == rgba.type() && cv::norm(output, rgba, cv::NORM_INF) > 0)
+            styled++;
+    });
+
+    const EdfScheduler::StreamStats stats = scheduler.stats(0);
+    if (styled != stats.done + stats.late)
+        ctx.fail(cv::format("%d of %d frames that ran came back unstyled", (int)(stats.done + stats.late - styled),
+                            (int)(stats.done + stats.late)));
+}
+
+// Several pipelines with the network on the CPU device. By default every stream compiles
+// its own model with the plugin's defaults, as independent processes would; under the
+// budget one model serves all streams with one inference stream each.
+void bench_cnn_streams(BenchContext& ctx, int streams, bool budgeted)
+{
+    if (!model_available(ctx))
+        return;
+
+    const int batch = 10;
+
+    ThreadBudget::Config budget_config;
+    budget_config.streams = streams;
+    ThreadBudget budget(budget_config);
+
+    std::vector<ov::CompiledModel> models;
+    if (budgeted)
+    {
+        budget.apply_opencv();
+        models.push_back(compile(ctx.options(), budget.openvino_config()));
+    }
+    else
+    {
+        for (int i = 0; i < streams; i++)
+            models.push_back(compile(ctx.options()));
+    }
+
+    std::vector<std::unique_ptr<FlowPipeline> > pipelines;
+    for (int i = 0; i < streams; i++)
+    {
+        cv::Ptr<HostNetwork> cnn = cv::makePtr<HostNetwork>(models[budgeted ? 0 : i], CNN_INPUT, ctx.options().model);
+
+        FlowPipeline::Config config;
+        config.max_in_flight = 2;
+        pipelines.push_back(std::unique_ptr<FlowPipeline>(new FlowPipeline(config,
+            cv::makePtr<SyntheticSource>(SIZE_720P, FRAME_BGR, 8), cv::makePtr<NullSink>(),
+            [cnn](const cv::Mat& rgba, cv::Mat&) { cnn->infer(rgba); })));
+    }
+
+    const int64 t0 = cv::getTickCount();
+    ctx.measure([&]() {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < streams; i++)
+        {
+            FlowPipeline* pipeline = pipelines[i].get();
+            if (budgeted)
+                threads.push_back(std::thread([&budget, pipeline, i, batch]() {
+                    budget.arena(i).execute([pipeline, batch]() { pipeline->run(batch); });
+                }));
+            else
+                threads.push_back(std::thread([pipeline, batch]() { pipeline->run(batch); }));
+        }
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+    }, 10);
+    const double seconds = (cv::getTickCount() - t0) / cv::getTickFrequency();
+
+    size_t frames = 0;
+    for (int i = 0; i < streams; i++)
+        frames += pipelines[i]->frames();
+    ctx.metric("fps", frames / seconds);
+
+    cv::setNumThreads(-1);
+}
+
+// Time to the first frame and to the first frame with the network, headless: the model is
+// either compiled before the source and pipeline are set up, or by a ModelLoader while they
+// are, with frames processed without the network until it is ready.
+void bench_startup(BenchContext& ctx, bool overlapped)
+{
+    if (!model_available(ctx))
+        return;
+
+    double first_frame_ms = 0, first_cnn_frame_ms = 0;
+
+    ctx.measure([&]() {
+        const int64 t0 = cv::getTickCount();
+
+        cv::Ptr<ModelLoader> loader;
+        cv::Ptr<HostNetwork> cnn;
+        if (overlapped)
+            loader = cv::makePtr<ModelLoader>(ctx.options().model, ctx.options().device,
+                [](const std::shared_ptr<ov::Model>& model) { return prepare_host_input(model, CNN_INPUT); });
+        else
+            cnn = cv::makePtr<HostNetwork>(compile(ctx.options()), CNN_INPUT, ctx.options().model);
+
+        FramePipeline pipeline(FramePipeline::Config(), cv::makePtr<SyntheticSource>(SIZE_720P, FRAME_BGR, 8),
+                               cv::makePtr<NullSink>(),
+                               [&cnn](const cv::Mat& rgba, cv::Mat&) { if (cnn) cnn->infer(rgba); });
+
+        first_frame_ms = 0;
+        bool cnn_frame = false;
+        while (!cnn_frame)
+        {
+            if (!cnn && loader->ready())
+                cnn = cv::makePtr<HostNetwork>(loader->wait(), CNN_INPUT, ctx.options().model);
+            cnn_frame = !cnn.empty();
+
+            pipeline.step();
+
+            const double ms = (cv::getTickCount() - t0) * 1000. / cv::getTickFrequency();
+            if (first_frame_ms == 0)
+                first_frame_ms = ms;
+            first_cnn_frame_ms = ms;
+        }
+    }, 3);
+
+    ctx.metric("first_frame_ms", first_frame_ms);
+    ctx.metric("first_cnn_frame_ms", first_cnn_frame_ms);
+}
+
+// Reload stress: frames run through the pipeline while the model is reloaded every
+// RELOAD_EVERY frames. Every frame's time is compared with the median of the frames
+// before the first reload; a frame slower than SPIKE_LIMIT times that counts as a spike,
+// and the slowest one beyond --max_spike_ratio fails the benchmark.
+void bench_hot_reload(BenchContext& ctx)
+{
+    if (!model_available(ctx))
+        return;
+
+    const int    RELOAD_EVERY = 20;
+    const int    FRAMES       = 200;
+    const double SPIKE_LIMIT  = 1.5;
+
+    HotModel::Config config;
+    config.device     = ctx.options().device;
+    config.input_size = CNN_INPUT;
+    HotModel model(config);
+    model.reload(ctx.options().model);
+    while (model.loading())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        model.update();
+    }
+    if (!model.current())
+    {
+        ctx.skip("model failed to load");
+        return;
+    }
+
+    FramePipeline pipeline(FramePipeline::Config(), cv::makePtr<SyntheticSource>(SIZE_720P, FRAME_BGR, 8),
+                           cv::makePtr<NullSink>(),
+                           [&model](const cv::Mat& rgba, cv::Mat&) { model.current()->infer(rgba); });
+
+    std::vector<double> steady, during;
+    ctx.measure([&]() {
+        steady.clear();
+        during.clear();
+        for (int frame = 0; frame < FRAMES; frame++)
+        {
+            const int64 t0 = cv::getTickCount();
+            if (frame > 0 && frame % RELOAD_EVERY == 0)
+                model.reload(ctx.options().model);
+            model.update();
+            pipeline.step();
+            const double ms = (cv::getTickCount() - t0) * 1000. / cv::getTickFrequency();
+
+            if (frame < RELOAD_EVERY)
+                steady.push_back(ms);
+            else
+                during.push_back(ms);
+        }
+        while (model.loading())
+            model.update();
+    }, 1);
+
+    std::sort(steady.begin(), steady.end());
+    const double median = steady[steady.size() / 2];
+    const double worst = during.empty() ? 0 : *std::max_element(during.begin(), during.end());
+
+    int spikes = 0;
+    for (size_t i = 0; i < during.size(); i++)
+        spikes += during[i] > SPIKE_LIMIT * median;
+
+    ctx.metric("swaps", (double)model.swaps() - 1);
+    ctx.metric("steady_median_ms", median);
+    ctx.metric("reload_max_ms", worst);
+    const double spike_ratio = median > 0 ? worst / median : 0;
+    ctx.metric("spike_ratio", spike_ratio);
+    ctx.metric("spikes", spikes);
+    if (spike_ratio > ctx.options().max_spike_ratio)
+        ctx.fail(cv::format("a frame during reloads took %.1fx the steady median (limit %.1fx)", spike_ratio,
+                            ctx.options().max_spike_ratio));
+}
+
+// Several streams sharing one network on the CPU plugin, through the coalescer. With
+// max_batch 1 every frame is its own inference, the baseline for batching.
+void bench_batching(BenchContext& ctx, int streams, size_t max_batch)
+{
+    if (!model_available(ctx))
+        return;
+
+    const int batch = 10;   // frames per stream per iteration
+
+    ov::Core core;
+    ov::CompiledModel compiled = core.compile_model(
+        prepare_host_input(core.read_model(ctx.options().model), CNN_INPUT, max_batch), ctx.options().device);
+
+    BatchCoalescer::Config config;
+    config.max_batch   = max_batch;
+    config.max_wait_ms = max_batch > 1 ? 5 : 0;
+    config.input_size  = CNN_INPUT;
+    config.streams     = streams;
+    BatchCoalescer coalescer(config, compiled);
+
+    std::vector<std::unique_ptr<FramePipeline> > pipelines;
+    for (int i = 0; i < streams; i++)
+    {
+        pipelines.push_back(std::unique_ptr<FramePipeline>(new FramePipeline(FramePipeline::Config(),
+            cv::makePtr<SyntheticSource>(SIZE_720P, FRAME_BGR, 8), cv::makePtr<NullSink>(),
+            [&coalescer, i](const cv::Mat& rgba, cv::Mat& output) { coalescer.infer(i, rgba, output); })));
+    }
+
+    const int64 t0 = cv::getTickCount();
+    ctx.measure([&]() {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < streams; i++)
+        {
+            FramePipeline* pipeline = pipelines[i].get();
+            threads.push_back(std::thread([pipeline, batch]() { pipeline->run(batch); }));
+        }
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+    }, 10);
+    const double seconds = (cv::getTickCount() - t0) / cv::getTickFrequency();
+
+    size_t frames = 0;
+    LatencyHistogram latency;
+    for (int i = 0; i < streams; i++)
+    {
+        frames += pipelines[i]->frames();
+        latency.merge(coalescer.latency(i));
+    }
+
+    ctx.metric("fps", frames / seconds);
+    ctx.metric("mean_batch", coalescer.mean_batch_size());
+    ctx.metric("infer_p50_ms", latency.percentile(50));
+    ctx.metric("infer_p99_ms", latency.percentile(99));
+    for (int i = 0; i < streams; i++)
+        ctx.metric(cv::format("stream%d_p99_ms", i), coalescer.latency(i).percentile(99));
+}
+
+// Motion-JPEG clip of the synthetic scene in the temp directory, written once per run;
+// every frame of it is an entry point. Empty if it can't be written.
+std::string synthetic_clip()
+{
+    static std::string path;
+    if (!path.empty())
+        return path;
+
+    const std::string clip = (std::filesystem::temp_directory_path() / "bench_segments.avi").string();
+    SyntheticSource source(cv::Size(640, 360), FRAME_BGR, 4, 240);
+    cv::VideoWriter writer(clip, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 30, source.size());
+    if (!writer.isOpened())
+        return path;
+
+    Frame frame;
+    while (source.read(frame))
+        writer.write(frame.data);
+    path = clip;
+    return path;
+}
+
+// Offline restyling of a 240 frame clip by `workers` processes of this benchmark. The
+// speedup is relative to the 1 worker run, if it ran earlier in the same invocation.
+void bench_segments(BenchContext& ctx, int workers)
+{
+    static double single_worker_fps = 0;
+
+    if (!model_available(ctx))
+        return;
+    if (workers > cv::getNumberOfCPUs())
+    {
+        ctx.skip(cv::format("%d cores", cv::getNumberOfCPUs()));
+        return;
+    }
+
+    SegmentJob::Config config;
+    config.input   = synthetic_clip();
+    config.output  = (std::filesystem::temp_directory_path() / cv::format("bench_segments_w%d.avi", workers)).string();
+    config.model   = ctx.options().model;
+    config.workers = workers;
+    if (config.input.empty())
+    {
+        ctx.skip("can't write a Motion-JPEG clip");
+        return;
+    }
+
+    double fps = 0;
+    int segments = 0;
+    std::ostringstream log;
+    ctx.measure([&]() {
+        SegmentJob job(config);
+        job.run(log);
+        fps = job.fps();
+        segments = job.segments();
+    }, 1);
+
+    if (workers == 1)
+        single_worker_fps = fps;
+
+    ctx.metric("fps", fps);
+    ctx.metric("segments", segments);
+    if (single_worker_fps > 0)
+        ctx.metric("speedup", fps / single_worker_fps);
+}
+
+// in-process inference time of bench_ipc_inprocess, the baseline of bench_ipc_server
+double s_inprocess_ms = 0;
+
+// The network compiled in process with the inference server's configuration.
+void bench_ipc_inprocess(BenchContext& ctx)
+{
+    if (!model_available(ctx))
+        return;
+
+    SyntheticSource source(CNN_INPUT, FRAME_BGR, 8);
+    Frame frame;
+    source.read(frame);
+    cv::Mat rgba;
+    cv::cvtColor(frame.data, rgba, cv::COLOR_BGR2RGBA);
+
+    Cnn cnn;
+    cnn.Init(ctx.options().model, std::make_shared<HostBinding>(ctx.options().device, CNN_INPUT),
+             InferenceServer::Config().openvino_config);
+
+    ctx.measure([&]() {
+        cnn.binding<HostBinding>().set_input(rgba);
+        cnn.Infer();
+    });
+
+    s_inprocess_ms = cnn.time_elapsed() / std::max<size_t>(cnn.ncalls(), 1);
+    ctx.metric("infer_ms", s_inprocess_ms);
+}
+
+// Load test of the inference server, started as a child process of this benchmark:
+// `clients` sessions infer back to back, and the round trips of the first one are timed.
+// The IPC overhead is the round trip less the time the server spent in the network.
+void bench_ipc_server(BenchContext& ctx, int clients)
+{
+    if (!model_available(ctx))
+        return;
+
+    const std::string path = (std::filesystem::temp_directory_path() /
+                              cv::format("dxinfer_%lld.sock", (long long)now_us())).string();
+
+    std::vector<std::string> args;
+    args.push_back(ChildProcess::self_path());
+    args.push_back("--serve=" + path);
+    args.push_back("--model=" + ctx.options().model);
+    args.push_back("--device=" + ctx.options().device);
+    ChildProcess server(args);
+
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> load;
+
+    // on a skip or a throw the server never gets its SHUTDOWN, and ~ChildProcess would
+    // wait for it forever
+    struct Cleanup
+    {
+        std::function<void()> run;
+        ~Cleanup() { run(); }
+    } cleanup = { [&]() {
+        stop = true;
+        for (size_t i = 0; i < load.size(); i++)
+            if (load[i].joinable())
+                load[i].join();
+        server.kill();
+    } };
+
+    // the server compiles the model before it listens
+    std::unique_ptr<InferenceClient> client;
+    for (int i = 0; i < 600 && !client; i++)
+    {
+        try
+        {
+            client.reset(new InferenceClient(path, CNN_INPUT));
+        }
+        catch (const std::exception&)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    if (!client)
+    {
+        ctx.skip("inference server did not start");
+        return;
+    }
+
+    SyntheticSource source(CNN_INPUT, FRAME_BGR, 8);
+    Frame frame;
+    source.read(frame);
+    cv::cvtColor(frame.data, client->input(), cv::COLOR_BGR2RGBA);
+
+    std::atomic<int>  connected(0);
+    for (int i = 1; i < clients; i++)
+    {
+        load.emplace_back([&]() {
+            try
+            {
+                InferenceClient other(path, CNN_INPUT);
+                client->input().copyTo(other.input());
+                connected++;
+                while (!stop)
+                    other.infer();
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << e.what() << std::endl;
+                connected++;
+            }
+        });
+    }
+    while (connected < clients - 1)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    double roundtrip_ms = 0, server_ms = 0;
+    int n = 0;
+    ctx.measure([&]() {
+        const int64 t0 = cv::getTickCount();
+        client->infer();
+        roundtrip_ms += (cv::getTickCount() - t0) * 1000. / cv::getTickFrequency();
+        server_ms    += client->server_infer_ms();
+        n++;
+    });
+
+    stop = true;
+    for (size_t i = 0; i < load.size(); i++)
+        load[i].join();
+
+    client->shutdown_server();
+    if (server.wait() != 0)
+        ctx.fail("inference server exited with an error");
+
+    ctx.metric("roundtrip_ms", roundtrip_ms / n);
+    ctx.metric("server_infer_ms", server_ms / n);
+    ctx.metric("ipc_overhead_ms", (roundtrip_ms - server_ms) / n);
+    if (s_inprocess_ms > 0)
+        ctx.metric("added_vs_inprocess_ms", roundtrip_ms / n - s_inprocess_ms);
+}
+
+} // namespace
+
+
+void register_cnn_benchmarks(BenchSuite& suite)
+{
+    suite.add("cnn/compile",            bench_compile);
+    suite.add("cnn/infer/640x480",       [](BenchContext& ctx) { bench_infer(ctx, -1); });
+    suite.add("cnn/infer_arena/640x480", [](BenchContext& ctx) { bench_infer(ctx, HugePageArena::PAGES_TRANSPARENT); });
+    suite.add("cnn/binding/host/720p",   [](BenchContext& ctx) { bench_binding(ctx, false); });
+    suite.add("cnn/binding/opencl/720p", [](BenchContext& ctx) { bench_binding(ctx, true); });
+    suite.add("pipeline/headless_cnn/720p", bench_pipeline_cnn);
+    suite.add("sched/networks/720p",        bench_edf_networks);
+
+    suite.add("startup/serial",     [](BenchContext& ctx) { bench_startup(ctx, false); });
+    suite.add("startup/overlapped", [](BenchContext& ctx) { bench_startup(ctx, true); });
+
+    suite.add("hotswap/reload/720p", bench_hot_reload);
+
+    suite.add("batch/streams4/b1", [](BenchContext& ctx) { bench_batching(ctx, 4, 1); });
+    suite.add("batch/streams4/b4", [](BenchContext& ctx) { bench_batching(ctx, 4, 4); });
+
+    suite.add("offline/segments/w1", [](BenchContext& ctx) { bench_segments(ctx, 1); });
+    suite.add("offline/segments/w2", [](BenchContext& ctx) { bench_segments(ctx, 2); });
+    suite.add("offline/segments/w4", [](BenchContext& ctx) { bench_segments(ctx, 4); });
+    suite.add("offline/segments/w8", [](BenchContext& ctx) { bench_segments(ctx, 8); });
+
+    suite.add("ipc/inprocess/640x480",         bench_ipc_inprocess);
+    suite.add("ipc/server/640x480/clients1",   [](BenchContext& ctx) { bench_ipc_server(ctx, 1); });
+    suite.add("ipc/server/640x480/clients4",   [](BenchContext& ctx) { bench_ipc_server(ctx, 4); });
+
+    suite.add("budget/streams4_cnn/default", [](BenchContext& ctx) { bench_cnn_streams(ctx, 4, false); });
+    suite.add("budget/streams4_cnn/budget",  [](BenchContext& ctx) { bench_cnn_streams(ctx, 4, true); });
+}
@@ -0,0 +1,129 @@
+/*
+// Color conversion benchmarks: capture-side and display-side conversions
+*/
+#include "benchmark.hpp"
+
+#include "opencv2/imgproc.hpp"
+
+#include "color_convert.hpp"
+
+namespace
+{
+
+cv::Mat test_frame_bgr(cv::Size size)
+{
+    SyntheticSource source(size, FRAME_BGR, 8);
+    Frame frame;
+    source.read(frame);
+    return frame.data.clone();
+}
+
+void bench_bgr_to_rgba(BenchContext& ctx, cv::Size size)
+{
+    cv::Mat bgr = test_frame_bgr(size), rgba;
+    ctx.measure([&]() { cv::cvtColor(bgr, rgba, cv::COLOR_BGR2RGBA); });
+}
+
+void bench_bgr_to_nv12(BenchContext& ctx, cv::Size size)
+{
+    cv::Mat bgr = test_frame_bgr(size), i420, nv12;
+    ctx.measure([&]() {
+        cv::cvtColor(bgr, i420, cv::COLOR_BGR2YUV_I420);
+        convert_I420_to_NV12(i420, nv12, size.width, size.height);
+    });
+}
+
+void bench_i420_to_nv12(BenchContext& ctx, cv::Size size)
+{
+    cv::Mat i420, nv12;
+    cv::cvtColor(test_frame_bgr(size), i420, cv::COLOR_BGR2YUV_I420);
+    ctx.measure([&]() { convert_I420_to_NV12(i420, nv12, size.width, size.height); });
+}
+
+void bench_nv12_to_rgba(BenchContext& ctx, cv::Size size, bool reference)
+{
+    cv::Mat i420, nv12;
+    cv::cvtColor(test_frame_bgr(size), i420, cv::COLOR_BGR2YUV_I420);
+    convert_I420_to_NV12(i420, nv12, size.width, size.height);
+
+    cv::Mat rgba(size, CV_8UC4);
+    if (reference)
+    {
+        ctx.measure([&]() { cv::cvtColor(nv12, rgba, cv::COLOR_YUV2RGBA_NV12); });
+        return;
+    }
+
+    ctx.measure([&]() {
+        convert_NV12_to_RGBA(nv12.ptr(0), nv12.step[0], nv12.ptr(size.height), nv12.step[0],
+                             rgba.data, rgba.step[0], size.width, size.height);
+    });
+
+    cv::Mat expected;
+    cv::cvtColor(nv12, expected, cv::COLOR_YUV2RGBA_NV12);
+    const double max_diff = cv::norm(rgba, expected, cv::NORM_INF);
+    ctx.metric("max_diff", max_diff);
+    if (max_diff > 0)
+        ctx.fail("not bit-exact with cvtColor");
+}
+
+// The display path converts between mapped surfaces, whose rows are padded and whose
+// planes need not be adjacent. The same on host buffers: separate Y and UV planes and an
+// RGBA target, all with pitches beyond the row, checked against cvtColor and for writes
+// into the padding.
+void bench_nv12_to_rgba_pitched(BenchContext& ctx, cv::Size size)
+{
+    cv::Mat i420, nv12;
+    cv::cvtColor(test_frame_bgr(size), i420, cv::COLOR_BGR2YUV_I420);
+    convert_I420_to_NV12(i420, nv12, size.width, size.height);
+
+    const int PAD = 68;   // not a multiple of the vector width either
+    const uchar FILL = 0x5a;
+    cv::Mat y(size.height, size.width + PAD, CV_8UC1, cv::Scalar(FILL));
+    cv::Mat uv(size.height / 2, size.width + PAD, CV_8UC1, cv::Scalar(FILL));
+    cv::Mat rgba(size.height, size.width + PAD, CV_8UC4, cv::Scalar::all(FILL));
+    nv12.rowRange(0, size.height).copyTo(y.colRange(0, size.width));
+    nv12.rowRange(size.height, nv12.rows).copyTo(uv.colRange(0, size.width));
+
+    ctx.measure([&]() {
+        convert_NV12_to_RGBA(y.data, y.step[0], uv.data, uv.step[0], rgba.data, rgba.step[0], size.width, size.height);
+    });
+
+    cv::Mat expected;
+    cv::cvtColor(nv12, expected, cv::COLOR_YUV2RGBA_NV12);
+    const double max_diff = cv::norm(rgba.colRange(0, size.width), expected, cv::NORM_INF);
+    const int padding_written = cv::countNonZero(rgba.colRange(size.width, rgba.cols).reshape(1) != FILL);
+    ctx.metric("max_diff", max_diff);
+    ctx.metric("padding_written", padding_written);
+    if (max_diff > 0)
+        ctx.fail("not bit-exact with cvtColor");
+    else if (padding_written > 0)
+        ctx.fail("wrote past the end of the RGBA rows");
+}
+
+} // namespace
+
+
+void register_color_benchmarks(BenchSuite& suite)
+{
+    const cv::Size sizes[] = { SIZE_720P, SIZE_1080P, SIZE_2160P };
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        const cv::Size size = sizes[i];
+        const std::string res = size_name(size);
+
+        suite.add("color/bgr_to_rgba/" + res,       [=](BenchContext& ctx) { bench_bgr_to_rgba(ctx, size); });
+        suite.add("color/bgr_to_nv12/" + res,       [=](BenchContext& ctx) { bench_bgr_to_nv12(ctx, size); });
+        suite.add("color/i420_to_nv12/" + res,      [=](BenchContext& ctx) { bench_i420_to_nv12(ctx, size); });
+        suite.add("color/nv12_to_rgba/" + res,      [=](BenchContext& ctx) { bench_nv12_to_rgba(ctx, size, false); });
+        suite.add("color/nv12_to_rgba_cvt/" + res,  [=](BenchContext& ctx) { bench_nv12_to_rgba(ctx, size, true); });
+    }
+
+    // the tail of rows that are no multiple of the vector width
+    const cv::Size sizes_pitched[] = { SIZE_720P, cv::Size(646, 482) };
+    for (size_t i = 0; i < sizeof(sizes_pitched) / sizeof(sizes_pitched[0]); i++)
+    {
+        const cv::Size size = sizes_pitched[i];
+        suite.add("color/nv12_to_rgba_pitched/" + size_name(size), [=](BenchContext& ctx) { bench_nv12_to_rgba_pitched(ctx, size); });
+    }
+}
@@ -0,0 +1,140 @@
+/*
+// Filter benchmarks: the blur stage and the status overlay
+*/
+#include "benchmark.hpp"
+
+#include "opencv2/core/ocl.hpp"
+#include "opencv2/imgproc.hpp"
+
+#include "box_filter.hpp"
+#include "overlay.hpp"
+#include "umat_pool.hpp"
+
+namespace
+{
+
+cv::Mat test_frame_rgba(cv::Size size)
+{
+    SyntheticSource source(size, FRAME_BGR, 8);
+    Frame frame;
+    source.read(frame);
+    cv::Mat rgba;
+    cv::cvtColor(frame.data, rgba, cv::COLOR_BGR2RGBA);
+    return rgba;
+}
+
+void bench_box_blur(BenchContext& ctx, cv::Size size, int k)
+{
+    const cv::Mat src = test_frame_rgba(size);
+
+    cv::Mat m = src.clone();
+    box_blur_rgba(m, cv::Size(k, k));
+    cv::Mat expected;
+    cv::blur(src, expected, cv::Size(k, k));
+    const double max_diff = cv::norm(m, expected, cv::NORM_INF);
+    ctx.metric("max_diff", max_diff);
+    if (max_diff > 0)
+        ctx.fail("not bit-exact with cv::blur");
+
+    // in place, as on the mapped surface; the cost does not depend on the content
+    ctx.measure([&]() { box_blur_rgba(m, cv::Size(k, k)); });
+}
+
+void bench_cv_blur(BenchContext& ctx, cv::Size size, int k)
+{
+    cv::Mat m = test_frame_rgba(size);
+    ctx.measure([&]() { cv::blur(m, m, cv::Size(k, k)); });
+}
+
+// what the sample did before TextOverlay: three putText calls on every frame
+void bench_overlay_puttext(BenchContext& ctx, cv::Size size)
+{
+    cv::Mat m = test_frame_rgba(size);
+    int frame = 0;
+    ctx.measure([&]() {
+        const cv::Scalar color(0, 0, 200);
+        cv::putText(m, "mode: Processing on CPU", cv::Point(0, 20), cv::FONT_HERSHEY_SIMPLEX, 0.8, color, 2);
+        cv::putText(m, "processing: CNN_FULL", cv::Point(0, 40), cv::FONT_HERSHEY_SIMPLEX, 0.8, color, 2);
+        cv::putText(m, cv::format("time: %4.3f msec", 10. + (frame++ % 100) * 0.01), cv::Point(0, 60),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.8, color, 2);
+    });
+}
+
+void bench_overlay_cached(BenchContext& ctx, cv::Size size)
+{
+    cv::Mat m = test_frame_rgba(size);
+    TextOverlay overlay(3, cv::Scalar(0, 0, 200));
+    int frame = 0;
+    ctx.measure([&]() {
+        overlay.set_line(0, "mode: Processing on CPU");
+        overlay.set_line(1, "processing: CNN_FULL");
+        overlay.set_line_throttled(2, cv::format("time: %4.3f msec", 10. + (frame++ % 100) * 0.01));
+        overlay.compose(m);
+    });
+    ctx.metric("rasterizations", (double)overlay.rasterizations());
+}
+
+// The GPU mode frame on the UMat path: upload, blur, overlay, download. Pooled, the frame
+// and blur buffers persist; otherwise they are created per frame, as the sample did. Runs on
+// any OpenCL device, including CPU implementations such as PoCL.
+void bench_umat_frame(BenchContext& ctx, cv::Size size, bool pooled)
+{
+    if (!cv::ocl::haveOpenCL() || !cv::ocl::useOpenCL())
+    {
+        ctx.skip("no OpenCL device");
+        return;
+    }
+
+    const cv::Mat src = test_frame_rgba(size);
+    cv::Mat dst(size, CV_8UC4);
+    TextOverlay overlay(3, cv::Scalar(0, 0, 200));
+    overlay.set_line(0, "mode: Processing on GPU RGBA");
+
+    UMatPool pool(pooled ? 64 << 20 : 0);
+    size_t frames = 0;
+    ctx.measure([&]() {
+        if (!pooled)
+            pool.clear();
+
+        cv::UMat& u = pool.get(0, size, CV_8UC4);
+        src.copyTo(u);
+        cv::UMat& blurred = pool.get(1, size, CV_8UC4);
+        cv::blur(u, blurred, cv::Size(15, 15));
+        overlay.compose(blurred);
+        blurred.copyTo(dst);
+        frames++;
+    });
+
+    ctx.metric("buffers_created_per_frame", frames ? (double)pool.created() / frames : 0);
+    ctx.metric("reserved_kb", UMatPool::reserved_bytes() / 1024.);
+}
+
+} // namespace
+
+
+void register_filter_benchmarks(BenchSuite& suite)
+{
+    const cv::Size sizes[] = { SIZE_720P, SIZE_1080P, SIZE_2160P };
+    const int kernels[] = { 3, 7, 15, 31 };
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        const cv::Size size = sizes[i];
+        const std::string res = size_name(size);
+
+        for (size_t j = 0; j < sizeof(kernels) / sizeof(kernels[0]); j++)
+        {
+            const int k = kernels[j];
+            const std::string suffix = res + cv::format("/k%d", k);
+
+            suite.add("blur/box_blur_rgba/" + suffix, [=](BenchContext& ctx) { bench_box_blur(ctx, size, k); });
+            suite.add("blur/cv_blur/" + suffix,       [=](BenchContext& ctx) { bench_cv_blur(ctx, size, k); });
+        }
+    }
+
+    suite.add("overlay/puttext/720p", [](BenchContext& ctx) { bench_overlay_puttext(ctx, SIZE_720P); });
+    suite.add("overlay/cached/720p",  [](BenchContext& ctx) { bench_overlay_cached(ctx, SIZE_720P); });
+
+    suite.add("umat/frame/720p/fresh",  [](BenchContext& ctx) { bench_umat_frame(ctx, SIZE_720P, false); });
+    suite.add("umat/frame/720p/pooled", [](BenchContext& ctx) { bench_umat_frame(ctx, SIZE_720P, true); });
+}
@@ -0,0 +1,1097 @@
+/*
+// End-to-end benchmarks: the headless pipeline and the inference-skipping strategies
+*/
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "opencv2/imgproc.hpp"
+#include "opencv2/videoio.hpp"
+
+#include "change_detector.hpp"
+#include "edf_scheduler.hpp"
+#include "flow_pipeline.hpp"
+#include "frame_latency.hpp"
+#include "frame_record.hpp"
+#include "frame_ring.hpp"
+#include "huge_page_arena.hpp"
+#include "infer_strategy.hpp"
+#include "numa_topology.hpp"
+#include "pipeline.hpp"
+#include "quality_controller.hpp"
+#include "thread_budget.hpp"
+#include "temporal_reuse.hpp"
+#include "tile_restyler.hpp"
+#include "video_sink.hpp"
+
+namespace
+{
+
+// Stand-in for the style network where only the saved work matters: a few ms of
+// spatial filtering per 720p frame, on inputs of any size.
+void proxy_infer(const cv::Mat& input, cv::Mat& output)
+{
+    cv::GaussianBlur(input, output, cv::Size(21, 21), 0);
+}
+
+// median of every stage interval, and the tail of the end-to-end ones; the whole
+// breakdown with --latency
+void latency_metrics(BenchContext& ctx, const FrameLatency& latency)
+{
+    if (ctx.options().latency)
+        latency.print(std::cout);
+
+    for (int i = 0; i < FrameLatency::INTERVAL_COUNT; i++)
+    {
+        const FrameLatency::Interval interval = (FrameLatency::Interval)i;
+        ctx.metric(std::string(FrameLatency::name(interval)) + "_p50_ms", latency.histogram(interval).percentile(50));
+    }
+    ctx.metric("capture_to_sink_p99_ms", latency.histogram(FrameLatency::CAPTURE_TO_SINK).percentile(99));
+    ctx.metric("capture_to_present_p99_ms", latency.histogram(FrameLatency::CAPTURE_TO_PRESENT).percentile(99));
+}
+
+void bench_headless(BenchContext& ctx, const cv::Ptr<FrameSource>& source)
+{
+    FramePipeline::Config config;
+    FramePipeline pipeline(config, source, cv::makePtr<NullSink>());
+
+    ctx.measure([&]() {
+        if (!pipeline.step())
+            throw std::runtime_error("frame source ended");
+    });
+    latency_metrics(ctx, pipeline.latency());
+}
+
+// drawing the watermark into a processed frame, and decoding it back as a camera-side
+// checker would
+void bench_watermark(BenchContext& ctx)
+{
+    SyntheticSource source(SIZE_720P, FRAME_BGR, 8);
+    Frame frame;
+    cv::Mat rgba;
+
+    size_t frames = 0, decoded = 0;
+    ctx.measure([&]() {
+        if (!source.read(frame))
+            throw std::runtime_error("frame source ended");
+        frame_to_rgba(frame, rgba);
+        const uint32_t expected_ms = (uint32_t)wall_clock_ms(frame.timestamp_us);
+        draw_watermark(rgba, frame);
+
+        // the wall clock is read again while drawing, a ms boundary may pass in between
+        uint32_t seq = 0, capture_ms = 0;
+        if (read_watermark(rgba, seq, capture_ms) && seq == (uint32_t)frame.seq &&
+            std::abs((int32_t)(capture_ms - expected_ms)) <= 1)
+            decoded++;
+        frames++;
+    });
+    ctx.metric("decoded_ok", frames ? (double)decoded / frames : 0.);
+    if (decoded != frames)
+        ctx.fail(cv::format("%d of %d watermarks decoded wrong", (int)(frames - decoded), (int)frames));
+
+    // too narrow for the strip: left as it is
+    cv::Mat narrow(120, 160, CV_8UC4, cv::Scalar::all(7)), before = narrow.clone();
+    draw_watermark(narrow, frame);
+    if (cv::norm(narrow, before, cv::NORM_INF) != 0)
+        ctx.fail("watermark drawn into a frame narrower than 256 pixels");
+}
+
+// throughput of the serial pipeline vs. the flow graph, batches of frames per iteration
+const int BATCH = 30;
+
+void bench_serial_batch(BenchContext& ctx, const FramePipeline::InferFn& infer)
+{
+    FramePipeline::Config config;
+    FramePipeline pipeline(config, cv::makePtr<SyntheticSource>(SIZE_720P, FRAME_BGR, 8), cv::makePtr<NullSink>(), infer);
+
+    int64 t0 = cv::getTickCount();
+    ctx.measure([&]() { pipeline.run(BATCH); });
+    const double seconds = (cv::getTickCount() - t0) / cv::getTickFrequency();
+    ctx.metric("fps", pipeline.frames() / seconds);
+    latency_metrics(ctx, pipeline.latency());
+}
+
+void bench_flow_batch(BenchContext& ctx, const FramePipeline::InferFn& infer)
+{
+    FlowPipeline::Config config;
+    config.max_in_flight     = std::max(cv::getNumberOfCPUs(), 2);
+    config.infer_concurrency = 0;   // proxy_infer is thread safe
+    FlowPipeline pipeline(config, cv::makePtr<SyntheticSource>(SIZE_720P, FRAME_BGR, 8), cv::makePtr<NullSink>(), infer);
+
+    int64 t0 = cv::getTickCount();
+    ctx.measure([&]() { pipeline.run(BATCH); });
+    const double seconds = (cv::getTickCount() - t0) / cv::getTickFrequency();
+    ctx.metric("fps", pipeline.frames() / seconds);
+    ctx.metric("latency_ms", pipeline.mean_latency_ms());
+    ctx.metric("max_latency_ms", pipeline.max_latency_ms());
+    ctx.metric("out_of_order", (double)pipeline.out_of_order());
+    latency_metrics(ctx, pipeline.latency());
+}
+
+// The quality controller against synthetic stage costs, no clock involved: per frame
+// 3 ms capture, 1 ms present, 4 ms blur from LEVEL_BLUR up, and `infer` ms on the
+// frames infer_frame() picks. Three loads, each long enough for cost estimates to
+// expire: one where only LEVEL_CNN_REDUCED holds the 30 fps target, one light enough for
+// full inference, one where only blur fits. The level at the end of each, and the
+// transitions it took to get there, are checked.
+void bench_quality_synthetic(BenchContext& ctx)
+{
+    struct Phase
+    {
+        double                   infer_ms;
+        QualityController::Level expected;
+        size_t                   max_transitions;
+    };
+    const Phase phases[] = {
+        { 45,  QualityController::LEVEL_CNN_REDUCED, 1 },
+        { 15,  QualityController::LEVEL_CNN_FULL,    1 },
+        { 200, QualityController::LEVEL_BLUR,        4 },
+    };
+    const int PHASE_FRAMES = 900;
+
+    std::string failure;
+    size_t transitions = 0;
+    ctx.measure([&]() {
+        std::ostringstream log;
+        QualityController quality(QualityController::Config(), QualityController::LEVEL_CNN_FULL, &log);
+
+        failure.clear();
+        for (size_t p = 0; p < sizeof(phases) / sizeof(phases[0]); p++)
+        {
+            const size_t before = quality.transitions();
+            for (int i = 0; i < PHASE_FRAMES; i++)
+            {
+                const QualityController::Level level = quality.level();
+                quality.report(QualityController::STAGE_CAPTURE, 3);
+                if (level >= QualityController::LEVEL_BLUR)
+                    quality.report(QualityController::STAGE_PROCESS, 4);
+                if (quality.infer_frame())
+                    quality.report(QualityController::STAGE_INFER, phases[p].infer_ms);
+                quality.report(QualityController::STAGE_PRESENT, 1);
+                quality.end_frame();
+            }
+
+            const size_t taken = quality.transitions() - before;
+            if (failure.empty() && (quality.level() != phases[p].expected || taken > phases[p].max_transitions))
+                failure = cv::format("%.0f ms inference: ended at %s after %d transitions, expected %s after at most %d",
+                                     phases[p].infer_ms, QualityController::level_name(quality.level()), (int)taken,
+                                     QualityController::level_name(phases[p].expected), (int)phases[p].max_transitions);
+        }
+        transitions = quality.transitions();
+    });
+
+    ctx.metric("transitions", (double)transitions);
+    if (!failure.empty())
+        ctx.fail(failure);
+}
+
+// The same through FramePipeline, with a network that sleeps 30 ms on small frames and
+// a 20 ms target: full inference is over it, every other frame fits. The pipeline has to
+// settle at LEVEL_CNN_REDUCED, skipping the network on about half of the frames.
+void bench_quality_pipeline(BenchContext& ctx)
+{
+    const int FRAMES = 120;
+
+    size_t calls = 0, transitions = 0;
+    QualityController::Level level = QualityController::LEVEL_CNN_FULL;
+    ctx.measure([&]() {
+        std::atomic<size_t> infers(0);
+        FramePipeline::InferFn infer = [&infers](const cv::Mat& input, cv::Mat& output) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(30));
+            input.copyTo(output);
+            infers++;
+        };
+
+        FramePipeline::Config config;
+        config.target_frame_ms = 20;
+        FramePipeline pipeline(config, cv::makePtr<SyntheticSource>(cv::Size(320, 240), FRAME_BGR, 8),
+                               cv::makePtr<NullSink>(), infer);
+        pipeline.run(FRAMES);
+
+        calls       = infers;
+        transitions = pipeline.quality().transitions();
+        level       = pipeline.quality().level();
+    }, 1);
+
+    const double ratio = (double)calls / FRAMES;
+    ctx.metric("infer_ratio", ratio);
+    ctx.metric("transitions", (double)transitions);
+    if (level != QualityController::LEVEL_CNN_REDUCED || transitions != 1)
+        ctx.fail(cv::format("ended at %s after %d transitions", QualityController::level_name(level), (int)transitions));
+    else if (ratio > 0.6)
+        ctx.fail("the reduced level ran the network on most frames");
+}
+
+// A strategy inside FramePipeline on synthetic motion of `speed`, with proxy_infer as the
+// network: it has to run the network on fewer frames than it gets, and every frame has
+// to reach the sink.
+void bench_strategy_pipeline(BenchContext& ctx, InferStrategy::Mode mode, double speed)
+{
+    const int FRAMES = 60;
+
+    size_t calls = 0, inferences = 0, presented = 0;
+    ctx.measure([&]() {
+        size_t infers = 0;
+        FramePipeline::InferFn infer = [&infers](const cv::Mat& input, cv::Mat& output) {
+            proxy_infer(input, output);
+            infers++;
+        };
+
+        FramePipeline::Config config;
+        config.overlay       = false;
+        config.strategy.mode = mode;
+        cv::Ptr<NullSink> sink = cv::makePtr<NullSink>();
+        FramePipeline pipeline(config, cv::makePtr<SyntheticSource>(cv::Size(320, 240), FRAME_BGR, speed), sink, infer);
+        pipeline.run(FRAMES);
+
+        calls      = infers;
+        inferences = pipeline.strategy().inferences();
+        presented  = sink->frames();
+    }, 1);
+
+    ctx.metric("infer_ratio", (double)calls / FRAMES);
+    if (presented != FRAMES)
+        ctx.fail(cv::format("%d of %d frames reached the sink", (int)presented, FRAMES));
+    else if (calls != inferences)
+        ctx.fail("the strategy miscounted its network calls");
+    else if (calls >= (size_t)FRAMES)
+        ctx.fail(std::string(InferStrategy::name(mode)) + " ran the network on every frame");
+}
+
+// counts frames presented on a core outside the pipeline's node
+struct NodeCheckSink : public FrameSink
+{
+    explicit NodeCheckSink(int node) : node(node), remote(0) {}
+
+    void consume(const Frame&, const cv::Mat&)
+    {
+        if (node >= 0 && NumaTopology::system().current_node() != node)
+            remote++;
+    }
+
+    int    node;
+    uint64 remote;
+};
+
+enum StreamPlacement
+{
+    DEFAULT_POOLS,   // every pool sized to the whole machine
+    BUDGET,          // one thread budget, threads float
+    BUDGET_NUMA      // one thread budget, each pipeline on a NUMA node with node-local frames
+};
+
+// several pipelines sharing the machine; reports the combined frame rate. With numa the
+// node of each pipeline is reported too, and `remote_ratio` is the share of frames whose
+// sink ran on a core of another node than the pipeline's.
+void bench_streams(BenchContext& ctx, int streams, StreamPlacement placement)
+{
+    const bool budgeted = placement != DEFAULT_POOLS;
+
+    ThreadBudget::Config budget_config;
+    budget_config.streams = streams;
+    budget_config.numa    = placement == BUDGET_NUMA;
+    ThreadBudget budget(budget_config);
+    if (budgeted)
+        budget.apply_opencv();
+
+    std::vector<cv::Ptr<NodeCheckSink> > sinks;
+    std::vector<std::unique_ptr<FlowPipeline> > pipelines;
+    for (int i = 0; i < streams; i++)
+    {
+        sinks.push_back(cv::makePtr<NodeCheckSink>(budget.node(i)));
+
+        FlowPipeline::Config config;
+        config.max_in_flight     = budgeted ? std::max(budget.pipeline_threads(), 2) : std::max(cv::getNumberOfCPUs(), 2);
+        config.infer_concurrency = 0;
+        config.allocator         = budget.allocator(i);
+        pipelines.push_back(std::unique_ptr<FlowPipeline>(new FlowPipeline(config,
+            cv::makePtr<SyntheticSource>(SIZE_720P, FRAME_BGR, 8), sinks[i], proxy_infer)));
+    }
+
+    const int64 t0 = cv::getTickCount();
+    ctx.measure([&]() {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < streams; i++)
+        {
+            FlowPipeline* pipeline = pipelines[i].get();
+            if (budgeted)
+                threads.push_back(std::thread([&budget, pipeline, i]() {
+                    budget.arena(i).execute([pipeline]() { pipeline->run(BATCH); });
+                }));
+            else
+                threads.push_back(std::thread([pipeline]() { pipeline->run(BATCH); }));
+        }
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+    }, 20);
+    const double seconds = (cv::getTickCount() - t0) / cv::getTickFrequency();
+
+    size_t frames = 0;
+    double latency = 0;
+    for (int i = 0; i < streams; i++)
+    {
+        frames += pipelines[i]->frames();
+        latency += pipelines[i]->mean_latency_ms() / streams;
+    }
+    ctx.metric("fps", frames / seconds);
+    ctx.metric("latency_ms", latency);
+    if (placement == BUDGET_NUMA)
+    {
+        uint64 remote = 0;
+        for (int i = 0; i < streams; i++)
+        {
+            remote += sinks[i]->remote;
+            ctx.metric(cv::format("stream%d_node", i), budget.node(i));
+        }
+
+        ctx.metric("nodes", NumaTopology::system().node_count());
+        ctx.metric("remote_ratio", frames ? (double)remote / frames : 0.);
+    }
+
+    cv::setNumThreads(-1);
+}
+
+void bench_replay(BenchContext& ctx)
+{
+    if (ctx.options().replay.empty())
+    {
+        ctx.skip("no recording given (--replay)");
+        return;
+    }
+    bench_headless(ctx, cv::makePtr<ReplaySource>(ctx.options().replay, false, true));
+}
+
+// Replaying a fresh recording: frames come back as recorded, and headers whose record
+// stride can't hold a frame are refused instead of dividing by zero or reading past the
+// mapping.
+void bench_replay_roundtrip(BenchContext& ctx)
+{
+    const int FRAMES = 8;
+    const std::string path = (std::filesystem::temp_directory_path() / "bench_replay.dxf").string();
+
+    SyntheticSource source(cv::Size(320, 240), FRAME_BGR, 8);
+    std::vector<cv::Mat> recorded;
+    {
+        FrameRecorder recorder(path, FRAME_BGR, source.size());
+        Frame frame;
+        for (int i = 0; i < FRAMES && source.read(frame); i++)
+        {
+            recorder.write(frame);
+            recorded.push_back(frame.data.clone());
+        }
+    }
+
+    size_t mismatches = 0;
+    {
+        ReplaySource replay(path, false, true);
+        Frame frame;
+        for (int i = 0; i < FRAMES; i++)
+            if (!replay.read(frame) || cv::norm(frame.data, recorded[i], cv::NORM_INF) != 0)
+                mismatches++;
+
+        ctx.measure([&]() {
+            if (!replay.read(frame))
+                throw std::runtime_error("frame source ended");
+        });
+    }
+
+    // rewrite the stride of the recording's header
+    const auto refused = [&path](uint64_t stride) {
+        FILE* f = fopen(path.c_str(), "r+b");
+        if (!f)
+            return false;
+        FrameFileHeader header;
+        bool patched = fread(&header, sizeof(header), 1, f) == 1;
+        header.record_stride = stride;
+        patched = patched && fseek(f, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, f) == 1;
+        fclose(f);
+        if (!patched)
+            return false;
+        try
+        {
+            ReplaySource replay(path, false);
+            return false;
+        }
+        catch (const std::runtime_error&)
+        {
+            return true;
+        }
+    };
+    const bool zero_refused  = refused(0);
+    const bool short_refused = refused(sizeof(FrameRecordHeader));
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+
+    if (mismatches > 0)
+        ctx.fail(cv::format("%d of %d frames replayed differently", (int)mismatches, FRAMES));
+    else if (!zero_refused || !short_refused)
+        ctx.fail("a recording with a record stride shorter than a frame was accepted");
+}
+
+// per-frame cost, keyframe share and quality of warped frames against inference on every frame
+void bench_temporal_reuse(BenchContext& ctx, double speed)
+{
+    SyntheticSource source(SIZE_720P, FRAME_BGR, speed);
+    TemporalReuse reuse((TemporalReuse::Config()));
+    Frame frame;
+    cv::Mat output;
+
+    ctx.measure([&]() {
+        source.read(frame);
+        reuse.process(frame.data, output, proxy_infer);
+    });
+
+    const int frames = 60;
+    SyntheticSource eval_source(SIZE_720P, FRAME_BGR, speed);
+    TemporalReuse eval((TemporalReuse::Config()));
+    cv::Mat reference;
+    double psnr = 0;
+    for (int i = 0; i < frames; i++)
+    {
+        eval_source.read(frame);
+        eval.process(frame.data, output, proxy_infer);
+        proxy_infer(frame.data, reference);
+        psnr += std::min(cv::PSNR(output, reference), 100.);
+    }
+    ctx.metric("psnr_db", psnr / frames);
+    ctx.metric("keyframe_ratio", (double)eval.keyframes() / frames);
+}
+
+void bench_full_inference(BenchContext& ctx)
+{
+    SyntheticSource source(SIZE_720P, FRAME_BGR, 8);
+    Frame frame;
+    cv::Mat output;
+
+    ctx.measure([&]() {
+        source.read(frame);
+        proxy_infer(frame.data, output);
+    });
+}
+
+void bench_change_detector(BenchContext& ctx, double speed)
+{
+    SyntheticSource source(SIZE_720P, FRAME_BGR, speed);
+    ChangeDetector detector((ChangeDetector::Config()));
+    Frame frame;
+    cv::Mat output;
+
+    size_t calls = 0;
+    const ChangeDetector::InferFn infer = [&calls](const cv::Mat& input, cv::Mat& out) {
+        proxy_infer(input, out);
+        calls++;
+    };
+
+    ctx.measure([&]() {
+        source.read(frame);
+        detector.process(frame.data, output, infer);
+    });
+
+    ctx.metric("skip_ratio", detector.frames() ? (double)detector.skipped() / detector.frames() : 0.);
+    if (calls + detector.skipped() != detector.frames())
+        ctx.fail(cv::format("%d network calls and %d skips for %d frames", (int)calls, (int)detector.skipped(),
+                            (int)detector.frames()));
+}
+
+void bench_tile_restyler(BenchContext& ctx, double speed)
+{
+    SyntheticSource source(SIZE_720P, FRAME_BGR, speed);
+    TileRestyler restyler((TileRestyler::Config()));
+    Frame frame;
+    cv::Mat output;
+
+    ctx.measure([&]() {
+        source.read(frame);
+        restyler.process(frame.data, output, proxy_infer);
+    });
+
+    ctx.metric("tile_ratio", restyler.mean_tile_ratio());
+}
+
+// TileRestyler for a network with a fixed input: every call must get a crop of exactly
+// that input, and the full first frame, put together from windows, must match the
+// network run on the whole frame at 1:1 scale, with no seams. proxy_infer's 21x21
+// kernel reaches 10 pixels, within the halo; one level of rounding is allowed.
+void bench_tile_windows(BenchContext& ctx)
+{
+    const cv::Size input(320, 240);
+    size_t calls = 0, misfits = 0;
+    const TileRestyler::InferFn infer = [&](const cv::Mat& crop, cv::Mat& out) {
+        if (crop.size() != input)
+            misfits++;
+        proxy_infer(crop.clone(), out);   // a ROI would let the filter read past the crop
+        calls++;
+    };
+
+    TileRestyler::Config config;
+    config.network_input = input;
+
+    SyntheticSource source(SIZE_720P, FRAME_BGR, 8);
+    TileRestyler restyler(config);
+    Frame frame;
+    cv::Mat output, reference;
+
+    source.read(frame);
+    restyler.process(frame.data, output, infer);
+    proxy_infer(frame.data, reference);
+    const double max_diff = cv::norm(output, reference, cv::NORM_INF);
+
+    ctx.measure([&]() {
+        source.read(frame);
+        restyler.process(frame.data, output, infer);
+    });
+
+    ctx.metric("tile_ratio", restyler.mean_tile_ratio());
+    ctx.metric("calls_per_frame", (double)calls / restyler.frames());
+    if (misfits > 0)
+        ctx.fail(cv::format("%d of %d crops were not %dx%d", (int)misfits, (int)calls, input.width, input.height));
+    else if (max_diff > 1)
+        ctx.fail(cv::format("full frame from windows differs by up to %g", max_diff));
+}
+
+// median time of proxy_infer on a frame
+double median_proxy_ms(const cv::Mat& rgba)
+{
+    cv::Mat output;
+    std::vector<double> times;
+    for (int i = 0; i < 5; i++)
+    {
+        const int64 t0 = cv::getTickCount();
+        proxy_infer(rgba, output);
+        times.push_back((cv::getTickCount() - t0) * 1000. / cv::getTickFrequency());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// Six streams in three SLO classes share two workers running proxy_infer, each stream
+// submitting its next frame as soon as the previous one is back, so the pool is always
+// oversubscribed. Deadlines are multiples of the measured proxy time, which keeps the
+// load comparable across machines.
+void bench_edf(BenchContext& ctx, bool edf)
+{
+    struct SloClass
+    {
+        const char* name;
+        double      deadline;   // in proxy_infer times
+        int         priority;
+    };
+    const SloClass classes[] = { { "display", 2.5, 2 }, { "analytics", 6, 1 }, { "archive", 40, 0 } };
+    const int classes_count = sizeof(classes) / sizeof(classes[0]);
+    const int per_class = 2;
+    const int streams = classes_count * per_class;
+    const int batch = 20;   // frames per stream per iteration
+
+    SyntheticSource source(cv::Size(640, 480), FRAME_BGR, 8);
+    Frame frame;
+    source.read(frame);
+    cv::Mat rgba;
+    cv::cvtColor(frame.data, rgba, cv::COLOR_BGR2RGBA);
+    const double proxy_ms = median_proxy_ms(rgba);
+
+    EdfScheduler::Config config;
+    config.workers = 2;
+    config.streams = streams;
+    config.edf     = edf;
+    EdfScheduler scheduler(config, [](size_t, const cv::Mat& input, cv::Mat& out) { proxy_infer(input, out); });
+
+    ctx.measure([&]() {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < streams; i++)
+        {
+            const SloClass& slo = classes[i / per_class];
+            threads.push_back(std::thread([&scheduler, &rgba, &slo, i, batch, proxy_ms]() {
+                cv::Mat out;
+                for (int f = 0; f < batch; f++)
+                    scheduler.infer(i, rgba, out, slo.deadline * proxy_ms, slo.priority);
+            }));
+        }
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+    }, 10);
+
+    ctx.metric("proxy_ms", proxy_ms);
+    for (int c = 0; c < classes_count; c++)
+    {
+        size_t submitted = 0, missed = 0;
+        LatencyHistogram latency;
+        for (int i = c * per_class; i < (c + 1) * per_class; i++)
+        {
+            const EdfScheduler::StreamStats stats = scheduler.stats(i);
+            submitted += stats.submitted;
+            missed    += stats.late + stats.dropped + stats.failed;
+            latency.merge(stats.latency);
+        }
+        ctx.metric(std::string(classes[c].name) + "_miss_rate", submitted ? (double)missed / submitted : 0.);
+        ctx.metric(std::string(classes[c].name) + "_p99_ms", latency.percentile(99));
+    }
+}
+
+// The scheduler behind real pipelines: four synthetic streams in two SLO classes run
+// FramePipelines whose network is EdfScheduler::stream() over two workers, and every
+// frame a pipeline processed must be accounted for once by its stream. Then, with a
+// single worker held, frames queued with deadlines in reverse arrival order must run
+// earliest deadline first; and frames whose work throws count as failed, outside the
+// latency and the service time.
+void bench_edf_streams(BenchContext& ctx)
+{
+    const int streams = 4;
+    const int batch = 10;   // frames per stream per iteration
+
+    SyntheticSource probe(cv::Size(320, 240), FRAME_BGR, 8);
+    Frame frame;
+    probe.read(frame);
+    cv::Mat rgba;
+    cv::cvtColor(frame.data, rgba, cv::COLOR_BGR2RGBA);
+    const double proxy_ms = median_proxy_ms(rgba);
+
+    EdfScheduler::Config config;
+    config.workers = 2;
+    config.streams = streams;
+    EdfScheduler scheduler(config, [](size_t, const cv::Mat& input, cv::Mat& out) { proxy_infer(input, out); });
+
+    std::vector<std::unique_ptr<FramePipeline> > pipelines;
+    for (int i = 0; i < streams; i++)
+    {
+        // even streams display, odd ones analytics
+        const bool display = i % 2 == 0;
+        FramePipeline::Config pipeline_config;
+        pipeline_config.overlay = false;
+        pipelines.push_back(std::unique_ptr<FramePipeline>(new FramePipeline(pipeline_config,
+            cv::makePtr<SyntheticSource>(cv::Size(320, 240), FRAME_BGR, 8), cv::makePtr<NullSink>(),
+            scheduler.stream(i, (display ? 3 : 10) * proxy_ms, display ? 1 : 0))));
+    }
+
+    ctx.measure([&]() {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < streams; i++)
+        {
+            FramePipeline* pipeline = pipelines[i].get();
+            threads.push_back(std::thread([pipeline, batch]() { pipeline->run(batch); }));
+        }
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+    }, 10);
+
+    size_t unaccounted = 0;
+    for (int i = 0; i < streams; i++)
+    {
+        const EdfScheduler::StreamStats stats = scheduler.stats(i);
+        if (stats.submitted != pipelines[i]->frames() || stats.failed != 0 ||
+            stats.done + stats.late + stats.dropped != stats.submitted ||
+            stats.latency.count() != stats.done + stats.late)
+            unaccounted++;
+        ctx.metric(cv::format("stream%d_miss_rate", i), stats.miss_rate());
+    }
+
+    // one worker, held on the first frame until the others queued up. Each frame is a
+    // single pixel holding its submission index, which the worker records.
+    std::mutex gate_mutex;
+    std::condition_variable gate_cv;
+    bool open = false;
+    std::atomic<bool> entered(false);
+    std::vector<int> order;
+
+    EdfScheduler::Config single;
+    single.workers = 1;
+    single.streams = 1;
+    const int queued = 5;
+    std::vector<cv::Mat> pixels;
+    for (int i = 0; i < queued; i++)
+        pixels.push_back(cv::Mat(1, 1, CV_8UC1, cv::Scalar(i)));
+    {
+        EdfScheduler held(single, [&](size_t, const cv::Mat& input, cv::Mat&) {
+            entered = true;
+            std::unique_lock<std::mutex> lock(gate_mutex);
+            gate_cv.wait(lock, [&open]() { return open; });
+            order.push_back(input.at<uchar>(0, 0));
+        });
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < queued; i++)
+        {
+            // the first one takes the worker; the later, the earlier their deadline
+            const double deadline_ms = i == 0 ? 60000 : (queued - i) * 10000.;
+            threads.push_back(std::thread([&held, &pixels, i, deadline_ms]() {
+                cv::Mat out;
+                held.infer(0, pixels[i], out, deadline_ms);
+            }));
+            while (i == 0 ? !entered : held.pending() < (size_t)i)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        {
+            std::lock_guard<std::mutex> lock(gate_mutex);
+            open = true;
+        }
+        gate_cv.notify_all();
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+    }
+    const std::vector<int> expected = { 0, 4, 3, 2, 1 };
+
+    EdfScheduler failing(single, [](size_t, const cv::Mat&, cv::Mat&) { throw std::runtime_error("no network"); });
+    const int attempts = 3;
+    int thrown = 0;
+    for (int i = 0; i < attempts; i++)
+    {
+        try
+        {
+            cv::Mat out;
+            failing.infer(0, rgba, out, 1000);
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown++;
+        }
+    }
+    const EdfScheduler::StreamStats failed = failing.stats(0);
+
+    if (unaccounted > 0)
+        ctx.fail(cv::format("%d of %d streams lost count of their frames", (int)unaccounted, streams));
+    else if (order != expected)
+        ctx.fail("queued frames did not run earliest deadline first");
+    else if (thrown != attempts || failed.failed != (size_t)attempts || failed.done + failed.late != 0 ||
+             failed.latency.count() != 0 || failing.service_ms() != 0)
+        ctx.fail("frames whose work threw were not counted as failed only");
+}
+
+// a frame number as the bytes of one RGBA pixel, low byte first
+cv::Vec4b seq_pixel(uint64 seq)
+{
+    return cv::Vec4b((uchar)seq, (uchar)(seq >> 8), (uchar)(seq >> 16), (uchar)(seq >> 24));
+}
+
+// Producer side of the frame ring: publishing 720p RGBA frames with `readers` consumers
+// attached, each reading every frame it gets in place. Reader 0 also sleeps `slow_ms`
+// per frame, to show a slow consumer is skipped without holding up the producer. The
+// consumers are threads here, attached by name exactly as another process would.
+//
+// The first and last rows of every frame carry its number. A frame release() reports
+// intact must carry the number acquire() gave it at both ends, read before and after
+// using it, and the numbers a reader gets must only increase.
+void bench_ring(BenchContext& ctx, int readers, double slow_ms)
+{
+    FrameRingWriter ring(cv::format("dxring_bench_%lld", (long long)now_us()), SIZE_720P, CV_8UC4, 8);
+    cv::Mat frame(SIZE_720P, CV_8UC4, cv::Scalar(40, 80, 120, 255));
+
+    std::vector<std::unique_ptr<FrameRingReader> > consumers;
+    for (int i = 0; i < readers; i++)
+        consumers.emplace_back(new FrameRingReader(ring.name()));
+
+    std::atomic<bool>   stop(false);
+    std::atomic<uint64> intact(0), mismatched(0), out_of_order(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < readers; i++)
+    {
+        threads.emplace_back([&, i]() {
+            FrameRingReader& reader = *consumers[i];
+            RingFrame f;
+            bool first = true;
+            uint64 last_seq = 0;
+            while (!stop)
+            {
+                if (!reader.acquire(f, 50))
+                    continue;
+
+                if (!first && f.seq <= last_seq)
+                    out_of_order++;
+                first = false;
+                last_seq = f.seq;
+
+                const cv::Vec4b expected = seq_pixel(f.seq);
+                const bool head = f.data.at<cv::Vec4b>(0, 0) == expected;
+                volatile double consumed = cv::sum(f.data)[0];
+                (void)consumed;
+                if (i == 0 && slow_ms > 0)
+                    std::this_thread::sleep_for(std::chrono::microseconds((int64)(slow_ms * 1000)));
+                const bool tail = f.data.at<cv::Vec4b>(f.data.rows - 1, f.data.cols - 1) == expected;
+
+                if (reader.release())
+                {
+                    intact++;
+                    if (!head || !tail)
+                        mismatched++;
+                }
+            }
+        });
+    }
+
+    // stamping the two rows is a small part of the copy into the slot
+    ctx.measure([&]() {
+        const cv::Scalar stamp(seq_pixel(ring.published()));
+        frame.row(0).setTo(stamp);
+        frame.row(frame.rows - 1).setTo(stamp);
+        ring.write(frame, now_us());
+    });
+
+    stop = true;
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+
+    uint64 received = 0, skipped = 0, torn = 0;
+    for (int i = 0; i < readers; i++)
+    {
+        received += consumers[i]->received();
+        skipped  += consumers[i]->skipped();
+        torn     += consumers[i]->torn();
+    }
+
+    ctx.metric("published", (double)ring.published());
+    if (readers > 0)
+    {
+        ctx.metric("received_ratio", (double)received / readers / std::max<uint64>(ring.published(), 1));
+        ctx.metric("intact_ratio", received ? (double)intact / received : 0.);
+        ctx.metric("skipped", (double)skipped);
+        ctx.metric("torn", (double)torn);
+        if (slow_ms > 0)
+            ctx.metric("slow_reader_received", (double)consumers[0]->received());
+    }
+
+    if (mismatched > 0)
+        ctx.fail(cv::format("%d of %d frames reported intact held another frame's pixels", (int)mismatched, (int)intact));
+    else if (out_of_order > 0)
+        ctx.fail(cv::format("%d frames came with a number not above the one before", (int)out_of_order));
+}
+
+// Per-frame cost of the pipeline writing its output: the null sink as the baseline, then a
+// Motion-JPEG VideoWriterSink under `policy` (`video` false for the baseline). With the
+// encoder on its own thread the step should stay near the baseline unless BLOCK has to
+// wait for a full queue.
+void bench_sink(BenchContext& ctx, bool video, VideoWriterSink::Backpressure policy)
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                       cv::format("bench_sink_%d.avi", (int)policy);
+
+    cv::Ptr<VideoWriterSink> writer;
+    cv::Ptr<FrameSink> sink = cv::makePtr<NullSink>();
+    if (video)
+    {
+        VideoWriterSink::Config config;
+        config.path         = path.string();
+        config.backpressure = policy;
+        try
+        {
+            writer = cv::makePtr<VideoWriterSink>(config, SIZE_720P);
+        }
+        catch (const std::exception&)
+        {
+            ctx.skip("can't write a Motion-JPEG clip");
+            return;
+        }
+        sink = writer;
+    }
+
+    FramePipeline::Config config;
+    FramePipeline pipeline(config, cv::makePtr<SyntheticSource>(SIZE_720P, FRAME_BGR, 8), sink);
+
+    ctx.measure([&]() {
+        if (!pipeline.step())
+            throw std::runtime_error("frame source ended");
+    });
+
+    if (writer)
+    {
+        writer->close();
+        ctx.metric("encode_ms", writer->mean_encode_ms());
+        ctx.metric("mean_occupancy", writer->mean_occupancy());
+        ctx.metric("dropped_ratio", writer->consumed() ? (double)writer->dropped() / writer->consumed() : 0.);
+        ctx.metric("blocked_ms", writer->blocked_ms());
+
+        // after close() every consumed frame is either in the clip or dropped
+        const size_t expected = writer->consumed() - writer->dropped();
+        size_t frames = 0;
+        cv::VideoCapture clip(path.string());
+        const bool opened = clip.isOpened();
+        cv::Mat decoded;
+        while (opened && clip.read(decoded))
+            frames++;
+        clip.release();
+
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+
+        if (!opened)
+            ctx.fail("can't open the written clip");
+        else if (frames != expected || writer->written() != expected)
+            ctx.fail(cv::format("%d frames consumed, %d dropped, %d written, %d in the clip", (int)writer->consumed(),
+                                (int)writer->dropped(), (int)writer->written(), (int)frames));
+    }
+}
+
+// Memory for the arena/* benchmarks: OpenCV's own allocator for pages < 0, else an arena
+// asking for `pages`. Single threaded, so the TLB counter sees all of the work.
+std::unique_ptr<HugePageArena> bench_arena(int pages)
+{
+    cv::setNumThreads(1);
+    if (pages < 0)
+        return std::unique_ptr<HugePageArena>();
+
+    HugePageArena::Config config;
+    config.pages = (HugePageArena::Pages)pages;
+    return std::unique_ptr<HugePageArena>(new HugePageArena(config));
+}
+
+void arena_metrics(BenchContext& ctx, const HugePageArena* arena, TlbMissCounter& tlb, uint64 misses, size_t units)
+{
+    if (tlb.available())
+        ctx.metric("dtlb_misses", (double)misses / std::max<size_t>(units, 1));
+    if (arena)
+        ctx.metric("huge_mb", (double)((arena->reserved_bytes(HugePageArena::PAGES_EXPLICIT) +
+                                        arena->reserved_bytes(HugePageArena::PAGES_TRANSPARENT)) >> 20));
+    cv::setNumThreads(-1);
+}
+
+// The serial pipeline with every per-stage frame buffer from the allocator under test;
+// dTLB load misses per frame where the CPU counters can be read
+void bench_arena_pipeline(BenchContext& ctx, cv::Size size, int pages)
+{
+    std::unique_ptr<HugePageArena> arena = bench_arena(pages);
+
+    FramePipeline::Config config;
+    config.allocator = arena ? arena->mat_allocator() : 0;
+    FramePipeline pipeline(config, cv::makePtr<SyntheticSource>(size, FRAME_BGR, 8), cv::makePtr<NullSink>());
+
+    TlbMissCounter tlb;
+    tlb.start();
+    const int64 t0 = cv::getTickCount();
+    ctx.measure([&]() {
+        if (!pipeline.step())
+            throw std::runtime_error("frame source ended");
+    });
+    const double seconds = (cv::getTickCount() - t0) / cv::getTickFrequency();
+    const uint64 misses = tlb.stop();
+
+    ctx.metric("fps", pipeline.frames() / seconds);
+    arena_metrics(ctx, arena.get(), tlb, misses, pipeline.frames());
+}
+
+// Channel sum over a 32x720x1280 f32 activation, the size of the style network's output
+// after its first convolution: 118 MB, planes 3.5 MB apart, read by 32 streams at once.
+// The plugin keeps its own activations; this is the access pattern, on our memory.
+void bench_arena_activation(BenchContext& ctx, int pages)
+{
+    std::unique_ptr<HugePageArena> arena = bench_arena(pages);
+
+    const int channels = 32;
+    const int sizes[] = { channels, SIZE_720P.height, SIZE_720P.width };
+
+    cv::Mat activation, sum;
+    activation.allocator = sum.allocator = arena ? arena->mat_allocator() : 0;
+    activation.create(3, sizes, CV_32F);
+    sum.create(SIZE_720P, CV_32F);
+    cv::randu(cv::Mat(channels * SIZE_720P.height, SIZE_720P.width, CV_32F, activation.data), 0, 1);
+
+    const size_t plane = (size_t)SIZE_720P.area();
+    size_t passes = 0;
+
+    TlbMissCounter tlb;
+    tlb.start();
+    const int64 t0 = cv::getTickCount();
+    ctx.measure([&]() {
+        const float* src = activation.ptr<float>();
+        float* dst = sum.ptr<float>();
+        for (int y = 0; y < SIZE_720P.height; y++)
+        {
+            float* out = dst + (size_t)y * SIZE_720P.width;
+            memcpy(out, src + (size_t)y * SIZE_720P.width, SIZE_720P.width * sizeof(float));
+            for (int c = 1; c < channels; c++)
+            {
+                const float* in = src + c * plane + (size_t)y * SIZE_720P.width;
+                for (int x = 0; x < SIZE_720P.width; x++)
+                    out[x] += in[x];
+            }
+        }
+        passes++;
+    }, 50);
+    const double seconds = (cv::getTickCount() - t0) / cv::getTickFrequency();
+    const uint64 misses = tlb.stop();
+
+    ctx.metric("gb_per_s", (double)activation.total() * sizeof(float) * passes / 1e9 / seconds);
+    arena_metrics(ctx, arena.get(), tlb, misses, passes);
+}
+
+} // namespace
+
+
+void register_pipeline_benchmarks(BenchSuite& suite)
+{
+    const cv::Size sizes[] = { SIZE_720P, SIZE_1080P };
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        const cv::Size size = sizes[i];
+        const std::string res = size_name(size);
+
+        suite.add("pipeline/headless_bgr/" + res, [=](BenchContext& ctx) {
+            bench_headless(ctx, cv::makePtr<SyntheticSource>(size, FRAME_BGR, 8));
+        });
+        suite.add("pipeline/headless_nv12/" + res, [=](BenchContext& ctx) {
+            bench_headless(ctx, cv::makePtr<SyntheticSource>(size, FRAME_NV12, 8));
+        });
+    }
+    suite.add("pipeline/replay", bench_replay);
+    suite.add("pipeline/replay_roundtrip", bench_replay_roundtrip);
+    suite.add("pipeline/watermark/720p", bench_watermark);
+
+    suite.add("pipeline/serial_batch30/720p",       [](BenchContext& ctx) { bench_serial_batch(ctx, FramePipeline::InferFn()); });
+    suite.add("pipeline/flow_batch30/720p",         [](BenchContext& ctx) { bench_flow_batch(ctx, FramePipeline::InferFn()); });
+    suite.add("pipeline/serial_batch30_proxy/720p", [](BenchContext& ctx) { bench_serial_batch(ctx, proxy_infer); });
+    suite.add("pipeline/flow_batch30_proxy/720p",   [](BenchContext& ctx) { bench_flow_batch(ctx, proxy_infer); });
+
+    suite.add("quality/synthetic_load",  bench_quality_synthetic);
+    suite.add("quality/pipeline_reduced", bench_quality_pipeline);
+
+    suite.add("budget/streams4_proxy/default",  [](BenchContext& ctx) { bench_streams(ctx, 4, DEFAULT_POOLS); });
+    suite.add("budget/streams4_proxy/budget",   [](BenchContext& ctx) { bench_streams(ctx, 4, BUDGET); });
+    suite.add("budget/streams4_proxy/numa",     [](BenchContext& ctx) { bench_streams(ctx, 4, BUDGET_NUMA); });
+
+    suite.add("strategy/pipeline/temporal", [](BenchContext& ctx) { bench_strategy_pipeline(ctx, InferStrategy::MODE_TEMPORAL, 2); });
+    suite.add("strategy/pipeline/change",   [](BenchContext& ctx) { bench_strategy_pipeline(ctx, InferStrategy::MODE_CHANGE, 0); });
+    suite.add("strategy/pipeline/tiles",    [](BenchContext& ctx) { bench_strategy_pipeline(ctx, InferStrategy::MODE_TILES, 0); });
+
+    suite.add("temporal/full_inference/720p", bench_full_inference);
+    suite.add("temporal/reuse_slow/720p",     [](BenchContext& ctx) { bench_temporal_reuse(ctx, 2); });
+    suite.add("temporal/reuse_fast/720p",     [](BenchContext& ctx) { bench_temporal_reuse(ctx, 16); });
+
+    suite.add("change/static/720p",   [](BenchContext& ctx) { bench_change_detector(ctx, 0); });
+    suite.add("change/dynamic/720p",  [](BenchContext& ctx) { bench_change_detector(ctx, 8); });
+
+    suite.add("tile/restyle/720p",    [](BenchContext& ctx) { bench_tile_restyler(ctx, 8); });
+    suite.add("tile/windows/720p",    bench_tile_windows);
+
+    suite.add("sched/slo6/fifo", [](BenchContext& ctx) { bench_edf(ctx, false); });
+    suite.add("sched/slo6/edf",  [](BenchContext& ctx) { bench_edf(ctx, true); });
+    suite.add("sched/streams/check", bench_edf_streams);
+
+    for (int readers = 0; readers <= 8; readers = readers ? readers * 2 : 1)
+        suite.add(cv::format("ring/720p/readers%d", readers), [=](BenchContext& ctx) { bench_ring(ctx, readers, 0); });
+    suite.add("ring/720p/readers4_slow", [](BenchContext& ctx) { bench_ring(ctx, 4, 20); });
+
+    const char* arenas[] = { "opencv", "default", "transparent", "explicit" };
+    for (int pages = -1; pages <= HugePageArena::PAGES_EXPLICIT; pages++)
+    {
+        const std::string name = arenas[pages + 1];
+        suite.add("arena/pipeline/1080p/" + name, [=](BenchContext& ctx) { bench_arena_pipeline(ctx, SIZE_1080P, pages); });
+        suite.add("arena/pipeline/2160p/" + name, [=](BenchContext& ctx) { bench_arena_pipeline(ctx, SIZE_2160P, pages); });
+        suite.add("arena/activation/720p/" + name, [=](BenchContext& ctx) { bench_arena_activation(ctx, pages); });
+    }
+
+    suite.add("sink/720p/null",              [](BenchContext& ctx) { bench_sink(ctx, false, VideoWriterSink::BLOCK); });
+    suite.add("sink/720p/video_block",       [](BenchContext& ctx) { bench_sink(ctx, true, VideoWriterSink::BLOCK); });
+    suite.add("sink/720p/video_drop_newest", [](BenchContext& ctx) { bench_sink(ctx, true, VideoWriterSink::DROP_NEWEST); });
+    suite.add("sink/720p/video_drop_oldest", [](BenchContext& ctx) { bench_sink(ctx, true, VideoWriterSink::DROP_OLDEST); });
+}
@@ -0,0 +1,509 @@
+/*
+// Benchmark suite for the frame pipeline: registry, timing and result collection
+//
+// Usage:
+//   Benchmark --out=results.json                     run everything, store results
+//   Benchmark --filter=blur --baseline=base.json     run a subset, flag regressions
+//   Benchmark --current=new.json --baseline=base.json  compare two stored runs
+// The exit code is 1 if any benchmark failed a check or regressed against the baseline.
+*/
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+#include "opencv2/imgproc.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "color_convert.hpp"
+#include "inference_server.hpp"
+#include "segment_job.hpp"
+
+const cv::Size SIZE_720P(1280, 720);
+const cv::Size SIZE_1080P(1920, 1080);
+const cv::Size SIZE_2160P(3840, 2160);
+
+std::string size_name(cv::Size size)
+{
+    if (size == SIZE_720P)
+        return "720p";
+    if (size == SIZE_1080P)
+        return "1080p";
+    if (size == SIZE_2160P)
+        return "2160p";
+    return cv::format("%dx%d", size.width, size.height);
+}
+
+
+#ifdef __linux__
+
+TlbMissCounter::TlbMissCounter()
+{
+    perf_event_attr attr = {};
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HW_CACHE;
+    attr.config         = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled       = 1;
+    attr.inherit        = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    m_fd = (int)::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+
+TlbMissCounter::~TlbMissCounter()
+{
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+
+void TlbMissCounter::start()
+{
+    if (m_fd < 0)
+        return;
+    ::ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+    ::ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+
+uint64 TlbMissCounter::stop()
+{
+    if (m_fd < 0)
+        return 0;
+    ::ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+
+    uint64 count = 0;
+    if (::read(m_fd, &count, sizeof(count)) != (ssize_t)sizeof(count))
+        return 0;
+    return count;
+}
+
+#else
+
+TlbMissCounter::TlbMissCounter() : m_fd(-1) {}
+TlbMissCounter::~TlbMissCounter() {}
+void TlbMissCounter::start() {}
+uint64 TlbMissCounter::stop() { return 0; }
+
+#endif
+
+
+void BenchContext::measure(const std::function<void()>& body, int max_iters)
+{
+    const int limit = max_iters > 0 ? std::min(max_iters, m_options.max_iters) : m_options.max_iters;
+    const int min_iters = std::min(m_options.min_iters, limit);
+
+    for (int i = 0; i < m_options.warmup && i < limit; i++)
+        body();
+
+    std::vector<double> samples;
+    const double freq = cv::getTickFrequency();
+    double total_ms = 0;
+    while ((int)samples.size() < limit && (total_ms < m_options.min_time_ms || (int)samples.size() < min_iters))
+    {
+        const int64 t0 = cv::getTickCount();
+        body();
+        const double ms = (cv::getTickCount() - t0) * 1000. / freq;
+        samples.push_back(ms);
+        total_ms += ms;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    const size_t n = samples.size();
+
+    double sq = 0;
+    const double mean = total_ms / n;
+    for (size_t i = 0; i < n; i++)
+        sq += (samples[i] - mean) * (samples[i] - mean);
+
+    m_result.iterations = (int)n;
+    m_result.mean_ms    = mean;
+    m_result.median_ms  = n % 2 ? samples[n / 2] : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+    m_result.min_ms     = samples[0];
+    m_result.p90_ms     = samples[std::min(n - 1, (size_t)std::ceil(0.9 * n) - 1)];
+    m_result.stddev_ms  = std::sqrt(sq / n);
+}
+
+
+void BenchSuite::add(const std::string& name, const BenchFn& fn)
+{
+    m_benchmarks.push_back(std::make_pair(name, fn));
+}
+
+
+std::vector<std::string> BenchSuite::names() const
+{
+    std::vector<std::string> names;
+    for (size_t i = 0; i < m_benchmarks.size(); i++)
+        names.push_back(m_benchmarks[i].first);
+    return names;
+}
+
+
+std::vector<BenchResult> BenchSuite::run(const BenchOptions& options, const std::string& filter, std::ostream& log) const
+{
+    std::vector<BenchResult> results;
+
+    for (size_t i = 0; i < m_benchmarks.size(); i++)
+    {
+        const std::string& name = m_benchmarks[i].first;
+        if (!filter.empty() && name.find(filter) == std::string::npos)
+            continue;
+
+        BenchResult result;
+        result.name = name;
+        log << std::left << std::setw(48) << name << std::flush;
+
+        try
+        {
+            BenchContext ctx(options, result);
+            m_benchmarks[i].second(ctx);
+        }
+        catch (const std::exception& e)
+        {
+            result.iterations = 0;
+            result.skipped = e.what();
+        }
+
+        if (!result.skipped.empty() || result.iterations == 0)
+        {
+            if (result.skipped.empty())
+                result.skipped = "nothing measured";
+            log << "skipped: " << result.skipped << std::endl;
+        }
+        else
+        {
+            log << std::right << std::fixed << std::setprecision(3)
+                << std::setw(10) << result.median_ms << " ms (min " << result.min_ms
+                << ", p90 " << result.p90_ms << ", n=" << result.iterations << ")";
+            for (std::map<std::string, double>::const_iterator it = result.metrics.begin(); it != result.metrics.end(); ++it)
+                log << " " << it->first << "=" << it->second;
+            log << std::endl;
+        }
+        if (!result.failed.empty())
+            log << std::left << std::setw(48) << "" << "FAILED: " << result.failed << std::endl;
+
+        results.push_back(result);
+    }
+
+    return results;
+}
+
+
+void write_results(const std::string& path, const std::vector<BenchResult>& results)
+{
+    cv::FileStorage fs(path, cv::FileStorage::WRITE | cv::FileStorage::FORMAT_JSON);
+    if (!fs.isOpened())
+        throw std::runtime_error("can't write " + path);
+
+    fs << "schema" << 1;
+    fs << "opencv" << CV_VERSION;
+    fs << "threads" << cv::getNumThreads();
+    fs << "avx2" << (int)cv::checkHardwareSupport(CV_CPU_AVX2);
+
+    fs << "results" << "[";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult& r = results[i];
+        fs << "{";
+        fs << "name" << r.name;
+        fs << "iterations" << r.iterations;
+        fs << "mean_ms" << r.mean_ms;
+        fs << "median_ms" << r.median_ms;
+        fs << "min_ms" << r.min_ms;
+        fs << "p90_ms" << r.p90_ms;
+        fs << "stddev_ms" << r.stddev_ms;
+        if (!r.skipped.empty())
+            fs << "skipped" << r.skipped;
+        if (!r.failed.empty())
+            fs << "failed" << r.failed;
+        fs << "metrics" << "{";
+        for (std::map<std::string, double>::const_iterator it = r.metrics.begin(); it != r.metrics.end(); ++it)
+            fs << it->first << it->second;
+        fs << "}";
+        fs << "}";
+    }
+    fs << "]";
+}
+
+
+std::vector<BenchResult> read_results(const std::string& path)
+{
+    cv::FileStorage fs(path, cv::FileStorage::READ | cv::FileStorage::FORMAT_JSON);
+    if (!fs.isOpened())
+        throw std::runtime_error("can't read " + path);
+
+    cv::FileNode nodes = fs["results"];
+    if (!nodes.isSeq())
+        throw std::runtime_error(path + " has no benchmark results");
+
+    std::vector<BenchResult> results;
+    for (cv::FileNodeIterator it = nodes.begin(); it != nodes.end(); ++it)
+    {
+        const cv::FileNode node = *it;
+        BenchResult r;
+        node["name"]       >> r.name;
+        node["iterations"] >> r.iterations;
+        node["mean_ms"]    >> r.mean_ms;
+        node["median_ms"]  >> r.median_ms;
+        node["min_ms"]     >> r.min_ms;
+        node["p90_ms"]     >> r.p90_ms;
+        node["stddev_ms"]  >> r.stddev_ms;
+        if (!node["skipped"].empty())
+            node["skipped"] >> r.skipped;
+        if (!node["failed"].empty())
+            node["failed"] >> r.failed;
+
+        const cv::FileNode metrics = node["metrics"];
+        for (cv::FileNodeIterator m = metrics.begin(); m != metrics.end(); ++m)
+            r.metrics[(*m).name()] = (double)*m;
+
+        results.push_back(r);
+    }
+    return results;
+}
+
+
+int compare_results(const std::vector<BenchResult>& baseline, const std::vector<BenchResult>& current,
+                    double threshold, const std::string& filter, std::ostream& out)
+{
+    std::map<std::string, const BenchResult*> base, now;
+    for (size_t i = 0; i < baseline.size(); i++)
+        base[baseline[i].name] = &baseline[i];
+    for (size_t i = 0; i < current.size(); i++)
+        now[current[i].name] = &current[i];
+
+    int regressions = 0, failures = 0;
+    out << std::left << std::setw(48) << "benchmark" << std::right
+        << std::setw(12) << "base ms" << std::setw(12) << "current ms" << std::setw(10) << "change" << std::endl;
+
+    // a benchmark that stopped running must not pass for one that didn't slow down
+    for (size_t i = 0; i < baseline.size(); i++)
+    {
+        const BenchResult& before = baseline[i];
+        if (!before.skipped.empty() || (!filter.empty() && before.name.find(filter) == std::string::npos))
+            continue;
+
+        std::map<std::string, const BenchResult*>::const_iterator it = now.find(before.name);
+        if (it != now.end() && it->second->skipped.empty())
+            continue;
+
+        out << std::left << std::setw(48) << before.name << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << before.median_ms << std::setw(12) << "-" << std::setw(10) << "-"
+            << (it == now.end() ? "  MISSING" : "  SKIPPED: " + it->second->skipped) << std::endl;
+        failures++;
+    }
+
+    for (size_t i = 0; i < current.size(); i++)
+    {
+        const BenchResult& cur = current[i];
+        if (!cur.failed.empty())
+        {
+            out << std::left << std::setw(48) << cur.name << std::right << std::setw(34) << "-"
+                << "  FAILED: " << cur.failed << std::endl;
+            failures++;
+            continue;
+        }
+        if (!cur.skipped.empty())
+            continue;
+
+        out << std::left << std::setw(48) << cur.name << std::right << std::fixed << std::setprecision(3);
+
+        std::map<std::string, const BenchResult*>::const_iterator it = base.find(cur.name);
+        if (it == base.end() || !it->second->skipped.empty() || it->second->median_ms <= 0)
+        {
+            out << std::setw(12) << "-" << std::setw(12) << cur.median_ms << std::setw(10) << "new" << std::endl;
+            continue;
+        }
+
+        const double before = it->second->median_ms;
+        const double change = cur.median_ms / before - 1;
+        out << std::setw(12) << before << std::setw(12) << cur.median_ms
+            << std::setw(9) << std::setprecision(1) << std::showpos << change * 100 << "%" << std::noshowpos;
+
+        if (change > threshold)
+        {
+            out << "  REGRESSION";
+            regressions++;
+        }
+        else if (change < -threshold)
+        {
+            out << "  improved";
+        }
+        out << std::endl;
+    }
+
+    out << regressions << " regression(s) above " << threshold * 100 << "%, "
+        << failures << " benchmark(s) failed, skipped or missing" << std::endl;
+    return regressions + failures;
+}
+
+
+SyntheticSource::SyntheticSource(cv::Size size, FrameFormat format, double speed, size_t frames) :
+    m_size(size),
+    m_format(format),
+    m_speed(speed),
+    m_frames(frames),
+    m_seq(0)
+{
+    CV_Assert(format == FRAME_BGR || (size.width % 2 == 0 && size.height % 2 == 0));
+
+    // smooth, fixed-seed texture: coarse noise upscaled, so optical flow has structure to lock on
+    cv::RNG rng(0x5eed);
+    cv::Mat coarse(std::max(size.height / 16, 2), std::max(size.width / 16, 2), CV_8UC3);
+    rng.fill(coarse, cv::RNG::UNIFORM, 0, 256);
+    cv::resize(coarse, m_background, size, 0, 0, cv::INTER_CUBIC);
+}
+
+
+bool SyntheticSource::read(Frame& frame)
+{
+    if (m_frames && m_seq >= m_frames)
+        return false;
+    frame.timestamp_us = now_us();   // grabbed before it is drawn, as a camera's
+
+    // BGR frames are drawn straight into frame.data, so earlier frames stay intact
+    cv::Mat& bgr = m_format == FRAME_NV12 ? m_bgr : frame.data;
+    m_background.copyTo(bgr);
+    if (m_speed != 0)
+    {
+        const int radius = std::max(m_size.height / 8, 4);
+        const int travel = m_size.width + 2 * radius;
+        const int x = (int)std::fmod(m_speed * m_seq, (double)travel) - radius;
+        const cv::Point center(x, m_size.height / 2);
+        cv::circle(bgr, center, radius, cv::Scalar(240, 240, 240), cv::FILLED);
+        cv::circle(bgr, center, radius / 2, cv::Scalar(40, 40, 200), cv::FILLED);
+    }
+
+    if (m_format == FRAME_NV12)
+    {
+        cv::cvtColor(m_bgr, m_i420, cv::COLOR_BGR2YUV_I420);
+        convert_I420_to_NV12(m_i420, frame.data, m_size.width, m_size.height);
+    }
+
+    frame.format = m_format;
+    frame.seq    = m_seq++;
+    return true;
+}
+
+
+static const char* keys =
+{
+    "{h help   |       | print this message }"
+    "{list     | false | list benchmarks and exit }"
+    "{filter   |       | run only benchmarks whose name contains this string }"
+    "{o out    |       | write results to this JSON file }"
+    "{baseline |       | compare against results stored by an earlier run }"
+    "{current  |       | compare this stored result file instead of running benchmarks }"
+    "{threshold | 0.10 | relative slowdown of the median reported as a regression }"
+    "{min_time | 300   | minimum measured time per benchmark, ms }"
+    "{warmup   | 2     | untimed iterations before measuring }"
+    "{model    | models/model_composition_v5_no_padding.xml | OpenVINO model for the cnn benchmarks }"
+    "{device   | CPU   | OpenVINO device for the cnn benchmarks }"
+    "{replay   |       | frame recording for the pipeline/replay benchmark }"
+    "{max_spike_ratio | 3 | slowest frame during model reloads, in steady-state medians, that fails cnn/hot_reload }"
+    "{latency  | false | print the stage latency breakdown of every pipeline benchmark }"
+    "{serve    |       | internal: inference server process of the ipc benchmarks }"
+    "{segment_worker | | internal: worker process of the offline/segments benchmarks }"
+};
+
+
+int main(int argc, char** argv)
+{
+    cv::CommandLineParser parser(argc, argv, keys);
+    parser.about("\nBenchmarks for the frame pipeline and the style network.\n");
+
+    const std::string segment_task = parser.get<std::string>("segment_worker");
+    if (!segment_task.empty())
+        return run_segment_worker(segment_task);
+
+    const std::string serve = parser.get<std::string>("serve");
+    if (!serve.empty())
+    {
+        InferenceServer::Config config;
+        config.socket_path = serve;
+        config.model       = parser.get<std::string>("model");
+        config.device      = parser.get<std::string>("device");
+        return run_inference_server(config);
+    }
+
+    if (parser.has("help"))
+    {
+        parser.printMessage();
+        return EXIT_SUCCESS;
+    }
+
+    BenchSuite suite;
+    register_color_benchmarks(suite);
+    register_filter_benchmarks(suite);
+    register_pipeline_benchmarks(suite);
+    register_cnn_benchmarks(suite);
+
+    if (parser.get<bool>("list"))
+    {
+        std::vector<std::string> names = suite.names();
+        for (size_t i = 0; i < names.size(); i++)
+            std::cout << names[i] << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    BenchOptions options;
+    options.min_time_ms = parser.get<double>("min_time");
+    options.warmup      = parser.get<int>("warmup");
+    options.model       = parser.get<std::string>("model");
+    options.device      = parser.get<std::string>("device");
+    options.replay      = parser.get<std::string>("replay");
+    options.max_spike_ratio = parser.get<double>("max_spike_ratio");
+    options.latency     = parser.get<bool>("latency");
+
+    const std::string out      = parser.get<std::string>("out");
+    const std::string baseline = parser.get<std::string>("baseline");
+    const std::string current  = parser.get<std::string>("current");
+    const std::string filter   = parser.get<std::string>("filter");
+
+    if (!parser.check())
+    {
+        parser.printErrors();
+        return 2;
+    }
+
+    try
+    {
+        std::vector<BenchResult> results;
+        if (!current.empty())
+            results = read_results(current);
+        else
+            results = suite.run(options, filter, std::cout);
+
+        if (!out.empty())
+            write_results(out, results);
+
+        if (!baseline.empty())
+        {
+            std::cout << std::endl;
+            return compare_results(read_results(baseline), results, parser.get<double>("threshold"), filter, std::cout) ? 1 : 0;
+        }
+
+        for (size_t i = 0; i < results.size(); i++)
+            if (!results[i].failed.empty())
+                return 1;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return 2;
+    }
+
+    return EXIT_SUCCESS;
+}
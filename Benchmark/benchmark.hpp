@@ -0,0 +1,153 @@
+/*
+// Benchmark suite for the frame pipeline: registry, timing and result collection
+*/
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "opencv2/core.hpp"
+
+#include "frame_source.hpp"
+
+struct BenchOptions
+{
+    double      min_time_ms = 300;   // per benchmark, after warmup
+    int         min_iters   = 5;
+    int         max_iters   = 1000;
+    int         warmup      = 2;
+    std::string model;               // OpenVINO IR for the cnn/* benchmarks
+    std::string device      = "CPU";
+    std::string replay;              // recording for pipeline/replay
+    double      max_spike_ratio = 3; // cnn/hot_reload: slowest frame in steady-state medians
+    bool        latency     = false; // pipeline/*: print FrameLatency of every run
+};
+
+struct BenchResult
+{
+    std::string name;
+    int         iterations = 0;
+    double      mean_ms    = 0;
+    double      median_ms  = 0;
+    double      min_ms     = 0;
+    double      p90_ms     = 0;
+    double      stddev_ms  = 0;
+    std::map<std::string, double> metrics;   // benchmark specific: psnr, skip ratio, ...
+    std::string skipped;                     // reason, if the benchmark could not run
+    std::string failed;                      // reason, if one of its checks failed
+};
+
+// Handed to every benchmark. A benchmark sets up its data, then calls measure() once
+// with the code under test; anything else it wants reported goes through metric().
+class BenchContext
+{
+public:
+    BenchContext(const BenchOptions& options, BenchResult& result) : m_options(options), m_result(result) {}
+
+    const BenchOptions& options() const { return m_options; }
+
+    // time `body` repeatedly; max_iters overrides the suite setting for expensive bodies
+    void measure(const std::function<void()>& body, int max_iters = 0);
+
+    void metric(const std::string& name, double value) { m_result.metrics[name] = value; }
+
+    // mark the benchmark as not applicable in this environment
+    void skip(const std::string& reason) { m_result.skipped = reason; }
+
+    // a result the benchmark checks is wrong, or a limit it enforces was exceeded; the
+    // timings are still reported, the run exits with 1. The first reason is kept.
+    void fail(const std::string& reason)
+    {
+        if (m_result.failed.empty())
+            m_result.failed = reason;
+    }
+
+private:
+    const BenchOptions& m_options;
+    BenchResult&        m_result;
+};
+
+typedef std::function<void(BenchContext&)> BenchFn;
+
+class BenchSuite
+{
+public:
+    void add(const std::string& name, const BenchFn& fn);
+
+    std::vector<std::string> names() const;
+
+    // run benchmarks whose name contains `filter` (all if empty)
+    std::vector<BenchResult> run(const BenchOptions& options, const std::string& filter, std::ostream& log) const;
+
+private:
+    std::vector<std::pair<std::string, BenchFn> > m_benchmarks;
+};
+
+void register_color_benchmarks(BenchSuite& suite);
+void register_filter_benchmarks(BenchSuite& suite);
+void register_pipeline_benchmarks(BenchSuite& suite);
+void register_cnn_benchmarks(BenchSuite& suite);
+
+// JSON results
+void write_results(const std::string& path, const std::vector<BenchResult>& results);
+std::vector<BenchResult> read_results(const std::string& path);
+
+// Print current vs. baseline medians; returns the number of benchmarks slower than the
+// baseline by more than `threshold` (relative, e.g. 0.1 for 10%), plus those that failed
+// now, and those measured in the baseline that are now skipped or, if their name contains
+// `filter`, missing.
+int compare_results(const std::vector<BenchResult>& baseline, const std::vector<BenchResult>& current,
+                    double threshold, const std::string& filter, std::ostream& out);
+
+// Deterministic synthetic video: a textured background with a bright disc moving across
+// it `speed` pixels per frame (0 - static scene). Useful where real content is needed
+// for reproducible numbers but no recording is available.
+class SyntheticSource : public FrameSource
+{
+public:
+    SyntheticSource(cv::Size size, FrameFormat format, double speed, size_t frames = 0);
+
+    bool read(Frame& frame);
+    cv::Size size() const { return m_size; }
+    FrameFormat format() const { return m_format; }
+
+private:
+    cv::Size    m_size;
+    FrameFormat m_format;
+    double      m_speed;
+    size_t      m_frames;   // 0 - endless
+    uint64      m_seq;
+    cv::Mat     m_background;
+    cv::Mat     m_bgr;
+    cv::Mat     m_i420;
+};
+
+// common resolutions
+extern const cv::Size SIZE_720P;
+extern const cv::Size SIZE_1080P;
+extern const cv::Size SIZE_2160P;
+
+std::string size_name(cv::Size size);
+
+// Data TLB load misses of the calling thread, and of threads it starts later, from the
+// CPU's performance counters (perf_event_open on Linux). Not available on other systems,
+// in most VMs, or where perf_event_paranoid forbids it; benchmarks then report time only.
+class TlbMissCounter
+{
+public:
+    TlbMissCounter();
+    ~TlbMissCounter();
+
+    bool available() const { return m_fd >= 0; }
+
+    void start();
+    uint64 stop();   // misses since start()
+
+private:
+    TlbMissCounter(const TlbMissCounter&);
+    TlbMissCounter& operator=(const TlbMissCounter&);
+
+    int m_fd;
+};
@@ -0,0 +1,195 @@
+/*
+// Dynamic batching: frames of several streams coalesced into one inference
+*/
+#include "batch_coalescer.hpp"
+
+#include <chrono>
+
+#include "opencv2/imgproc.hpp"
+
+BatchCoalescer::BatchCoalescer(const Config& config, ov::CompiledModel compiled) :
+    m_config(config),
+    m_stop(false),
+    m_latency(config.streams),
+    m_batches(0),
+    m_batched_frames(0)
+{
+    CV_Assert(config.max_batch > 0 && config.streams > 0);
+
+    m_request = compiled.create_infer_request();
+
+    ov::Tensor input = m_request.get_input_tensor();
+    const ov::Shape input_shape = input.get_shape();
+    CV_Assert(input_shape.size() == 4 && input_shape[0] == config.max_batch &&
+              input_shape[1] == (size_t)config.input_size.height &&
+              input_shape[2] == (size_t)config.input_size.width && input_shape[3] == 3);
+
+    uchar* data = (uchar*)input.data<uint8_t>();
+    const size_t item = (size_t)config.input_size.area() * 3;
+    for (size_t i = 0; i < config.max_batch; i++)
+        m_inputs.push_back(cv::Mat(config.input_size, CV_8UC3, data + i * item));
+
+    const ov::Shape output_shape = compiled.output().get_shape();
+    CV_Assert(output_shape.size() >= 2 && output_shape[0] == config.max_batch);
+    m_output_item = 1;
+    for (size_t i = 1; i < output_shape.size(); i++)
+    {
+        m_output_dims.push_back((int)output_shape[i]);
+        m_output_item *= output_shape[i];
+    }
+
+    m_worker = std::thread(&BatchCoalescer::run, this);
+}
+
+
+BatchCoalescer::~BatchCoalescer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_arrived.notify_all();
+    m_worker.join();
+}
+
+
+void BatchCoalescer::infer(int stream, const cv::Mat& rgba, cv::Mat& output)
+{
+    CV_Assert(stream >= 0 && stream < m_config.streams && rgba.type() == CV_8UC4);
+
+    Request request;
+    request.stream    = stream;
+    request.rgba      = &rgba;
+    request.output    = &output;
+    request.submitted = cv::getTickCount();
+    request.done      = false;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_stop)
+        throw std::runtime_error("BatchCoalescer is stopped");
+
+    m_queue.push_back(&request);
+    m_arrived.notify_one();
+    m_finished.wait(lock, [&request]() { return request.done; });
+
+    if (!request.error.empty())
+        throw std::runtime_error(request.error);
+}
+
+
+void BatchCoalescer::run()
+{
+    std::vector<Request*> batch;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_arrived.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+            if (m_stop)
+                break;
+
+            // the oldest frame waits at most max_wait_ms for others to join it
+            const int64 oldest = m_queue.front()->submitted;
+            const std::chrono::microseconds wait((int64)(m_config.max_wait_ms * 1000.) -
+                (int64)((cv::getTickCount() - oldest) * 1e6 / cv::getTickFrequency()));
+            m_arrived.wait_for(lock, wait, [this]() { return m_stop || m_queue.size() >= m_config.max_batch; });
+            if (m_stop)
+                break;
+
+            batch.clear();
+            while (!m_queue.empty() && batch.size() < m_config.max_batch)
+            {
+                batch.push_back(m_queue.front());
+                m_queue.pop_front();
+            }
+        }
+
+        // callers are blocked in infer(), so their frames and outputs stay valid
+        process(batch);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const int64 now = cv::getTickCount();
+            for (size_t i = 0; i < batch.size(); i++)
+            {
+                m_latency[batch[i]->stream].add((now - batch[i]->submitted) * 1000. / cv::getTickFrequency());
+                batch[i]->done = true;
+            }
+            m_batches++;
+            m_batched_frames += batch.size();
+        }
+        m_finished.notify_all();
+    }
+
+    // fail whatever is still queued
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_queue.size(); i++)
+    {
+        m_queue[i]->error = "BatchCoalescer stopped";
+        m_queue[i]->done  = true;
+    }
+    m_queue.clear();
+    m_finished.notify_all();
+}
+
+
+void BatchCoalescer::process(std::vector<Request*>& batch)
+{
+    try
+    {
+        // gather
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            const cv::Mat& rgba = *batch[i]->rgba;
+            if (rgba.size() == m_config.input_size)
+            {
+                cv::cvtColor(rgba, m_inputs[i], cv::COLOR_RGBA2RGB);
+            }
+            else
+            {
+                cv::resize(rgba, m_resized, m_config.input_size, 0, 0, cv::INTER_LINEAR);
+                cv::cvtColor(m_resized, m_inputs[i], cv::COLOR_RGBA2RGB);
+            }
+        }
+
+        m_request.infer();
+
+        // scatter
+        const float* out = m_request.get_output_tensor().data<float>();
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            const cv::Mat slice((int)m_output_dims.size(), m_output_dims.data(), CV_32F,
+                                (void*)(out + i * m_output_item));
+            slice.copyTo(*batch[i]->output);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        for (size_t i = 0; i < batch.size(); i++)
+            batch[i]->error = e.what();
+    }
+}
+
+
+LatencyHistogram BatchCoalescer::latency(int stream) const
+{
+    CV_Assert(stream >= 0 && stream < m_config.streams);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_latency[stream];
+}
+
+
+size_t BatchCoalescer::batches() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_batches;
+}
+
+
+double BatchCoalescer::mean_batch_size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_batches ? (double)m_batched_frames / m_batches : 0.;
+}
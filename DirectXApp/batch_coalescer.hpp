@@ -0,0 +1,85 @@
+/*
+// Dynamic batching: frames of several streams coalesced into one inference
+*/
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "opencv2/core.hpp"
+#include "openvino/openvino.hpp"
+
+#include "latency_histogram.hpp"
+
+// Streams hand their frames to infer(), which blocks until the frame's result is back.
+// A worker thread collects pending frames into one batch until max_batch frames are
+// there or max_wait_ms has passed since the oldest arrived, fills the batched input
+// tensor, runs one inference and scatters the output slices back to the callers. A
+// partial batch runs at the compiled batch size with the unused slots left as they were.
+//
+// The model must be compiled for batch max_batch with the host input of
+// prepare_host_input(model, input_size, max_batch).
+class BatchCoalescer
+{
+public:
+    struct Config
+    {
+        size_t   max_batch   = 4;
+        double   max_wait_ms = 5;
+        cv::Size input_size  = cv::Size(640, 480);
+        int      streams     = 1;    // latency is tracked per stream id in [0, streams)
+    };
+
+    BatchCoalescer(const Config& config, ov::CompiledModel compiled);
+
+    // stops the worker; frames still waiting fail with an exception in their callers
+    ~BatchCoalescer();
+
+    // infer an RGBA frame of any size for `stream`; `output` receives this frame's slice
+    // of the network output as CV_32F with the output's dimensions minus the batch.
+    // Thread safe, and meant to be called from one thread per stream.
+    void infer(int stream, const cv::Mat& rgba, cv::Mat& output);
+
+    // submission to result, per stream
+    LatencyHistogram latency(int stream) const;
+
+    size_t batches() const;
+    double mean_batch_size() const;
+
+private:
+    struct Request
+    {
+        int            stream;
+        const cv::Mat* rgba;
+        cv::Mat*       output;
+        int64          submitted;
+        bool           done;
+        std::string    error;     // set instead of output on failure
+    };
+
+    void run();
+    void process(std::vector<Request*>& batch);
+
+    Config                        m_config;
+    ov::InferRequest              m_request;
+    std::vector<int>              m_output_dims;   // without the batch dimension
+    size_t                        m_output_item;   // floats per batch item
+    std::vector<cv::Mat>          m_inputs;        // per batch slot, views of the input tensor
+    cv::Mat                       m_resized;
+
+    mutable std::mutex            m_mutex;
+    std::condition_variable       m_arrived;
+    std::condition_variable       m_finished;
+    std::deque<Request*>          m_queue;
+    bool                          m_stop;
+
+    std::vector<LatencyHistogram> m_latency;
+    size_t                        m_batches;
+    size_t                        m_batched_frames;
+
+    std::thread                   m_worker;
+};
@@ -0,0 +1,354 @@
+/*
+// In-place normalized box filter for 8-bit RGBA frames
+//
+// Each row band keeps a ring of horizontally summed rows (ksize.height rows of ushort)
+// and a column sum (int) per element. For every output row one new horizontal sum is
+// added and the oldest one subtracted, so both passes are O(1) per pixel.
+//
+// In-place operation: output row y is written only after the horizontal sum of the last
+// source row it depends on has been taken, so within a band the source is always read
+// before it is overwritten. Rows outside a band (and the bottom border, which reflects
+// back into already written rows) are copied aside before any band starts writing.
+*/
+#include "box_filter.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "opencv2/imgproc.hpp"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#define BOX_FILTER_AVX2 1
+#define BOX_FILTER_AVX2_TARGET
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BOX_FILTER_AVX2 1
+#define BOX_FILTER_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define BOX_FILTER_AVX2 0
+#endif
+
+namespace
+{
+
+const int CN = 4;
+
+// Same rounding as cv::blur for 8-bit data: fixed-point division for kernels of up to
+// 256 elements (OpenCV sums those in ushort), float scale above that.
+struct BoxScale
+{
+    enum { SHIFT = 23 };
+
+    explicit BoxScale(int area)
+    {
+        fixed_point = area <= 256;
+        fscale = (float)(1. / area);
+
+        double scalef = ((double)(1 << SHIFT)) / area;
+        ds = (unsigned)cvFloor(scalef);
+        scalef -= ds;
+        dd = (unsigned)(area / 2);
+        if (scalef < 0.5)
+            dd++;
+        else
+            ds++;
+    }
+
+    uchar operator()(int s) const
+    {
+        if (fixed_point)
+            return (uchar)(((unsigned)s + dd) * ds >> SHIFT);
+        return cv::saturate_cast<uchar>((float)s * fscale);
+    }
+
+    bool     fixed_point;
+    unsigned ds;
+    unsigned dd;
+    float    fscale;
+};
+
+
+// Horizontal pass for one row: hsum[x] = sum of ksize pixels of the border-extended row,
+// per channel. `pad` must hold width + ksize - 1 pixels.
+void row_sum_scalar(const uchar* pad, ushort* hsum, int width, int ksize)
+{
+    int s[CN] = { 0, 0, 0, 0 };
+    for (int i = 0; i < ksize; i++)
+        for (int c = 0; c < CN; c++)
+            s[c] += pad[i * CN + c];
+    for (int c = 0; c < CN; c++)
+        hsum[c] = (ushort)s[c];
+
+    for (int x = 1; x < width; x++)
+    {
+        const uchar* add = pad + (x + ksize - 1) * CN;
+        const uchar* sub = pad + (x - 1) * CN;
+        for (int c = 0; c < CN; c++)
+        {
+            s[c] += add[c] - sub[c];
+            hsum[x * CN + c] = (ushort)s[c];
+        }
+    }
+}
+
+// Vertical pass for one row: out = scale(colsum + add), colsum = colsum + add - sub.
+void column_sum_scalar(int* colsum, const ushort* add, const ushort* sub, uchar* dst, int len, const BoxScale& scale)
+{
+    for (int i = 0; i < len; i++)
+    {
+        int s = colsum[i] + add[i];
+        dst[i] = scale(s);
+        colsum[i] = s - sub[i];
+    }
+}
+
+#if BOX_FILTER_AVX2
+
+// 4 pixels per iteration: the add/sub differences are prefix-summed in register
+// (one pixel = 4 x ushort = 64 bits), then offset by the last sum of the previous step.
+// ushort arithmetic wraps, which is exact since every window sum fits in 16 bits.
+BOX_FILTER_AVX2_TARGET
+void row_sum_avx2(const uchar* pad, ushort* hsum, int width, int ksize)
+{
+    int s[CN] = { 0, 0, 0, 0 };
+    for (int i = 0; i < ksize; i++)
+        for (int c = 0; c < CN; c++)
+            s[c] += pad[i * CN + c];
+    for (int c = 0; c < CN; c++)
+        hsum[c] = (ushort)s[c];
+
+    int x = 1;
+    if (width > 4)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        long long prev;
+        memcpy(&prev, hsum, sizeof(prev));
+        __m256i carry = _mm256_set1_epi64x(prev);
+
+        for (; x <= width - 4; x += 4)
+        {
+            __m256i add = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(pad + (x + ksize - 1) * CN)));
+            __m256i sub = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(pad + (x - 1) * CN)));
+            __m256i d = _mm256_sub_epi16(add, sub);
+
+            d = _mm256_add_epi16(d, _mm256_slli_si256(d, 8));
+            d = _mm256_add_epi16(d, _mm256_blend_epi32(zero, _mm256_permute4x64_epi64(d, _MM_SHUFFLE(1, 1, 0, 0)), 0xF0));
+            d = _mm256_add_epi16(d, carry);
+
+            _mm256_storeu_si256((__m256i*)(hsum + x * CN), d);
+            carry = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+
+        for (int c = 0; c < CN; c++)
+            s[c] = hsum[(x - 1) * CN + c];
+    }
+
+    for (; x < width; x++)
+    {
+        const uchar* add = pad + (x + ksize - 1) * CN;
+        const uchar* sub = pad + (x - 1) * CN;
+        for (int c = 0; c < CN; c++)
+        {
+            s[c] += add[c] - sub[c];
+            hsum[x * CN + c] = (ushort)s[c];
+        }
+    }
+}
+
+BOX_FILTER_AVX2_TARGET
+void column_sum_avx2(int* colsum, const ushort* add, const ushort* sub, uchar* dst, int len, const BoxScale& scale)
+{
+    int i = 0;
+
+    const __m256i ds = _mm256_set1_epi32((int)scale.ds);
+    const __m256i dd = _mm256_set1_epi32((int)scale.dd);
+    const __m256  fs = _mm256_set1_ps(scale.fscale);
+
+    for (; i <= len - 16; i += 16)
+    {
+        __m256i s0 = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(colsum + i)),
+                                      _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(add + i))));
+        __m256i s1 = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(colsum + i + 8)),
+                                      _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(add + i + 8))));
+
+        __m256i o0, o1;
+        if (scale.fixed_point)
+        {
+            o0 = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_add_epi32(s0, dd), ds), BoxScale::SHIFT);
+            o1 = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_add_epi32(s1, dd), ds), BoxScale::SHIFT);
+        }
+        else
+        {
+            o0 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(s0), fs));
+            o1 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(s1), fs));
+        }
+
+        __m256i o16 = _mm256_permute4x64_epi64(_mm256_packus_epi32(o0, o1), _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i o8 = _mm_packus_epi16(_mm256_castsi256_si128(o16), _mm256_extracti128_si256(o16, 1));
+        _mm_storeu_si128((__m128i*)(dst + i), o8);
+
+        s0 = _mm256_sub_epi32(s0, _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(sub + i))));
+        s1 = _mm256_sub_epi32(s1, _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(sub + i + 8))));
+        _mm256_storeu_si256((__m256i*)(colsum + i), s0);
+        _mm256_storeu_si256((__m256i*)(colsum + i + 8), s1);
+    }
+
+    column_sum_scalar(colsum + i, add + i, sub + i, dst + i, len - i, scale);
+}
+
+#endif // BOX_FILTER_AVX2
+
+
+class BoxBlurBand : public cv::ParallelLoopBody
+{
+public:
+    BoxBlurBand(cv::Mat& m, cv::Size ksize, const std::vector<int>& bands, const std::vector<cv::Mat>& halos) :
+        m_m(m), m_ksize(ksize), m_anchor(ksize.width / 2, ksize.height / 2),
+        m_bands(bands), m_halos(halos), m_scale(ksize.area())
+    {
+#if BOX_FILTER_AVX2
+        m_avx2 = cv::checkHardwareSupport(CV_CPU_AVX2);
+#else
+        m_avx2 = false;
+#endif
+    }
+
+    void operator()(const cv::Range& range) const CV_OVERRIDE
+    {
+        for (int b = range.start; b < range.end; b++)
+            process(b);
+    }
+
+private:
+    // source row for the logical (not yet border-mapped) row index j of band b
+    const uchar* source_row(int b, int j) const
+    {
+        int y0 = m_bands[b], y1 = m_bands[b + 1];
+        if (j < y0)
+            return m_halos[b].ptr(j - (y0 - m_anchor.y));
+        if (j >= y1)
+            return m_halos[b].ptr(m_anchor.y + j - y1);
+        return m_m.ptr(j);
+    }
+
+    void row_sum(const uchar* src, uchar* pad, ushort* hsum) const
+    {
+        const int width = m_m.cols;
+        const int kw = m_ksize.width;
+        const int ax = m_anchor.x;
+
+        for (int i = 0; i < ax; i++)
+            memcpy(pad + i * CN, src + cv::borderInterpolate(i - ax, width, cv::BORDER_REFLECT_101) * CN, CN);
+        memcpy(pad + ax * CN, src, (size_t)width * CN);
+        for (int i = width + ax; i < width + kw - 1; i++)
+            memcpy(pad + i * CN, src + cv::borderInterpolate(i - ax, width, cv::BORDER_REFLECT_101) * CN, CN);
+
+#if BOX_FILTER_AVX2
+        if (m_avx2)
+        {
+            row_sum_avx2(pad, hsum, width, kw);
+            return;
+        }
+#endif
+        row_sum_scalar(pad, hsum, width, kw);
+    }
+
+    void process(int b) const
+    {
+        const int y0 = m_bands[b], y1 = m_bands[b + 1];
+        const int kh = m_ksize.height;
+        const int len = m_m.cols * CN;
+
+        // pad + 16 bytes of slack for the 128-bit loads of the last vector step
+        std::vector<uchar>  pad((size_t)(m_m.cols + m_ksize.width - 1) * CN + 16);
+        std::vector<ushort> ring((size_t)kh * len);
+        std::vector<int>    colsum(len, 0);
+
+        // logical row j lives in ring slot (j - first) % kh
+        const int first = y0 - m_anchor.y;
+        auto slot = [&](int j) { return &ring[(size_t)((j - first) % kh) * len]; };
+
+        for (int j = first; j < first + kh - 1; j++)
+        {
+            ushort* hsum = slot(j);
+            row_sum(source_row(b, j), &pad[0], hsum);
+            for (int i = 0; i < len; i++)
+                colsum[i] += hsum[i];
+        }
+
+        for (int y = y0; y < y1; y++)
+        {
+            const int j_add = y - m_anchor.y + kh - 1;
+            const int j_sub = y - m_anchor.y;
+
+            ushort* add = slot(j_add);
+            row_sum(source_row(b, j_add), &pad[0], add);
+
+            // for kh == 1 the added and subtracted rows share a slot
+            const ushort* sub = slot(j_sub);
+#if BOX_FILTER_AVX2
+            if (m_avx2)
+            {
+                column_sum_avx2(&colsum[0], add, sub, m_m.ptr(y), len, m_scale);
+                continue;
+            }
+#endif
+            column_sum_scalar(&colsum[0], add, sub, m_m.ptr(y), len, m_scale);
+        }
+    }
+
+    cv::Mat&                    m_m;
+    cv::Size                    m_ksize;
+    cv::Point                   m_anchor;
+    const std::vector<int>&     m_bands;
+    const std::vector<cv::Mat>& m_halos;
+    BoxScale                    m_scale;
+    bool                        m_avx2;
+};
+
+} // namespace
+
+
+void box_blur_rgba(cv::Mat& m, cv::Size ksize)
+{
+    if (m.type() != CV_8UC4 || ksize.width < 1 || ksize.height < 1 ||
+        ksize.width > 255 || ksize.height > 255 ||
+        ksize.width > m.cols || ksize.height > m.rows)
+    {
+        cv::blur(m, m, ksize);
+        return;
+    }
+
+    if (ksize.area() == 1)
+        return;
+
+    const int kh = ksize.height;
+    const int ay = kh / 2;
+
+    // keep bands tall enough that the copied halo rows stay small against the band
+    int nbands = std::min(cv::getNumThreads(), m.rows / std::max(2 * kh, 32));
+    nbands = std::max(nbands, 1);
+
+    std::vector<int> bands(nbands + 1);
+    for (int b = 0; b <= nbands; b++)
+        bands[b] = (int)((long long)m.rows * b / nbands);
+
+    // rows [y0 - ay, y0) and [y1, y1 + kh - 1 - ay) of every band, border-mapped,
+    // copied while the whole image is still unmodified
+    std::vector<cv::Mat> halos(nbands);
+    for (int b = 0; b < nbands; b++)
+    {
+        const int y0 = bands[b], y1 = bands[b + 1];
+        halos[b].create(kh - 1, m.cols, CV_8UC4);
+
+        int r = 0;
+        for (int j = y0 - ay; j < y0; j++, r++)
+            memcpy(halos[b].ptr(r), m.ptr(cv::borderInterpolate(j, m.rows, cv::BORDER_REFLECT_101)), (size_t)m.cols * CN);
+        for (int j = y1; j < y1 + kh - 1 - ay; j++, r++)
+            memcpy(halos[b].ptr(r), m.ptr(cv::borderInterpolate(j, m.rows, cv::BORDER_REFLECT_101)), (size_t)m.cols * CN);
+    }
+
+    cv::parallel_for_(cv::Range(0, nbands), BoxBlurBand(m, ksize, bands, halos));
+}
@@ -0,0 +1,19 @@
+/*
+// In-place normalized box filter for 8-bit RGBA frames
+*/
+#pragma once
+
+#include "opencv2/core.hpp"
+
+// Blur an 8-bit 4-channel image in place with a normalized box kernel.
+//
+// The filter keeps a sliding running sum per column, so the cost per pixel does not
+// depend on the kernel size, and it works directly on the given buffer (e.g. a mapped
+// D3D11 surface) without the full-frame temporary cv::blur needs for in-place calls.
+// The image is split into row bands that are processed in parallel through OpenCV's
+// parallel backend. Results are bit-exact with cv::blur(m, m, ksize) using the default
+// anchor and border (BORDER_REFLECT_101).
+//
+// Inputs the fast path does not cover (other types, kernels larger than the image or
+// wider than 255 pixels) fall back to cv::blur.
+void box_blur_rgba(cv::Mat& m, cv::Size ksize);
@@ -0,0 +1,127 @@
+/*
+// Change detection gate: skip inference on frames that did not materially change
+*/
+#include "change_detector.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "opencv2/core/hal/intrin.hpp"
+
+namespace
+{
+
+unsigned sad(const uchar* a, const uchar* b, int len)
+{
+    unsigned s = 0;
+    int i = 0;
+#if CV_SIMD
+    for (; i <= len - cv::v_uint8::nlanes; i += cv::v_uint8::nlanes)
+        s += cv::v_reduce_sad(cv::vx_load(a + i), cv::vx_load(b + i));
+#endif
+    for (; i < len; i++)
+        s += (unsigned)std::abs(a[i] - b[i]);
+    return s;
+}
+
+} // namespace
+
+
+ChangeDetector::ChangeDetector(const Config& config) :
+    m_config(config),
+    m_frames(0),
+    m_skipped(0),
+    m_score(0)
+{
+    CV_Assert(config.grid_cols > 0 && config.grid_rows > 0 && config.row_step > 0);
+}
+
+
+void ChangeDetector::reset()
+{
+    m_reference.release();
+    m_output.release();
+}
+
+
+bool ChangeDetector::changed(const cv::Mat& frame)
+{
+    m_frames++;
+
+    if (!differs(frame))
+    {
+        m_skipped++;
+        return false;
+    }
+
+    frame.copyTo(m_reference);
+    return true;
+}
+
+
+bool ChangeDetector::differs(const cv::Mat& frame)
+{
+    CV_Assert(frame.depth() == CV_8U);
+
+    if (m_reference.empty() || m_reference.size() != frame.size() || m_reference.type() != frame.type())
+    {
+        m_score = 255;
+        return true;
+    }
+
+    const int gc = std::min(m_config.grid_cols, frame.cols);
+    const int gr = std::min(m_config.grid_rows, frame.rows);
+    const int cn = frame.channels();
+
+    m_block_sad.assign((size_t)gc * gr, 0.);
+
+    int changed_blocks = 0;
+    m_score = 0;
+
+    for (int r = 0; r < gr; r++)
+    {
+        const int y0 = frame.rows * r / gr, y1 = frame.rows * (r + 1) / gr;
+        int sampled_rows = 0;
+
+        for (int y = y0; y < y1; y += m_config.row_step, sampled_rows++)
+        {
+            const uchar* a = frame.ptr(y);
+            const uchar* b = m_reference.ptr(y);
+            for (int c = 0; c < gc; c++)
+            {
+                const int x0 = frame.cols * c / gc * cn, x1 = frame.cols * (c + 1) / gc * cn;
+                m_block_sad[r * gc + c] += sad(a + x0, b + x0, x1 - x0);
+            }
+        }
+
+        for (int c = 0; c < gc; c++)
+        {
+            const int bytes = (frame.cols * (c + 1) / gc - frame.cols * c / gc) * cn;
+            const double mean = m_block_sad[r * gc + c] / std::max(1, sampled_rows * bytes);
+            m_score = std::max(m_score, mean);
+            if (mean > m_config.threshold)
+                changed_blocks++;
+        }
+    }
+
+    return changed_blocks >= m_config.min_changed_blocks;
+}
+
+
+void ChangeDetector::process(const cv::Mat& frame, cv::Mat& output, const InferFn& infer)
+{
+    m_frames++;
+
+    // without an output yet there is nothing to reuse, whatever the frame
+    if (differs(frame) || m_output.empty())
+    {
+        frame.copyTo(m_reference);
+        infer(frame, m_output);
+    }
+    else
+    {
+        m_skipped++;
+    }
+
+    m_output.copyTo(output);
+}
@@ -0,0 +1,62 @@
+/*
+// Change detection gate: skip inference on frames that did not materially change
+*/
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "opencv2/core.hpp"
+
+// Compares each frame against the last frame that went through inference.
+//
+// The frame is split into a grid of blocks; every `row_step`-th row is sampled and the
+// sum of absolute differences is accumulated per block (SIMD, OpenCV universal
+// intrinsics). A frame counts as changed when at least `min_changed_blocks` blocks have
+// a mean absolute difference above `threshold` (in 8-bit levels per channel).
+// Comparing against the last processed frame rather than the previous one means slow
+// drift still triggers a refresh once it adds up.
+class ChangeDetector
+{
+public:
+    struct Config
+    {
+        double threshold          = 3.0;
+        int    grid_cols          = 16;
+        int    grid_rows          = 9;
+        int    row_step           = 4;
+        int    min_changed_blocks = 1;
+    };
+
+    typedef std::function<void(const cv::Mat&, cv::Mat&)> InferFn;
+
+    explicit ChangeDetector(const Config& config);
+
+    // true if `frame` differs from the reference; the reference becomes `frame` if so
+    bool changed(const cv::Mat& frame);
+
+    // run `infer` on changed frames, reuse the previous output otherwise; skipped() counts
+    // the reused ones
+    void process(const cv::Mat& frame, cv::Mat& output, const InferFn& infer);
+
+    void reset();
+
+    void set_threshold(double threshold) { m_config.threshold = threshold; }
+
+    size_t frames() const { return m_frames; }
+    size_t skipped() const { return m_skipped; }
+    double last_score() const { return m_score; }   // largest block mean difference
+
+private:
+    // compare against the reference without taking the frame
+    bool differs(const cv::Mat& frame);
+
+    Config               m_config;
+    cv::Mat              m_reference;
+    cv::Mat              m_output;
+    std::vector<double>  m_block_sad;
+
+    size_t               m_frames;
+    size_t               m_skipped;
+    double               m_score;
+};
@@ -0,0 +1,183 @@
+/*
+// Child processes of the application, started with an argument list
+*/
+#include "child_process.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+#ifdef _WIN32
+
+namespace
+{
+
+// quoting understood by CommandLineToArgvW and the C runtime
+std::string quote(const std::string& arg)
+{
+    if (!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos)
+        return arg;
+
+    std::string out = "\"";
+    size_t backslashes = 0;
+    for (size_t i = 0; i < arg.size(); i++)
+    {
+        if (arg[i] == '\\')
+        {
+            backslashes++;
+            continue;
+        }
+        if (arg[i] == '"')
+            out.append(backslashes * 2 + 1, '\\');
+        else
+            out.append(backslashes, '\\');
+        out += arg[i];
+        backslashes = 0;
+    }
+    out.append(backslashes * 2, '\\');
+    return out + "\"";
+}
+
+} // namespace
+
+
+ChildProcess::ChildProcess(const std::vector<std::string>& args) :
+    m_process(0),
+    m_exited(false),
+    m_exit_code(-1)
+{
+    if (args.empty())
+        throw std::runtime_error("ChildProcess: no program");
+
+    std::string cmdline;
+    for (size_t i = 0; i < args.size(); i++)
+        cmdline += (i ? " " : "") + quote(args[i]);
+
+    STARTUPINFOA si;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&pi, sizeof(pi));
+
+    if (!::CreateProcessA(args[0].c_str(), &cmdline[0], NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi))
+        throw std::runtime_error("CreateProcess() failed for " + args[0]);
+
+    ::CloseHandle(pi.hThread);
+    m_process = pi.hProcess;
+}
+
+
+ChildProcess::~ChildProcess()
+{
+    wait();
+    ::CloseHandle(m_process);
+}
+
+
+int ChildProcess::wait()
+{
+    if (!m_exited)
+    {
+        ::WaitForSingleObject(m_process, INFINITE);
+
+        DWORD code = 0;
+        m_exit_code = ::GetExitCodeProcess(m_process, &code) ? (int)code : -1;
+        m_exited = true;
+    }
+    return m_exit_code;
+}
+
+
+void ChildProcess::kill()
+{
+    if (!m_exited)
+        ::TerminateProcess(m_process, 1);
+    wait();
+}
+
+
+std::string ChildProcess::self_path()
+{
+    char path[MAX_PATH];
+    const DWORD n = ::GetModuleFileNameA(NULL, path, MAX_PATH);
+    if (n == 0 || n == MAX_PATH)
+        throw std::runtime_error("GetModuleFileName() failed");
+    return std::string(path, n);
+}
+
+#else
+
+ChildProcess::ChildProcess(const std::vector<std::string>& args) :
+    m_pid(-1),
+    m_exited(false),
+    m_exit_code(-1)
+{
+    if (args.empty())
+        throw std::runtime_error("ChildProcess: no program");
+
+    std::vector<char*> argv;
+    for (size_t i = 0; i < args.size(); i++)
+        argv.push_back(const_cast<char*>(args[i].c_str()));
+    argv.push_back(0);
+
+    pid_t pid;
+    if (::posix_spawn(&pid, args[0].c_str(), NULL, NULL, &argv[0], environ) != 0)
+        throw std::runtime_error("posix_spawn() failed for " + args[0]);
+    m_pid = pid;
+}
+
+
+ChildProcess::~ChildProcess()
+{
+    wait();
+}
+
+
+int ChildProcess::wait()
+{
+    if (!m_exited)
+    {
+        int status = 0;
+        pid_t r;
+        do
+        {
+            r = ::waitpid(m_pid, &status, 0);
+        } while (r < 0 && errno == EINTR);
+
+        m_exit_code = r == m_pid && WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        m_exited = true;
+    }
+    return m_exit_code;
+}
+
+
+void ChildProcess::kill()
+{
+    if (!m_exited)
+        ::kill(m_pid, SIGKILL);
+    wait();
+}
+
+
+std::string ChildProcess::self_path()
+{
+    char path[PATH_MAX];
+    const ssize_t n = ::readlink("/proc/self/exe", path, sizeof(path));
+    if (n <= 0 || n == (ssize_t)sizeof(path))
+        throw std::runtime_error("can't resolve /proc/self/exe");
+    return std::string(path, (size_t)n);
+}
+
+#endif
@@ -0,0 +1,39 @@
+/*
+// Child processes of the application, started with an argument list
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+class ChildProcess
+{
+public:
+    // start args[0] with the remaining arguments; throws std::runtime_error on failure
+    explicit ChildProcess(const std::vector<std::string>& args);
+
+    // waits for the process
+    ~ChildProcess();
+
+    ChildProcess(const ChildProcess&) = delete;
+    ChildProcess& operator=(const ChildProcess&) = delete;
+
+    // block until the process exits; its exit code, or -1 if it was killed
+    int wait();
+
+    // end the process if it is still running, and wait for it; for error paths, where
+    // the process may never exit on its own
+    void kill();
+
+    // path of the running executable, to start workers of the same program
+    static std::string self_path();
+
+private:
+#ifdef _WIN32
+    void* m_process;
+#else
+    int   m_pid;
+#endif
+    bool  m_exited;
+    int   m_exit_code;
+};
@@ -4,26 +4,25 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
-#include <vector>
-#include <d3d11.h>
-#include <windows.h>
 
-#include <opencv2/opencv.hpp>
+#include <opencv2/core.hpp>
 #include "openvino/openvino.hpp"
-#include "openvino/runtime/intel_gpu/ocl/ocl.hpp"
-#include "openvino/runtime/intel_gpu/ocl/dx.hpp"
 
-using namespace InferenceEngine;
+#include "tensor_binding.hpp"
 
 class Cnn {
   public:
-    Cnn():is_initialized_(false), channels_(0), time_elapsed_(0), ncalls_(0) {}
+    Cnn():is_initialized_(false), time_elapsed_(0), ncalls_(0) {}
 
-    void Init(const std::string &model_path,  ID3D11Device*& d3d_device, ID3D11Texture2D* input_surface, ID3D11Buffer* output_surface,
-              const cv::Size &new_input_resolution = cv::Size());
+    // read the model, prepare and compile it for the binding's memory and bind the
+    // binding's tensors; the binding, and any context it holds, stays with the Cnn
+    void Init(const std::string &model_path, const std::shared_ptr<TensorBinding> &binding,
+              const ov::AnyMap &config = ov::AnyMap());
 
-    void Init(const std::string& model_path, ID3D11Device*& d3d_device, cv::Mat input_data);
+    // bind a model compiled elsewhere (e.g. by a ModelLoader) after binding->prepare()
+    void Init(const ov::CompiledModel &compiled_model, const std::shared_ptr<TensorBinding> &binding);
 
     bool is_initialized() const {return is_initialized_;}
 
@@ -32,19 +31,21 @@ class Cnn {
 
     const cv::Size& input_size() const {return input_size_;}
 
-    void Infer(ID3D11Texture2D* surface);
+    // the binding passed to Init(), to feed frames through its set_input()
+    template <typename TBinding>
+    TBinding& binding() const {return dynamic_cast<TBinding&>(*binding_);}
+
+    // run on what was last set on the binding's input
+    void Infer();
 
   private:
     bool is_initialized_;
     cv::Size input_size_;
-    int channels_;
-    std::string input_name_;
-    std::vector<std::string> output_names_;
 
     double time_elapsed_;
     size_t ncalls_;
 
+    std::shared_ptr<TensorBinding> binding_;
+    ov::CompiledModel compiled_model_;
     ov::InferRequest infer_request;
-    ov::intel_gpu::ocl::D3DContext* remote_context;
-
 };
@@ -0,0 +1,232 @@
+/*
+// Color conversions between mapped surface memory
+*/
+#include "color_convert.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "opencv2/core/hal/intrin.hpp"
+
+namespace
+{
+
+// ITU-R BT.601 coefficients in the fixed-point form used by cv::cvtColor
+const int ITUR_BT_601_CY    = 1220542;
+const int ITUR_BT_601_CUB   = 2116026;
+const int ITUR_BT_601_CUG   = -409993;
+const int ITUR_BT_601_CVG   = -852492;
+const int ITUR_BT_601_CVR   = 1673527;
+const int ITUR_BT_601_SHIFT = 20;
+
+inline void uv_to_rgb(int u, int v, int& ruv, int& guv, int& buv)
+{
+    u -= 128;
+    v -= 128;
+    ruv = (1 << (ITUR_BT_601_SHIFT - 1)) + ITUR_BT_601_CVR * v;
+    guv = (1 << (ITUR_BT_601_SHIFT - 1)) + ITUR_BT_601_CVG * v + ITUR_BT_601_CUG * u;
+    buv = (1 << (ITUR_BT_601_SHIFT - 1)) + ITUR_BT_601_CUB * u;
+}
+
+inline void y_to_rgba(int y, int ruv, int guv, int buv, uchar* dst)
+{
+    y = std::max(0, y - 16) * ITUR_BT_601_CY;
+    dst[0] = cv::saturate_cast<uchar>((y + ruv) >> ITUR_BT_601_SHIFT);
+    dst[1] = cv::saturate_cast<uchar>((y + guv) >> ITUR_BT_601_SHIFT);
+    dst[2] = cv::saturate_cast<uchar>((y + buv) >> ITUR_BT_601_SHIFT);
+    dst[3] = 0xff;
+}
+
+#if CV_SIMD
+
+struct ChromaVec
+{
+    cv::v_int32 r, g, b;
+};
+
+inline ChromaVec uv_to_rgb(const cv::v_int32& u, const cv::v_int32& v)
+{
+    const cv::v_int32 half = cv::vx_setall_s32(1 << (ITUR_BT_601_SHIFT - 1));
+    const cv::v_int32 c128 = cv::vx_setall_s32(128);
+    cv::v_int32 uu = u - c128, vv = v - c128;
+
+    ChromaVec c;
+    c.r = half + vv * cv::vx_setall_s32(ITUR_BT_601_CVR);
+    c.g = half + vv * cv::vx_setall_s32(ITUR_BT_601_CVG) + uu * cv::vx_setall_s32(ITUR_BT_601_CUG);
+    c.b = half + uu * cv::vx_setall_s32(ITUR_BT_601_CUB);
+    return c;
+}
+
+// split 8-bit lanes into four 32-bit vectors
+inline void expand_u8(const cv::v_uint8& a, cv::v_int32 (&out)[4])
+{
+    cv::v_uint16 a0, a1;
+    cv::v_expand(a, a0, a1);
+    cv::v_uint32 b0, b1, b2, b3;
+    cv::v_expand(a0, b0, b1);
+    cv::v_expand(a1, b2, b3);
+    out[0] = cv::v_reinterpret_as_s32(b0);
+    out[1] = cv::v_reinterpret_as_s32(b1);
+    out[2] = cv::v_reinterpret_as_s32(b2);
+    out[3] = cv::v_reinterpret_as_s32(b3);
+}
+
+// R, G, B of one full v_uint8 worth of pixels sharing the chroma in `c`
+inline void y_to_rgb(const cv::v_uint8& y, const ChromaVec (&c)[4], cv::v_uint8& r, cv::v_uint8& g, cv::v_uint8& b)
+{
+    const cv::v_int32 zero = cv::vx_setzero_s32();
+    const cv::v_int32 c16  = cv::vx_setall_s32(16);
+    const cv::v_int32 cy   = cv::vx_setall_s32(ITUR_BT_601_CY);
+
+    cv::v_int32 yy[4];
+    expand_u8(y, yy);
+
+    cv::v_int32 rr[4], gg[4], bb[4];
+    for (int k = 0; k < 4; k++)
+    {
+        cv::v_int32 t = cv::v_max(zero, yy[k] - c16) * cy;
+        rr[k] = (t + c[k].r) >> ITUR_BT_601_SHIFT;
+        gg[k] = (t + c[k].g) >> ITUR_BT_601_SHIFT;
+        bb[k] = (t + c[k].b) >> ITUR_BT_601_SHIFT;
+    }
+
+    r = cv::v_pack_u(cv::v_pack(rr[0], rr[1]), cv::v_pack(rr[2], rr[3]));
+    g = cv::v_pack_u(cv::v_pack(gg[0], gg[1]), cv::v_pack(gg[2], gg[3]));
+    b = cv::v_pack_u(cv::v_pack(bb[0], bb[1]), cv::v_pack(bb[2], bb[3]));
+}
+
+#endif // CV_SIMD
+
+
+class NV12toRGBAInvoker : public cv::ParallelLoopBody
+{
+public:
+    NV12toRGBAInvoker(const uchar* y_plane, size_t y_pitch, const uchar* uv_plane, size_t uv_pitch,
+                      uchar* rgba, size_t rgba_pitch, int width) :
+        m_y(y_plane), m_y_pitch(y_pitch), m_uv(uv_plane), m_uv_pitch(uv_pitch),
+        m_rgba(rgba), m_rgba_pitch(rgba_pitch), m_width(width)
+    {}
+
+    // range is in chroma rows, i.e. pairs of output rows
+    void operator()(const cv::Range& range) const CV_OVERRIDE
+    {
+        for (int j = range.start; j < range.end; j++)
+        {
+            const uchar* y0 = m_y + (size_t)(2 * j) * m_y_pitch;
+            const uchar* y1 = y0 + m_y_pitch;
+            const uchar* uv = m_uv + (size_t)j * m_uv_pitch;
+            uchar* d0 = m_rgba + (size_t)(2 * j) * m_rgba_pitch;
+            uchar* d1 = d0 + m_rgba_pitch;
+
+            int x = 0;
+#if CV_SIMD
+            // 2 * nlanes pixels per step: even and odd luma columns share one chroma sample
+            const int step = 2 * cv::v_uint8::nlanes;
+            const cv::v_uint8 alpha = cv::vx_setall_u8(0xff);
+            for (; x <= m_width - step; x += step)
+            {
+                cv::v_uint8 u, v;
+                cv::v_load_deinterleave(uv + x, u, v);
+
+                cv::v_int32 uu[4], vv[4];
+                expand_u8(u, uu);
+                expand_u8(v, vv);
+
+                ChromaVec c[4];
+                for (int k = 0; k < 4; k++)
+                    c[k] = uv_to_rgb(uu[k], vv[k]);
+
+                const uchar* ysrc[2] = { y0 + x, y1 + x };
+                uchar* dst[2] = { d0 + 4 * x, d1 + 4 * x };
+                for (int row = 0; row < 2; row++)
+                {
+                    cv::v_uint8 ye, yo;
+                    cv::v_load_deinterleave(ysrc[row], ye, yo);
+
+                    cv::v_uint8 re, ge, be, ro, go, bo;
+                    y_to_rgb(ye, c, re, ge, be);
+                    y_to_rgb(yo, c, ro, go, bo);
+
+                    cv::v_uint8 r0, r1, g0, g1, b0, b1;
+                    cv::v_zip(re, ro, r0, r1);
+                    cv::v_zip(ge, go, g0, g1);
+                    cv::v_zip(be, bo, b0, b1);
+
+                    cv::v_store_interleave(dst[row], r0, g0, b0, alpha);
+                    cv::v_store_interleave(dst[row] + 4 * cv::v_uint8::nlanes, r1, g1, b1, alpha);
+                }
+            }
+#endif
+            for (; x < m_width; x += 2)
+            {
+                int ruv, guv, buv;
+                uv_to_rgb(uv[x], uv[x + 1], ruv, guv, buv);
+
+                y_to_rgba(y0[x],     ruv, guv, buv, d0 + 4 * x);
+                y_to_rgba(y0[x + 1], ruv, guv, buv, d0 + 4 * x + 4);
+                y_to_rgba(y1[x],     ruv, guv, buv, d1 + 4 * x);
+                y_to_rgba(y1[x + 1], ruv, guv, buv, d1 + 4 * x + 4);
+            }
+        }
+    }
+
+private:
+    const uchar* m_y;
+    size_t       m_y_pitch;
+    const uchar* m_uv;
+    size_t       m_uv_pitch;
+    uchar*       m_rgba;
+    size_t       m_rgba_pitch;
+    int          m_width;
+};
+
+} // namespace
+
+
+void convert_NV12_to_RGBA(const uchar* y_plane, size_t y_pitch,
+                          const uchar* uv_plane, size_t uv_pitch,
+                          uchar* rgba, size_t rgba_pitch,
+                          int width, int height)
+{
+    CV_Assert(width % 2 == 0 && height % 2 == 0);
+
+    // roughly 64K pixels per task
+    const double nstripes = (double)width * height / (1 << 16);
+    cv::parallel_for_(cv::Range(0, height / 2),
+                      NV12toRGBAInvoker(y_plane, y_pitch, uv_plane, uv_pitch, rgba, rgba_pitch, width),
+                      nstripes);
+}
+
+
+void convert_I420_to_NV12(const cv::Mat& i420, cv::Mat& nv12, int width, int height)
+{
+    CV_Assert(i420.type() == CV_8UC1 && i420.isContinuous() && i420.rows == height * 3 / 2 && i420.cols == width);
+
+    nv12.create(i420.rows, i420.cols, CV_8UC1);
+
+    const uchar* pSrcY = i420.data;
+    uchar* pDstY = nv12.data;
+    size_t srcStep = i420.step[0];
+    size_t dstStep = nv12.step[0];
+
+    // copy Y plane
+    for (int i = 0; i < height; i++)
+        memcpy(pDstY + i*dstStep, pSrcY + i*srcStep, width);
+
+    // copy U/V planes to UV plane
+    size_t uv_offset = height * dstStep;
+
+    for (int i = 0; i < height / 2; i++)
+    {
+        const uchar* pSrcU = pSrcY + height*width + i*(width / 2);
+        const uchar* pSrcV = pSrcY + height*width + (height / 2) * (width / 2) + i*(width / 2);
+
+        uchar* pDstUV = pDstY + uv_offset + i*dstStep;
+
+        for (int j = 0; j < width / 2; j++)
+        {
+            pDstUV[j*2 + 0] = pSrcU[j];
+            pDstUV[j*2 + 1] = pSrcV[j];
+        }
+    }
+}
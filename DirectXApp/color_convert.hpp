@@ -0,0 +1,20 @@
+/*
+// Color conversions between mapped surface memory
+*/
+#pragma once
+
+#include "opencv2/core.hpp"
+
+// Convert an NV12 image to RGBA, reading from and writing to arbitrary pitched memory
+// (e.g. a mapped staging NV12 surface and a mapped RGBA surface), so no intermediate
+// frame buffer is needed. Rows are converted in parallel through OpenCV's parallel
+// backend. Output is bit-exact with cv::cvtColor(..., cv::COLOR_YUV2RGBA_NV12);
+// width and height must be even.
+void convert_NV12_to_RGBA(const uchar* y_plane, size_t y_pitch,
+                          const uchar* uv_plane, size_t uv_pitch,
+                          uchar* rgba, size_t rgba_pitch,
+                          int width, int height);
+
+// Interleave the U and V planes of an I420 image (as produced by
+// cv::COLOR_BGR2YUV_I420) into the UV plane of an NV12 image of the same size.
+void convert_I420_to_NV12(const cv::Mat& i420, cv::Mat& nv12, int width, int height);
@@ -0,0 +1,111 @@
+/*
+// Cnn tensor binding on D3D11 shared surfaces (Windows, GPU plugin)
+*/
+#include "d3d11_binding.hpp"
+
+#include <stdexcept>
+
+#include "openvino/runtime/intel_gpu/ocl/dx.hpp"
+#include "openvino/runtime/intel_gpu/properties.hpp"
+
+D3D11SurfaceBinding::D3D11SurfaceBinding(ID3D11Device* device, cv::Size frame_size) :
+    m_device(device),
+    m_frame_size(frame_size),
+    m_output(0)
+{
+    m_device->AddRef();
+}
+
+
+D3D11SurfaceBinding::~D3D11SurfaceBinding()
+{
+    // tensors and context go before the D3D11 objects they share
+    m_inputs.clear();
+    m_request = ov::InferRequest();
+    m_context.reset();
+
+    if (m_output)
+        m_output->Release();
+    m_device->Release();
+}
+
+
+std::shared_ptr<ov::Model> D3D11SurfaceBinding::prepare(const std::shared_ptr<ov::Model>& model) const
+{
+    ov::preprocess::PrePostProcessor ppp(model);
+
+    ppp.input()
+        .tensor()
+        .set_layout("NHWC")
+        .set_element_type(ov::element::u8)
+        .set_color_format(ov::preprocess::ColorFormat::RGBX)
+        .set_shape({ 1, (size_t)m_frame_size.height, (size_t)m_frame_size.width, 4 })
+        .set_memory_type(ov::intel_gpu::memory_type::surface);
+
+    ppp.input().preprocess()
+        .convert_layout("NCHW")
+        .convert_color(ov::preprocess::ColorFormat::RGB)
+        .resize(ov::preprocess::ResizeAlgorithm::RESIZE_LINEAR)
+        .convert_element_type(ov::element::f32);
+
+    ppp.input().model().set_layout("NCHW");
+
+    ppp.output().tensor()
+        .set_element_type(ov::element::f32);
+
+    ppp.output().postprocess()
+        .convert_layout("NHWC");
+
+    return ppp.build();
+}
+
+
+ov::CompiledModel D3D11SurfaceBinding::compile(ov::Core& core, const std::shared_ptr<ov::Model>& model, const ov::AnyMap& config)
+{
+    // kept for the lifetime of the binding: tensors created later refer to it
+    m_context.reset(new ov::intel_gpu::ocl::D3DContext(core, m_device));
+
+    return core.compile_model(model, *m_context, config);
+}
+
+
+void D3D11SurfaceBinding::bind(ov::CompiledModel& compiled, ov::InferRequest& request)
+{
+    if (!m_context)
+        throw std::runtime_error("D3D11SurfaceBinding: bind() before compile()");
+
+    const ov::Shape output_shape = compiled.output().get_shape();
+
+    if (!m_output)
+    {
+        D3D11_BUFFER_DESC desc;
+        desc.ByteWidth           = (UINT)(ov::shape_size(output_shape) * sizeof(float));
+        desc.Usage               = D3D11_USAGE_DYNAMIC;
+        desc.BindFlags           = D3D11_BIND_VERTEX_BUFFER;
+        desc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+        desc.MiscFlags           = 0;
+        desc.StructureByteStride = 0;
+
+        HRESULT r = m_device->CreateBuffer(&desc, NULL, &m_output);
+        if (FAILED(r))
+        {
+            throw std::runtime_error("Can't create DX output buffer");
+        }
+    }
+
+    m_request = request;
+    m_request.set_output_tensor(m_context->create_tensor(ov::element::f32, output_shape, m_output));
+}
+
+
+void D3D11SurfaceBinding::set_input(ID3D11Texture2D* surface)
+{
+    std::map<ID3D11Texture2D*, ov::RemoteTensor>::iterator it = m_inputs.find(surface);
+    if (it == m_inputs.end())
+    {
+        const ov::Shape shape = { 1, (size_t)m_frame_size.height, (size_t)m_frame_size.width, 4 };
+        it = m_inputs.insert(std::make_pair(surface, m_context->create_tensor(ov::element::u8, shape, surface))).first;
+    }
+
+    m_request.set_input_tensor(it->second);
+}
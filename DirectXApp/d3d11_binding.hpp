@@ -0,0 +1,45 @@
+/*
+// Cnn tensor binding on D3D11 shared surfaces (Windows, GPU plugin)
+*/
+#pragma once
+
+#include <map>
+#include <memory>
+
+#include <d3d11.h>
+
+#include "tensor_binding.hpp"
+
+namespace ov { namespace intel_gpu { namespace ocl { class D3DContext; } } }
+
+// RGBA D3D11 textures of the frame size are read by the GPU plugin in place, through a
+// remote context created on the application's device; color conversion and resize to
+// the network input run in the compiled model. The output lands in a D3D11 buffer the
+// binding creates once from the compiled output shape.
+class D3D11SurfaceBinding : public TensorBinding
+{
+public:
+    D3D11SurfaceBinding(ID3D11Device* device, cv::Size frame_size);
+    ~D3D11SurfaceBinding();
+
+    const char* name() const { return "d3d11"; }
+    cv::Size input_size() const { return m_frame_size; }
+
+    std::shared_ptr<ov::Model> prepare(const std::shared_ptr<ov::Model>& model) const;
+    ov::CompiledModel compile(ov::Core& core, const std::shared_ptr<ov::Model>& model, const ov::AnyMap& config);
+    void bind(ov::CompiledModel& compiled, ov::InferRequest& request);
+
+    // DXGI_FORMAT_R8G8B8A8_UNORM texture of the frame size; the tensor wrapping a texture
+    // is created on its first use and kept
+    void set_input(ID3D11Texture2D* surface);
+
+    ID3D11Buffer* output() const { return m_output; }
+
+private:
+    ID3D11Device*                                   m_device;
+    cv::Size                                        m_frame_size;
+    std::unique_ptr<ov::intel_gpu::ocl::D3DContext> m_context;
+    ov::InferRequest                                m_request;
+    std::map<ID3D11Texture2D*, ov::RemoteTensor>    m_inputs;
+    ID3D11Buffer*                                   m_output;
+};
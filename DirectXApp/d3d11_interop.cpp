@@ -10,16 +10,24 @@
 #include <windows.h>
 #include <d3d11.h>
 
+#include <chrono>
+#include <future>
+
 #include "opencv2/core.hpp"
 #include "opencv2/core/directx.hpp"
 #include "opencv2/core/ocl.hpp"
 #include "opencv2/imgproc.hpp"
 #include "opencv2/videoio.hpp"
 #include "d3dsample.hpp"
-#include <openvino/runtime/intel_gpu/ocl/dx.hpp>
+#include "box_filter.hpp"
+#include "color_convert.hpp"
+#include "opencl_context.hpp"
+#include "overlay.hpp"
+#include "umat_pool.hpp"
+#include "quality_controller.hpp"
 #if OV_ENABLE
-#include <inference_engine.hpp>
 #include "cnn.hpp"
+#include "d3d11_binding.hpp"
 #endif
 
 #pragma comment (lib, "d3d11.lib")
@@ -28,9 +36,17 @@
 class D3D11WinApp : public D3DSample
 {
 public:
-    D3D11WinApp(int width, int height, std::string& window_name, cv::VideoCapture& cap)
-    : D3DSample(width, height, window_name, cap),
-      m_nv12_available(false)
+    D3D11WinApp(int width, int height, std::string& window_name, const cv::Ptr<FrameSource>& source)
+    : D3DSample(width, height, window_name, source),
+      m_nv12_available(false),
+      m_overlay(4, cv::Scalar(0, 0, 200)),
+      m_quality(QualityController::Config()),
+      m_umats(UMAT_RESERVE_BYTES)
+#if OV_ENABLE
+      , m_surface_cnn_failed(false)
+      , m_surface_cnn_swap(0)
+      , m_surface_pending_swap(0)
+#endif
     {}
 
     ~D3D11WinApp() {}
@@ -41,9 +57,25 @@ public:
         // base initialization
         D3DSample::create();
 
+        if (m_arena)
+        {
+            m_frame_i420.allocator = m_arena->mat_allocator();
+            m_frame_nv12.allocator = m_arena->mat_allocator();
+#if OV_ENABLE
+            m_styled.allocator     = m_arena->mat_allocator();
+#endif
+        }
+
+        QualityController::Config quality_config;
+        quality_config.target_frame_ms = m_target_fps > 0 ? 1000. / m_target_fps : 0;
+        m_quality = QualityController(quality_config);
+
         // initialize DirectX
         HRESULT r;
 
+        if (m_startup)
+            m_startup->begin("d3d11 device and swap chain");
+
         DXGI_SWAP_CHAIN_DESC scd;
 
         ZeroMemory(&scd, sizeof(DXGI_SWAP_CHAIN_DESC));
@@ -110,6 +142,12 @@ public:
 
         m_pD3D11Ctx->RSSetViewports(1, &viewport);
 
+        if (m_startup)
+        {
+            m_startup->end("d3d11 device and swap chain");
+            m_startup->begin("surfaces");
+        }
+
         m_pSurfaceRGBA = 0;
         m_pSurfaceNV12 = 0;
         m_pSurfaceNV12_cpu_copy = 0;
@@ -179,20 +217,16 @@ public:
         }
 #endif
 
-        // initialize OpenCL context of OpenCV lib from DirectX
-        if (cv::ocl::haveOpenCL())
-        {
-            m_oclCtx = cv::directx::ocl::initializeContextFromD3D11Device(m_pD3D11Dev);
-        }
+        if (m_startup)
+            m_startup->end("surfaces");
 
-        m_oclDevName = cv::ocl::useOpenCL() ?
-            cv::ocl::Context::getDefault().device(0).name() :
-            "No OpenCL device";
+        // OpenCL context of OpenCV lib from DirectX, created when a GPU mode is first selected
+        ID3D11Device* device = m_pD3D11Dev;
+        m_ocl = cv::makePtr<LazyOpenCLContext>(
+            [device]() { cv::directx::ocl::initializeContextFromD3D11Device(device); }, m_startup);
 
-       
-#if OV_ENABLE
-       // modelcnn.Init("models//model_composition_v5_no_padding.xml",  m_pD3D11Dev, cv::Size(640, 480));
-#endif
+        if (m_prewarm_opencl)
+            m_ocl->prewarm(cv::Size(m_width, m_height));
 
         return EXIT_SUCCESS;
     } // create()
@@ -203,20 +237,48 @@ public:
     {
         HRESULT r;
 
-        if (!m_cap.read(m_frame_bgr))
+        if (!m_source->read(m_frame))
             return EXIT_FAILURE;
+        m_frame.clear_stages();
+        m_frame.stamp(Frame::STAGE_READ);
+
+        if (m_recorder)
+            m_recorder->write(m_frame);
+
+        const bool nv12_frame = m_frame.format == FRAME_NV12;
 
         if (use_nv12)
         {
-            cv::cvtColor(m_frame_bgr, m_frame_i420, cv::COLOR_BGR2YUV_I420);
+            if (!nv12_frame)
+            {
+                cv::cvtColor(m_frame.data, m_frame_i420, cv::COLOR_BGR2YUV_I420);
+                convert_I420_to_NV12(m_frame_i420, m_frame_nv12, m_width, m_height);
+            }
+            const cv::Mat& nv12 = nv12_frame ? m_frame.data : m_frame_nv12;
+
+            m_pD3D11Ctx->UpdateSubresource(m_pSurfaceNV12, 0, 0, nv12.data, (UINT)nv12.step[0], (UINT)(nv12.step[0] * nv12.rows));
+        }
+        else if (nv12_frame)
+        {
+            // recorded NV12 frame: convert straight into the mapped RGBA surface
+            UINT subResource = ::D3D11CalcSubresource(0, 0, 1);
+
+            D3D11_MAPPED_SUBRESOURCE mappedTex;
+            r = m_pD3D11Ctx->Map(m_pSurfaceRGBA, subResource, D3D11_MAP_WRITE_DISCARD, 0, &mappedTex);
+            if (FAILED(r))
+            {
+                throw std::runtime_error("surface mapping failed!");
+            }
 
-            convert_I420_to_NV12(m_frame_i420, m_frame_nv12, m_width, m_height);
+            convert_NV12_to_RGBA(m_frame.data.ptr(0), m_frame.data.step[0],
+                                 m_frame.data.ptr(m_height), m_frame.data.step[0],
+                                 (uchar*)mappedTex.pData, mappedTex.RowPitch, m_width, m_height);
 
-            m_pD3D11Ctx->UpdateSubresource(m_pSurfaceNV12, 0, 0, m_frame_nv12.data, (UINT)m_frame_nv12.step[0], (UINT)m_frame_nv12.total());
+            m_pD3D11Ctx->Unmap(m_pSurfaceRGBA, subResource);
         }
         else
         {
-            cv::cvtColor(m_frame_bgr, m_frame_rgba, cv::COLOR_BGR2RGBA);
+            cv::cvtColor(m_frame.data, m_frame_rgba, cv::COLOR_BGR2RGBA);
 
             // process video frame on CPU
             UINT subResource = ::D3D11CalcSubresource(0, 0, 1);
@@ -252,14 +314,24 @@ public:
             // capture user input once
             MODE mode = (m_mode == MODE_GPU_NV12 && !m_nv12_available) ? MODE_GPU_RGBA : m_mode;
 
+            // with processing on, the quality controller decides how much of it runs
+            QualityController::Level level = m_demo_processing ? m_quality.level() : QualityController::LEVEL_PASSTHROUGH;
+
+#if OV_ENABLE
+            update_model();
+#endif
+
             HRESULT r;
             ID3D11Texture2D* pSurface = 0;
 
+            int64 t0 = cv::getTickCount();
             r = get_surface(&pSurface, mode == MODE_GPU_NV12);
             if (FAILED(r))
             {
                 throw std::runtime_error("get_surface() failed!");
             }
+            m_frame.stamp(Frame::STAGE_CONVERTED);
+            m_quality.report(QualityController::STAGE_CAPTURE, ms_since(t0));
 
             m_timer.reset();
             m_timer.start();
@@ -280,26 +352,54 @@ public:
 
                 cv::Mat m(m_height, m_width, CV_8UC4, mappedTex.pData, (int)mappedTex.RowPitch);
 
-                if (m_demo_processing)
+                if (level >= QualityController::LEVEL_BLUR)
                 {
-                    // blur data from D3D11 surface with OpenCV on CPU
-                    cv::blur(m, m, cv::Size(15, 15));
+                    // blur data from D3D11 surface on CPU, in place on the mapped memory
+                    t0 = cv::getTickCount();
+                    box_blur_rgba(m, cv::Size(15, 15));
+                    m_quality.report(QualityController::STAGE_PROCESS, ms_since(t0));
+                }
 #if OV_ENABLE
-                    modelcnn.Init("models//model_composition_v5_no_padding.xml", m_pD3D11Dev, m);
-#endif
+                // the network stays alive for this frame even if a reload swaps it out.
+                // Without a strategy its output stays in its tensor, so the frames
+                // LEVEL_CNN_REDUCED skips have nothing to carry over; with one, they show
+                // the last stylized frame.
+                std::shared_ptr<HostNetwork> network = m_model ? m_model->current() : std::shared_ptr<HostNetwork>();
+                const bool cnn = level >= QualityController::LEVEL_CNN_REDUCED && network;
+                if (cnn && m_quality.infer_frame())
+                {
+                    t0 = cv::getTickCount();
+                    if (m_strategy)
+                        m_strategy->process(m, m_styled, [&network](const cv::Mat& input, cv::Mat& output) {
+                            network->infer(input, output);
+                        });
+                    else
+                        network->infer(m);
+                    m_frame.stamp(Frame::STAGE_INFERRED);
+                    m_quality.report(QualityController::STAGE_INFER, ms_since(t0));
+                    first_cnn_frame();
+                }
+                if (m_strategy)
+                {
+                    if (cnn && !m_styled.empty())
+                        m_styled.copyTo(m);
+                    else if (!cnn)
+                        reset_strategy();
                 }
+#endif
 
                 m_timer.stop();
 
-                cv::String strMode = cv::format("mode: %s", m_modeStr[MODE_CPU].c_str());
-                cv::String strProcessing = m_demo_processing ? "blur frame" : "copy frame";
-                cv::String strTime = cv::format("time: %4.3f msec", m_timer.getTimeMilli());
-                cv::String strDevName = cv::format("OpenCL device: %s", m_oclDevName.c_str());
+                update_overlay(MODE_CPU, level);
+                m_overlay.compose(m);
+                if (m_watermark)
+                    draw_watermark(m, m_frame);
+                m_frame.stamp(Frame::STAGE_SINK);
 
-                cv::putText(m, strMode, cv::Point(0, 20), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 0, 200), 2);
-                cv::putText(m, strProcessing, cv::Point(0, 40), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 0, 200), 2);
-                cv::putText(m, strTime, cv::Point(0, 60), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 0, 200), 2);
-                cv::putText(m, strDevName, cv::Point(0, 80), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 0, 200), 2);
+                if (m_ring)
+                    m_ring->write(m, m_frame.timestamp_us);
+                if (m_writer)
+                    m_writer->consume(m_frame, m);
 
                 m_pD3D11Ctx->Unmap(pSurface, subResource);
 
@@ -309,66 +409,55 @@ public:
             case MODE_GPU_RGBA:
             case MODE_GPU_NV12:
             {
-                // process video frame on GPU
-                cv::UMat u;
+                // without an OpenCL device the UMat path still runs, on the CPU
+                m_ocl->ensure();
+
+                // process video frame on GPU, in device buffers kept from the previous frame
+                const cv::Size size(m_width, m_height);
+                cv::UMat* u = &m_umats.get(UMAT_FRAME, size, CV_8UC4);
 
-                cv::directx::convertFromD3D11Texture2D(pSurface, u);
+                cv::directx::convertFromD3D11Texture2D(pSurface, *u);
 
-                if (m_demo_processing)
+                if (level >= QualityController::LEVEL_BLUR)
                 {
                     // blur data from D3D11 surface with OpenCV on GPU with OpenCL
-                    cv::blur(u, u, cv::Size(15, 15));
-                 
+                    t0 = cv::getTickCount();
+                    cv::UMat& blurred = m_umats.get(UMAT_BLURRED, size, CV_8UC4);
+                    cv::blur(*u, blurred, cv::Size(15, 15));
+                    u = &blurred;
+                    m_quality.report(QualityController::STAGE_PROCESS, ms_since(t0));
                 }
 
                 m_timer.stop();
 
-                cv::String strMode = cv::format("mode: %s", m_modeStr[mode].c_str());
-                cv::String strProcessing = m_demo_processing ? "blur frame" : "copy frame";
-                cv::String strTime = cv::format("time: %4.3f msec", m_timer.getTimeMilli());
-                cv::String strDevName = cv::format("OpenCL device: %s", m_oclDevName.c_str());
-
-                cv::putText(u, strMode, cv::Point(0, 20), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 0, 200), 2);
-                cv::putText(u, strProcessing, cv::Point(0, 40), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 0, 200), 2);
-                cv::putText(u, strTime, cv::Point(0, 60), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 0, 200), 2);
-                cv::putText(u, strDevName, cv::Point(0, 80), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 0, 200), 2);
-                //std::cout << u.size().width << ";" << u.size().height << std::endl;
-                cv::directx::convertToD3D11Texture2D(u, pSurface);
+                update_overlay(mode, level);
+                m_overlay.compose(*u);
+                if (m_watermark)
+                    draw_watermark(*u, m_frame);
+                m_frame.stamp(Frame::STAGE_SINK);
+
+                // downloaded straight into the ring slot
+                if (m_ring)
+                    m_ring->write(*u, m_frame.timestamp_us);
+                if (m_writer)
+                {
+                    cv::Mat host = u->getMat(cv::ACCESS_READ);
+                    m_writer->consume(m_frame, host);
+                }
+                cv::directx::convertToD3D11Texture2D(*u, pSurface);
 #if OV_ENABLE
-               //modelcnn.Infer(pSurface);
-                //D3D11_TEXTURE2D_DESC desc_rgb;
-                //desc_rgb.Width = 1280;
-                //desc_rgb.Height = 720;
-                //desc_rgb.MipLevels = 1;
-                //desc_rgb.ArraySize = 1;
-                //desc_rgb.Format = DXGI_FORMAT_R32G32B32_FLOAT;// DXGI_FORMAT_R8G8B8A8_UNORM;//;
-                //desc_rgb.SampleDesc.Count = 1;
-                //desc_rgb.SampleDesc.Quality = 0;
-                //desc_rgb.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-                //desc_rgb.Usage = D3D11_USAGE_DYNAMIC;
-                //desc_rgb.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-                //desc_rgb.MiscFlags = 0;
-
-                ////m_pD3D11Dev->CheckFormatSupport(DXGI_FORMAT_R32G32B32_FLOAT, &support_flag);      
-                //r = m_pD3D11Dev->CreateTexture2D(&desc_rgb, 0, &m_pSurfaceRGB);
-                //if (FAILED(r))
-                //{
-                //    throw std::runtime_error("Can't create DX texture");
-                //}
-
-                D3D11_BUFFER_DESC bufferDesc;
-                bufferDesc.ByteWidth = 3*1280*720*4;
-                bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-                bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-                bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-                bufferDesc.MiscFlags = 0;
-                bufferDesc.StructureByteStride = 0;
-                r = m_pD3D11Dev->CreateBuffer(&bufferDesc, NULL, &output_buffer);
-                if (FAILED(r))
-                    {
-                        throw std::runtime_error("Can't create DX texture");
-                    }
-               modelcnn.Init("models//model_composition_v5_no_padding.xml", m_pD3D11Dev, pSurface, output_buffer, cv::Size(640, 480));
+                // the network reads the RGBA surface in place, once compiled; NV12 surfaces
+                // would need a two-plane binding and go without, as the overlay says. It
+                // runs after the sinks got the frame, so its time counts as presenting and
+                // STAGE_INFERRED stays unstamped.
+                if (level >= QualityController::LEVEL_CNN_REDUCED && m_quality.infer_frame() && mode == MODE_GPU_RGBA &&
+                    surface_cnn_ready())
+                {
+                    t0 = cv::getTickCount();
+                    m_surface_cnn->binding<D3D11SurfaceBinding>().set_input(pSurface);
+                    m_surface_cnn->Infer();
+                    m_quality.report(QualityController::STAGE_INFER, ms_since(t0));
+                }
 #endif
 
                 if (mode == MODE_GPU_NV12)
@@ -376,37 +465,34 @@ public:
                     // just for rendering, we need to convert NV12 to RGBA.
                     m_pD3D11Ctx->CopyResource(m_pSurfaceNV12_cpu_copy, m_pSurfaceNV12);
 
-                    // process video frame on CPU
+                    // convert on CPU straight from the mapped NV12 copy into the mapped RGBA surface
                     {
                         UINT subResource = ::D3D11CalcSubresource(0, 0, 1);
 
-                        D3D11_MAPPED_SUBRESOURCE mappedTex;
-                        r = m_pD3D11Ctx->Map(m_pSurfaceNV12_cpu_copy, subResource, D3D11_MAP_READ, 0, &mappedTex);
+                        D3D11_MAPPED_SUBRESOURCE mappedNV12;
+                        r = m_pD3D11Ctx->Map(m_pSurfaceNV12_cpu_copy, subResource, D3D11_MAP_READ, 0, &mappedNV12);
                         if (FAILED(r))
                         {
                             throw std::runtime_error("surface mapping failed!");
                         }
 
-                        cv::Mat frame_nv12(m_height + (m_height / 2), m_width, CV_8UC1, mappedTex.pData, mappedTex.RowPitch);
-                        cv::cvtColor(frame_nv12, m_frame_rgba, cv::COLOR_YUV2RGBA_NV12);
-
-                        m_pD3D11Ctx->Unmap(m_pSurfaceNV12_cpu_copy, subResource);
-                    }
-
-                    {
-                        UINT subResource = ::D3D11CalcSubresource(0, 0, 1);
-
-                        D3D11_MAPPED_SUBRESOURCE mappedTex;
-                        r = m_pD3D11Ctx->Map(m_pSurfaceRGBA, subResource, D3D11_MAP_WRITE_DISCARD, 0, &mappedTex);
+                        D3D11_MAPPED_SUBRESOURCE mappedRGBA;
+                        r = m_pD3D11Ctx->Map(m_pSurfaceRGBA, subResource, D3D11_MAP_WRITE_DISCARD, 0, &mappedRGBA);
                         if (FAILED(r))
                         {
+                            m_pD3D11Ctx->Unmap(m_pSurfaceNV12_cpu_copy, subResource);
                             throw std::runtime_error("surface mapping failed!");
                         }
 
-                        cv::Mat m(m_height, m_width, CV_8UC4, mappedTex.pData, mappedTex.RowPitch);
-                        m_frame_rgba.copyTo(m);
+                        // UV plane follows the Y plane with the same pitch
+                        const uchar* y_plane = (const uchar*)mappedNV12.pData;
+                        const uchar* uv_plane = y_plane + (size_t)m_height * mappedNV12.RowPitch;
+
+                        convert_NV12_to_RGBA(y_plane, mappedNV12.RowPitch, uv_plane, mappedNV12.RowPitch,
+                                             (uchar*)mappedRGBA.pData, mappedRGBA.RowPitch, m_width, m_height);
 
                         m_pD3D11Ctx->Unmap(m_pSurfaceRGBA, subResource);
+                        m_pD3D11Ctx->Unmap(m_pSurfaceNV12_cpu_copy, subResource);
                     }
 
                     pSurface = m_pSurfaceRGBA;
@@ -419,6 +505,7 @@ public:
 
             // traditional DX render pipeline:
             //   BitBlt surface to backBuffer and flip backBuffer to frontBuffer
+            t0 = cv::getTickCount();
             m_pD3D11Ctx->CopyResource(m_pBackBuffer, pSurface);
 
             // present the back buffer contents to the display
@@ -428,6 +515,24 @@ public:
             {
                 throw std::runtime_error("switch betweem fronat and back buffers failed!");
             }
+            m_frame.stamp(Frame::STAGE_PRESENTED);
+            m_latency.add(m_frame);
+            m_quality.report(QualityController::STAGE_PRESENT, ms_since(t0));
+
+            if (m_startup && !m_startup->marked("first frame"))
+            {
+                m_startup->mark("first frame");
+#if OV_ENABLE
+                if (!m_model)
+#endif
+                    m_startup->print(std::cout);
+            }
+
+            // frames with processing switched off say nothing about the cost of a level
+            if (m_demo_processing)
+                m_quality.end_frame();
+            else
+                m_quality.discard_frame();
         } // try
 
         catch (const cv::Exception& e)
@@ -449,6 +554,50 @@ public:
 
     int cleanup(void)
     {
+        // a pre-warm may still be using the device
+        m_ocl.release();
+#if OV_ENABLE
+        if (m_surface_pending.valid())
+            m_surface_pending.wait();
+        m_surface_pending = std::future<cv::Ptr<Cnn> >();
+        m_surface_cnn.release();
+#endif
+
+        if (m_umats.created() > 0)
+            std::cout << "[umat] " << m_umats.created() << " device buffers created, "
+                      << m_umats.reused() << " reused, " << UMatPool::reserved_bytes() / 1024
+                      << " KB held by the OpenCL allocator" << std::endl;
+        m_umats.clear();
+
+#if OV_ENABLE
+        if (m_strategy && m_strategy->frames() > 0)
+            m_strategy->print(std::cout);
+#endif
+
+        if (m_arena)
+        {
+            m_arena->print(std::cout);
+            if (!m_frame.data.empty() && m_frame.data.allocator != m_arena->mat_allocator())
+                std::cout << "[arena] source frames are views of the source's own memory (e.g. a replay mapping), "
+                             "not arena buffers" << std::endl;
+        }
+
+        if (m_latency.frames() > 0)
+            m_latency.print(std::cout);
+
+        if (m_ring)
+            std::cout << "[ring] " << m_ring->name() << ": " << m_ring->published() << " frames published, "
+                      << m_ring->readers() << " readers, " << m_ring->lagging() << " lagging, "
+                      << m_ring->reclaimed() << " reclaimed" << std::endl;
+        m_ring.release();
+
+        if (m_writer)
+        {
+            m_writer->close();
+            m_writer->print(std::cout);
+        }
+        m_writer.release();
+
         SAFE_RELEASE(m_pSurfaceRGBA);
         SAFE_RELEASE(m_pSurfaceNV12);
         SAFE_RELEASE(m_pSurfaceNV12_cpu_copy);
@@ -462,56 +611,126 @@ public:
     } // cleanup()
 
 protected:
-    void convert_I420_to_NV12(cv::Mat& i420, cv::Mat& nv12, int width, int height)
+    // slots of the GPU path in m_umats
+    enum
     {
-        nv12.create(i420.rows, i420.cols, CV_8UC1);
+        UMAT_FRAME,
+        UMAT_BLURRED
+    };
 
-        unsigned char* pSrcY = i420.data;
-        unsigned char* pDstY = nv12.data;
-        size_t srcStep = i420.step[0];
-        size_t dstStep = nv12.step[0];
+    // OpenCL allocator reserve for the temporaries of cv::blur and the overlay
+    static const size_t UMAT_RESERVE_BYTES = 64 << 20;
 
-        {
-            unsigned char* src;
-            unsigned char* dst;
+    // status lines; only changed content is re-rasterized, the timing at a throttled rate
+    void update_overlay(MODE mode, QualityController::Level level)
+    {
+        m_overlay.set_line(0, cv::format("mode: %s", m_modeStr[mode].c_str()));
+        const bool cnn = level >= QualityController::LEVEL_CNN_REDUCED && m_model;
+        bool loading = cnn && m_model->loading();
+#if OV_ENABLE
+        loading = loading || (cnn && mode == MODE_GPU_RGBA && m_surface_pending.valid() && !m_surface_cnn);
+#endif
+        // strategies run on the CPU frames only, and NV12 surfaces have no network binding
+        const char* note = loading ? " (model loading)" :
+                           cnn && mode == MODE_GPU_NV12 ? " (no network on NV12)" :
+                           m_strategy && mode != MODE_CPU ? " (no reuse on GPU)" : "";
+        m_overlay.set_line(1, m_demo_processing ? cv::format("processing: %s%s", QualityController::level_name(level), note)
+                                                : "copy frame");
+        m_overlay.set_line_throttled(2, cv::format("time: %4.3f msec", m_timer.getTimeMilli()));
+        m_overlay.set_line(3, cv::format("OpenCL device: %s", m_ocl->initialized() ? m_ocl->device_name().c_str() : "not initialized"));
+    }
 
-            // copy Y plane
-            for (int i = 0; i < height; i++)
-            {
-                src = pSrcY + i*srcStep;
-                dst = pDstY + i*dstStep;
+#if OV_ENABLE
+    // between frames: swap in a finished model load; never waits for one
+    void update_model()
+    {
+        if (!m_model)
+            return;
 
-                for (int j = 0; j < width; j++)
-                {
-                    dst[j] = src[j];
-                }
-            }
+        const size_t failures = m_model->failures();
+        if (m_model->update() && m_model->swaps() > 1)
+        {
+            std::cout << "[model] switched to " << m_model->path() << std::endl;
+
+            // a keyframe of the old network would be warped on
+            reset_strategy();
         }
+        update_surface_cnn();
 
-        {
-            // copy U/V planes to UV plane
-            unsigned char* pSrcU;
-            unsigned char* pSrcV;
-            unsigned char* pDstUV;
+        // the startup report would otherwise wait for a first CNN frame that never comes
+        if (m_model->failures() != failures && !m_model->current() && m_startup)
+            m_startup->print(std::cout);
+    }
 
-            size_t uv_offset = height * dstStep;
+    // network on the shared RGBA surface, compiled for the D3D11 device on a background
+    // thread after its first use; frames skip it until then
+    bool surface_cnn_ready()
+    {
+        if (m_surface_cnn)
+            return true;
+        if (!m_surface_cnn_failed && m_model && !m_surface_pending.valid())
+            start_surface_cnn();
+        return false;
+    }
+
+    // compile the current model for the D3D11 device on a thread of its own;
+    // update_surface_cnn() picks it up
+    void start_surface_cnn()
+    {
+        m_surface_pending_swap = m_model->swaps();
+        m_surface_pending = std::async(std::launch::async, [device = m_pD3D11Dev, size = cv::Size(m_width, m_height),
+                                                            path = m_model->path()]() {
+            cv::Ptr<Cnn> cnn = cv::makePtr<Cnn>();
+            cnn->Init(path, std::make_shared<D3D11SurfaceBinding>(device, size));
+            return cnn;
+        });
+    }
 
-            for (int i = 0; i < height / 2; i++)
+    // Between frames: swap in a finished surface network; never waits for one. A failed
+    // build keeps the network there was, if any. The surface network follows the host
+    // one: once a surface network was wanted, every HotModel swap compiles it again,
+    // and frames keep using the old one until the new one is in.
+    void update_surface_cnn()
+    {
+        if (m_surface_pending.valid() && m_surface_pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            m_surface_cnn_swap = m_surface_pending_swap;
+            try
+            {
+                m_surface_cnn = m_surface_pending.get();
+            }
+            catch (const std::exception& e)
             {
-                pSrcU = pSrcY + height*width + i*(width / 2);
-                pSrcV = pSrcY + height*width + (height / 2) * (width / 2) + i*(width / 2);
+                std::cerr << "can not load " << m_model->path() << " for D3D11 surfaces: " << e.what() << std::endl;
+            }
+            m_surface_cnn_failed = !m_surface_cnn;
+        }
 
-                pDstUV = pDstY + uv_offset + i*dstStep;
+        if (!m_surface_pending.valid() && (m_surface_cnn || m_surface_cnn_failed) &&
+            m_surface_cnn_swap != m_model->swaps())
+            start_surface_cnn();
+    }
 
-                for (int j = 0; j < width / 2; j++)
-                {
-                    pDstUV[j*2 + 0] = pSrcU[j];
-                    pDstUV[j*2 + 1] = pSrcV[j];
-                }
-            }
+    void reset_strategy()
+    {
+        if (m_strategy)
+            m_strategy->reset();
+        m_styled.release();
+    }
+
+    void first_cnn_frame()
+    {
+        if (m_startup && !m_startup->marked("first CNN frame"))
+        {
+            m_startup->mark("first CNN frame");
+            m_startup->print(std::cout);
         }
+    }
+#endif
 
-        return;
+    static double ms_since(int64 t0)
+    {
+        return (cv::getTickCount() - t0) * 1000. / cv::getTickFrequency();
     }
 
 private:
@@ -520,20 +739,23 @@ private:
     ID3D11DeviceContext*    m_pD3D11Ctx;
     ID3D11Texture2D*        m_pBackBuffer;
     ID3D11Texture2D*        m_pSurfaceRGBA;
-    ID3D11Texture2D*        m_pSurfaceRGB;
-    ID3D11Buffer*           output_buffer;
     ID3D11Texture2D*        m_pSurfaceNV12;
     ID3D11Texture2D*        m_pSurfaceNV12_cpu_copy;
     ID3D11RenderTargetView* m_pRenderTarget;
-    cv::ocl::Context        m_oclCtx;
-    cv::String              m_oclPlatformName;
-    cv::String              m_oclDevName;
+    cv::Ptr<LazyOpenCLContext> m_ocl;
+    UMatPool                m_umats;
     bool                    m_nv12_available;
     cv::Mat                 m_frame_i420;
     cv::Mat                 m_frame_nv12;
+    TextOverlay             m_overlay;
+    QualityController       m_quality;
 #if OV_ENABLE
-    ov::Core                    *core;
-    Cnn                     modelcnn;
+    cv::Ptr<Cnn>            m_surface_cnn;
+    bool                    m_surface_cnn_failed;
+    size_t                  m_surface_cnn_swap;      // HotModel swap the surface network was built after
+    std::future<cv::Ptr<Cnn> > m_surface_pending;    // build in progress
+    size_t                  m_surface_pending_swap;  // HotModel swap the pending build is for
+    cv::Mat                 m_styled;   // last output of m_strategy
 #endif
 };
 
@@ -4,6 +4,7 @@
 */
 #include <string>
 #include <iostream>
+#include <memory>
 #include <queue>
 
 #include "opencv2/core.hpp"
@@ -14,6 +15,17 @@
 #include "inference_engine.hpp"
 
 #include "winapp.hpp"
+#include "frame_latency.hpp"
+#include "frame_source.hpp"
+#include "frame_record.hpp"
+#include "frame_ring.hpp"
+#include "hot_model.hpp"
+#include "huge_page_arena.hpp"
+#include "infer_strategy.hpp"
+#include "inference_server.hpp"
+#include "segment_job.hpp"
+#include "startup_report.hpp"
+#include "video_sink.hpp"
 
 #define SAFE_RELEASE(p) if (p) { p->Release(); p = NULL; }
 
@@ -28,7 +40,7 @@ public:
         MODE_GPU_NV12
     };
 
-    D3DSample(int width, int height, std::string& window_name, cv::VideoCapture& cap) :
+    D3DSample(int width, int height, std::string& window_name, const cv::Ptr<FrameSource>& source) :
         WinApp(width, height, window_name)
     {
         m_shutdown          = false;
@@ -37,12 +49,66 @@ public:
         m_modeStr[1]        = cv::String("Processing on GPU RGBA");
         m_modeStr[2]        = cv::String("Processing on GPU NV12");
         m_demo_processing   = true;
-        m_cap               = cap;
+        m_source            = source;
+        m_target_fps        = 0;
+        m_startup           = 0;
+        m_prewarm_opencl    = false;
+        m_arena             = 0;
+        m_watermark         = false;
     }
 
     ~D3DSample() {}
 
-    virtual int create() { return WinApp::create(); }
+    // frame rate the adaptive quality control should hold, 0 to always process fully
+    void set_target_fps(double fps) { m_target_fps = fps; }
+
+    // every frame read from the source is also appended to the recorder
+    void set_recorder(const cv::Ptr<FrameRecorder>& recorder) { m_recorder = recorder; }
+
+    // processed frames, as presented, are also published to the ring for local consumer
+    // processes
+    void set_ring(const cv::Ptr<FrameRingWriter>& ring) { m_ring = ring; }
+
+    // processed frames, as presented, are also encoded to a video file on a thread of its own
+    void set_writer(const cv::Ptr<VideoWriterSink>& writer) { m_writer = writer; }
+
+    // sequence number and capture time are drawn into every frame before it leaves the app
+    void set_watermark(bool watermark) { m_watermark = watermark; }
+
+    // per-frame buffers are allocated from the arena, which must outlive the app. Source
+    // frames are too when the source decodes into them (camera, movie file); a replay
+    // hands out views of its mapping instead.
+    void set_arena(HugePageArena* arena)
+    {
+        m_arena = arena;
+        m_frame.data.allocator = arena ? arena->mat_allocator() : 0;
+        m_frame_rgba.allocator = arena ? arena->mat_allocator() : 0;
+    }
+
+    // phases of create() and the first frames are added to the report
+    void set_startup_report(StartupReport* report) { m_startup = report; }
+
+    // network for CPU frames, loaded in the background; frames are shown without it until
+    // the first load finishes, and later loads are swapped in between frames
+    void set_model(const cv::Ptr<HotModel>& model) { m_model = model; }
+
+    // CPU frames show the stylized output, produced the strategy's way; without one the
+    // network runs on every CPU frame and its output isn't shown
+    void set_strategy(const InferStrategy::Config& config) { m_strategy = cv::makePtr<InferStrategy>(config); }
+
+    // build the OpenCL context and kernels of the GPU modes in the background right after
+    // startup instead of when a GPU mode is first selected
+    void set_prewarm_opencl(bool prewarm) { m_prewarm_opencl = prewarm; }
+
+    virtual int create()
+    {
+        if (m_startup)
+            m_startup->begin("window");
+        int r = WinApp::create();
+        if (m_startup)
+            m_startup->end("window");
+        return r;
+    }
     virtual int render() = 0;
     virtual int cleanup()
     {
@@ -71,6 +137,12 @@ protected:
                 m_mode = MODE_GPU_NV12;
                 return EXIT_SUCCESS;
             }
+            else if (wParam == 'r' || wParam == 'R')
+            {
+                if (m_model)
+                    m_model->reload(m_model->path());
+                return EXIT_SUCCESS;
+            }
             else if (wParam == VK_SPACE)
             {
                 m_demo_processing = !m_demo_processing;
@@ -97,14 +169,25 @@ protected:
     virtual int idle() { return render(); }
 
 protected:
-    bool               m_shutdown;
-    bool               m_demo_processing;
-    MODE               m_mode;
-    cv::String         m_modeStr[3];
-    cv::VideoCapture   m_cap;
-    cv::Mat            m_frame_bgr;
-    cv::Mat            m_frame_rgba;
-    cv::TickMeter      m_timer;
+    bool                   m_shutdown;
+    bool                   m_demo_processing;
+    MODE                   m_mode;
+    cv::String             m_modeStr[3];
+    double                 m_target_fps;
+    cv::Ptr<FrameSource>   m_source;
+    cv::Ptr<FrameRecorder> m_recorder;
+    cv::Ptr<FrameRingWriter> m_ring;
+    cv::Ptr<VideoWriterSink> m_writer;
+    HugePageArena*         m_arena;
+    bool                   m_watermark;
+    FrameLatency           m_latency;
+    cv::Ptr<HotModel>      m_model;
+    cv::Ptr<InferStrategy> m_strategy;
+    StartupReport*         m_startup;
+    bool                   m_prewarm_opencl;
+    Frame                  m_frame;
+    cv::Mat                m_frame_rgba;
+    cv::TickMeter          m_timer;
 };
 
 
@@ -112,6 +195,28 @@ static const char* keys =
 {
     "{c camera | 0     | camera id  }"
     "{f file   |       | movie file name  }"
+    "{fps      | 0     | target frame rate, processing is scaled down to hold it (0 - off) }"
+    "{record   |       | record decoded frames to this file }"
+    "{nv12     | false | record frames as NV12 instead of BGR }"
+    "{replay   |       | play frames from a recording instead of camera or movie }"
+    "{unthrottled | false | replay as fast as frames are consumed instead of at the recorded pace }"
+    "{loop     | false | restart the replay at its end }"
+    "{model    | models/model_composition_v5_no_padding.xml | style network, compiled in the background (empty - off) }"
+    "{device   | GPU   | inference device of the style network on CPU frames }"
+    "{watch    | false | reload the model when its file changes }"
+    "{prewarm  | false | initialize OpenCL in the background at startup instead of on first use }"
+    "{ring     |       | publish processed frames to this shared-memory ring for consumer processes }"
+    "{ring_slots | 8   | frames the ring holds; readers further behind skip ahead }"
+    "{write    |       | encode processed frames to this video file on a background thread }"
+    "{write_policy | block | when the encoder falls behind: block, drop_newest or drop_oldest }"
+    "{watermark | false | stamp sequence number and capture time into every frame as text and a bit strip, for external latency checks }"
+    "{reuse    | none  | show the stylized CPU frames, with the network on: none (every frame, output not shown as before), every_frame, temporal (keyframes, flow-warped in between), change (last output while the frame barely changes) or tiles (only changed tiles, in crops of the network input) }"
+    "{change_threshold | 3 | --reuse change: mean block difference, in 8-bit levels, that counts as a change }"
+    "{huge_pages | off | frame buffers and host tensors from an arena of: off, default, transparent or explicit huge pages }"
+    "{restyle  |       | restyle the movie file offline into this file, in parallel segments on the CPU, and exit }"
+    "{workers  | 0     | worker processes for --restyle (0 - one per 4 cores) }"
+    "{serve    |       | serve the style network to local processes on this Unix domain socket, no window }"
+    "{segment_worker | | internal: process one --restyle segment described by this task file }"
 };
 
 
@@ -119,8 +224,18 @@ template <typename TApp>
 int d3d_app(int argc, char** argv, std::string& title)
 {
     cv::CommandLineParser parser(argc, argv, keys);
+
+    const std::string segment_task = parser.get<std::string>("segment_worker");
+    if (!segment_task.empty())
+        return run_segment_worker(segment_task);
+
     std::string file = parser.get<std::string>("file");
     int    camera_id = parser.get<int>("camera");
+    double fps       = parser.get<double>("fps");
+    std::string record = parser.get<std::string>("record");
+    std::string replay = parser.get<std::string>("replay");
+    std::string model  = parser.get<std::string>("model");
+    std::string device = parser.get<std::string>("device");
 
     parser.about(
         "\nA sample program demonstrating interoperability of DirectX and OpenCL with OpenCV.\n\n"
@@ -129,29 +244,215 @@ int d3d_app(int argc, char** argv, std::string& title)
         "    1   - process DX surface through OpenCV on CPU\n"
         "    2   - process DX RGBA surface through OpenCV on GPU (via OpenCL)\n"
         "    3   - process DX NV12 surface through OpenCV on GPU (via OpenCL)\n"
+        "    R   - reload the model file, swapped in once compiled\n"
         "   ESC  - exit\n\n");
 
     parser.printMessage();
 
-    cv::VideoCapture cap;
+    const std::string serve = parser.get<std::string>("serve");
+    if (!serve.empty())
+    {
+        InferenceServer::Config server_config;
+        server_config.socket_path = serve;
+        server_config.model       = model;
+        server_config.device      = device;
+        return run_inference_server(server_config);
+    }
 
-    if (file.empty())
-        cap.open(camera_id);
-    else
-        cap.open(file.c_str());
+    const std::string restyle = parser.get<std::string>("restyle");
+    if (!restyle.empty())
+    {
+        if (file.empty() || model.empty())
+        {
+            printf("--restyle needs a movie file and a model\n");
+            return EXIT_FAILURE;
+        }
+
+        SegmentJob::Config job_config;
+        job_config.input   = file;
+        job_config.output  = restyle;
+        job_config.model   = model;
+        job_config.workers = parser.get<int>("workers");
+
+        try
+        {
+            SegmentJob job(job_config);
+            job.run(std::cout);
+        }
+        catch (const std::exception& e)
+        {
+            printf("restyling failed: %s\n", e.what());
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // declared before anything allocating from it
+    std::unique_ptr<HugePageArena> arena;
+    const std::string huge_pages = parser.get<std::string>("huge_pages");
+    if (huge_pages != "off")
+    {
+        HugePageArena::Config arena_config;
+        if (huge_pages == "default")
+            arena_config.pages = HugePageArena::PAGES_DEFAULT;
+        else if (huge_pages == "transparent")
+            arena_config.pages = HugePageArena::PAGES_TRANSPARENT;
+        else if (huge_pages == "explicit")
+            arena_config.pages = HugePageArena::PAGES_EXPLICIT;
+        else
+        {
+            printf("unknown huge pages: %s\n", huge_pages.c_str());
+            return EXIT_FAILURE;
+        }
+        arena.reset(new HugePageArena(arena_config));
+    }
+
+    StartupReport startup;
 
-    if (!cap.isOpened())
+    // the network compiles while the source, window and device open
+    cv::Ptr<HotModel> hot_model;
+    if (!model.empty())
     {
-        printf("can not open camera or video file\n");
-        return EXIT_FAILURE;
+        HotModel::Config model_config;
+        model_config.device            = device;
+        model_config.input_size        = cv::Size(640, 480);
+        model_config.watch_interval_ms = parser.get<bool>("watch") ? 500 : 0;
+        model_config.arena             = arena.get();
+        hot_model = cv::makePtr<HotModel>(model_config);
+
+        hot_model->load(cv::makePtr<ModelLoader>(model, device,
+            [](const std::shared_ptr<ov::Model>& m) { return prepare_host_input(m, cv::Size(640, 480)); },
+            ov::AnyMap(), &startup));
     }
 
-    int width  = (int)cap.get(cv::CAP_PROP_FRAME_WIDTH);
-    int height = (int)cap.get(cv::CAP_PROP_FRAME_HEIGHT);
+    startup.begin("source open");
+
+    cv::Ptr<FrameSource> source;
+
+    if (!replay.empty())
+    {
+        try
+        {
+            source = cv::makePtr<ReplaySource>(replay, !parser.get<bool>("unthrottled"), parser.get<bool>("loop"));
+        }
+        catch (const std::exception& e)
+        {
+            printf("can not open recording: %s\n", e.what());
+            return EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        cv::VideoCapture cap;
+
+        if (file.empty())
+            cap.open(camera_id);
+        else
+            cap.open(file.c_str());
+
+        if (!cap.isOpened())
+        {
+            printf("can not open camera or video file\n");
+            return EXIT_FAILURE;
+        }
+
+        source = cv::makePtr<CaptureSource>(cap);
+    }
+
+    startup.end("source open");
+
+    int width  = source->size().width;
+    int height = source->size().height;
 
     std::string wndname = title;
 
-    TApp app(width, height, wndname, cap);
+    TApp app(width, height, wndname, source);
+    app.set_target_fps(fps);
+    app.set_startup_report(&startup);
+    app.set_model(hot_model);
+    app.set_prewarm_opencl(parser.get<bool>("prewarm"));
+    app.set_arena(arena.get());
+    app.set_watermark(parser.get<bool>("watermark"));
+
+    const std::string reuse = parser.get<std::string>("reuse");
+    if (reuse != "none")
+    {
+        InferStrategy::Config strategy;
+        if (reuse == "every_frame")
+            strategy.mode = InferStrategy::MODE_EVERY_FRAME;
+        else if (reuse == "temporal")
+            strategy.mode = InferStrategy::MODE_TEMPORAL;
+        else if (reuse == "change")
+            strategy.mode = InferStrategy::MODE_CHANGE;
+        else if (reuse == "tiles")
+            strategy.mode = InferStrategy::MODE_TILES;
+        else
+        {
+            printf("unknown reuse: %s\n", reuse.c_str());
+            return EXIT_FAILURE;
+        }
+        strategy.change.threshold    = parser.get<double>("change_threshold");
+        strategy.tiles.network_input = cv::Size(640, 480);
+        app.set_strategy(strategy);
+    }
+
+    if (!record.empty())
+    {
+        try
+        {
+            app.set_recorder(cv::makePtr<FrameRecorder>(record, parser.get<bool>("nv12") ? FRAME_NV12 : FRAME_BGR, source->size()));
+        }
+        catch (const std::exception& e)
+        {
+            printf("can not create recording: %s\n", e.what());
+            return EXIT_FAILURE;
+        }
+    }
+
+    const std::string ring = parser.get<std::string>("ring");
+    if (!ring.empty())
+    {
+        try
+        {
+            app.set_ring(cv::makePtr<FrameRingWriter>(ring, source->size(), CV_8UC4, parser.get<int>("ring_slots")));
+        }
+        catch (const std::exception& e)
+        {
+            printf("can not create frame ring: %s\n", e.what());
+            return EXIT_FAILURE;
+        }
+    }
+
+    const std::string write = parser.get<std::string>("write");
+    if (!write.empty())
+    {
+        VideoWriterSink::Config writer;
+        writer.path = write;
+        writer.fps  = fps > 0 ? fps : 30;
+
+        const std::string policy = parser.get<std::string>("write_policy");
+        if (policy == "block")
+            writer.backpressure = VideoWriterSink::BLOCK;
+        else if (policy == "drop_newest")
+            writer.backpressure = VideoWriterSink::DROP_NEWEST;
+        else if (policy == "drop_oldest")
+            writer.backpressure = VideoWriterSink::DROP_OLDEST;
+        else
+        {
+            printf("unknown write policy: %s\n", policy.c_str());
+            return EXIT_FAILURE;
+        }
+
+        try
+        {
+            app.set_writer(cv::makePtr<VideoWriterSink>(writer, source->size()));
+        }
+        catch (const std::exception& e)
+        {
+            printf("can not create output video: %s\n", e.what());
+            return EXIT_FAILURE;
+        }
+    }
 
     //try
     //{
@@ -0,0 +1,221 @@
+/*
+// Earliest-deadline-first scheduling of inference requests over a pool of workers
+*/
+#include "edf_scheduler.hpp"
+
+#include <algorithm>
+#include <memory>
+
+#include "hot_model.hpp"
+
+namespace
+{
+
+// weight of the newest run time in the service time estimate
+const double SERVICE_ALPHA = 0.2;
+
+double ticks_to_ms(int64 ticks)
+{
+    return ticks * 1000. / cv::getTickFrequency();
+}
+
+} // namespace
+
+
+bool EdfScheduler::Later::operator()(const Request* a, const Request* b) const
+{
+    if (edf)
+    {
+        if (a->deadline != b->deadline)
+            return a->deadline > b->deadline;
+        if (a->priority != b->priority)
+            return a->priority < b->priority;
+    }
+    return a->order > b->order;
+}
+
+
+EdfScheduler::EdfScheduler(const Config& config, const WorkerFn& work) :
+    m_config(config),
+    m_work(work),
+    m_arrivals(0),
+    m_stop(false),
+    m_service_ms(0),
+    m_stats(config.streams)
+{
+    CV_Assert(config.workers > 0 && config.streams > 0 && work);
+
+    for (size_t i = 0; i < config.workers; i++)
+        m_workers.push_back(std::thread(&EdfScheduler::run, this, i));
+}
+
+
+EdfScheduler::~EdfScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_pending_cv.notify_all();
+    for (size_t i = 0; i < m_workers.size(); i++)
+        m_workers[i].join();
+}
+
+
+EdfScheduler::WorkerFn EdfScheduler::networks(ov::CompiledModel compiled, cv::Size input_size, size_t workers)
+{
+    std::vector<std::shared_ptr<HostNetwork> > pool;
+    for (size_t i = 0; i < workers; i++)
+        pool.push_back(std::make_shared<HostNetwork>(compiled, input_size, std::string()));
+
+    return [pool](size_t worker, const cv::Mat& rgba, cv::Mat& output) { pool[worker]->infer(rgba, output); };
+}
+
+
+EdfScheduler::Status EdfScheduler::infer(int stream, const cv::Mat& rgba, cv::Mat& output, double deadline_ms, int priority)
+{
+    CV_Assert(stream >= 0 && stream < m_config.streams);
+
+    Request request;
+    request.stream    = stream;
+    request.rgba      = &rgba;
+    request.output    = &output;
+    request.submitted = cv::getTickCount();
+    request.deadline  = request.submitted + (int64)(deadline_ms * cv::getTickFrequency() / 1000.);
+    request.priority  = priority;
+    request.finished  = false;
+    request.status    = DROPPED;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_stop)
+        throw std::runtime_error("EdfScheduler is stopped");
+
+    request.order = m_arrivals++;
+    m_stats[stream].submitted++;
+
+    m_pending.push_back(&request);
+    std::push_heap(m_pending.begin(), m_pending.end(), Later{ m_config.edf });
+    m_pending_cv.notify_one();
+
+    m_finished_cv.wait(lock, [&request]() { return request.finished; });
+
+    if (!request.error.empty())
+        throw std::runtime_error(request.error);
+    return request.status;
+}
+
+
+EdfScheduler::InferFn EdfScheduler::stream(int stream, double deadline_ms, int priority)
+{
+    CV_Assert(stream >= 0 && stream < m_config.streams);
+
+    return [this, stream, deadline_ms, priority](const cv::Mat& rgba, cv::Mat& output) {
+        if (infer(stream, rgba, output, deadline_ms, priority) == DROPPED)
+            output.release();
+    };
+}
+
+
+void EdfScheduler::run(size_t worker)
+{
+    const Later later{ m_config.edf };
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_pending_cv.wait(lock, [this]() { return m_stop || !m_pending.empty(); });
+        if (m_stop)
+            break;
+
+        std::pop_heap(m_pending.begin(), m_pending.end(), later);
+        Request* request = m_pending.back();
+        m_pending.pop_back();
+
+        StreamStats& stats = m_stats[request->stream];
+
+        // it would finish too late: give the worker to a frame that still can make it
+        const int64 now = cv::getTickCount();
+        if (m_config.edf && ticks_to_ms(request->deadline - now) < m_service_ms)
+        {
+            stats.dropped++;
+            request->status   = DROPPED;
+            request->finished = true;
+            m_finished_cv.notify_all();
+            continue;
+        }
+
+        lock.unlock();
+        std::string error;
+        try
+        {
+            m_work(worker, *request->rgba, *request->output);
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+        const int64 end = cv::getTickCount();
+        lock.lock();
+
+        // a run that threw says nothing about the service time, nor about the latency
+        if (!error.empty())
+        {
+            stats.failed++;
+            request->error    = error;
+            request->finished = true;
+            m_finished_cv.notify_all();
+            continue;
+        }
+
+        m_service_ms = m_service_ms == 0 ? ticks_to_ms(end - now)
+                                         : (1 - SERVICE_ALPHA) * m_service_ms + SERVICE_ALPHA * ticks_to_ms(end - now);
+
+        if (end > request->deadline)
+        {
+            stats.late++;
+            request->status = LATE;
+        }
+        else
+        {
+            stats.done++;
+            request->status = DONE;
+        }
+        stats.latency.add(ticks_to_ms(end - request->submitted));
+
+        request->finished = true;
+        m_finished_cv.notify_all();
+    }
+
+    // hand back whatever is still pending
+    for (size_t i = 0; i < m_pending.size(); i++)
+    {
+        m_stats[m_pending[i]->stream].dropped++;
+        m_pending[i]->status   = DROPPED;
+        m_pending[i]->finished = true;
+    }
+    m_pending.clear();
+    m_finished_cv.notify_all();
+}
+
+
+EdfScheduler::StreamStats EdfScheduler::stats(int stream) const
+{
+    CV_Assert(stream >= 0 && stream < m_config.streams);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats[stream];
+}
+
+
+double EdfScheduler::service_ms() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_service_ms;
+}
+
+
+size_t EdfScheduler::pending() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending.size();
+}
@@ -0,0 +1,125 @@
+/*
+// Earliest-deadline-first scheduling of inference requests over a pool of workers
+*/
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "opencv2/core.hpp"
+#include "openvino/openvino.hpp"
+
+#include "latency_histogram.hpp"
+
+// Streams with different latency SLOs share a pool of workers, typically one infer request
+// each. Every frame comes with a deadline relative to its submission and a priority; idle
+// workers take the pending frame with the earliest deadline, the higher priority first on
+// equal deadlines. A frame whose deadline can't be met anymore - it would finish after it
+// at the current service time - is dropped rather than run, so it doesn't delay frames
+// that still can make theirs. Frames that run but finish late count as misses too, as do
+// frames whose work threw.
+//
+// With edf off the pool serves frames first come first served and never drops, the
+// baseline to compare against.
+class EdfScheduler
+{
+public:
+    // run the frame on `worker`; calls with different workers may run concurrently
+    typedef std::function<void(size_t worker, const cv::Mat& rgba, cv::Mat& output)> WorkerFn;
+
+    // FramePipeline::InferFn, FlowPipeline::InferFn
+    typedef std::function<void(const cv::Mat& rgba, cv::Mat& output)> InferFn;
+
+    struct Config
+    {
+        size_t workers = 2;
+        int    streams = 1;      // stream ids in [0, streams)
+        bool   edf     = true;
+    };
+
+    enum Status
+    {
+        DONE,
+        LATE,       // ran, finished after the deadline
+        DROPPED     // not run, it could not have made the deadline
+    };
+
+    struct StreamStats
+    {
+        size_t           submitted = 0;
+        size_t           done      = 0;
+        size_t           late      = 0;
+        size_t           dropped   = 0;
+        size_t           failed    = 0;   // ran, the work threw
+        LatencyHistogram latency;      // submission to result, of frames that ran without failing
+
+        double miss_rate() const { return submitted ? double(late + dropped + failed) / submitted : 0.; }
+    };
+
+    EdfScheduler(const Config& config, const WorkerFn& work);
+
+    // stops the workers; frames still pending come back DROPPED
+    ~EdfScheduler();
+
+    // one infer request per worker on a model compiled with prepare_host_input; the
+    // stylized frame comes back as RGBA of the input's size
+    static WorkerFn networks(ov::CompiledModel compiled, cv::Size input_size, size_t workers);
+
+    // blocks until the frame ran or was dropped; thread safe. Rethrows what the work threw.
+    Status infer(int stream, const cv::Mat& rgba, cv::Mat& output, double deadline_ms, int priority = 0);
+
+    // One stream's frames through the scheduler, as the network of a pipeline. A dropped
+    // frame comes back with an empty output, which the pipelines show unstyled. The
+    // scheduler must outlive the function.
+    InferFn stream(int stream, double deadline_ms, int priority = 0);
+
+    StreamStats stats(int stream) const;
+
+    // running estimate of one frame's service time
+    double service_ms() const;
+
+    // frames waiting for a worker
+    size_t pending() const;
+
+private:
+    struct Request
+    {
+        int            stream;
+        const cv::Mat* rgba;
+        cv::Mat*       output;
+        int64          submitted;
+        int64          deadline;    // ticks
+        int            priority;
+        size_t         order;       // arrival, for FIFO and stable ties
+        bool           finished;
+        Status         status;
+        std::string    error;
+    };
+
+    // heap order: the request to run next on top
+    struct Later
+    {
+        bool edf;
+        bool operator()(const Request* a, const Request* b) const;
+    };
+
+    void run(size_t worker);
+
+    Config                   m_config;
+    WorkerFn                 m_work;
+
+    mutable std::mutex       m_mutex;
+    std::condition_variable  m_pending_cv;
+    std::condition_variable  m_finished_cv;
+    std::vector<Request*>    m_pending;     // heap
+    size_t                   m_arrivals;
+    bool                     m_stop;
+    double                   m_service_ms;  // EWMA of run times
+    std::vector<StreamStats> m_stats;
+
+    std::vector<std::thread> m_workers;
+};
@@ -0,0 +1,162 @@
+/*
+// Frame pipeline as a TBB flow graph: stages of consecutive frames run concurrently
+*/
+#include "flow_pipeline.hpp"
+
+#include <algorithm>
+
+#include "tbb/flow_graph.h"
+
+#include "box_filter.hpp"
+
+FlowPipeline::FlowPipeline(const Config& config, const cv::Ptr<FrameSource>& source, const cv::Ptr<FrameSink>& sink,
+                           const InferFn& infer) :
+    m_config(config),
+    m_source(source),
+    m_sink(sink),
+    m_infer(infer),
+    m_overlay(3, cv::Scalar(0, 0, 200)),
+    m_limit(0),
+    m_decoded(0),
+    m_eos(false),
+    m_frames(0),
+    m_out_of_order(0),
+    m_last_seq(0),
+    m_latency_sum_us(0),
+    m_latency_max_us(0)
+{
+    CV_Assert(m_source && m_sink && m_config.max_in_flight > 0);
+}
+
+
+// input_node body: called serially, so the source needs no locking
+bool FlowPipeline::decode(Slot*& slot)
+{
+    if (m_eos || (m_limit && m_decoded >= m_limit))
+        return false;
+
+    if (!m_free.try_pop(slot))
+    {
+        m_slots.push_back(std::unique_ptr<Slot>(new Slot()));
+        slot = m_slots.back().get();
+
+        // every buffer the stages create in place is then allocated by it
+        if (m_config.allocator)
+        {
+            slot->frame.data.allocator = m_config.allocator;
+            slot->rgba.allocator       = m_config.allocator;
+            slot->inferred.allocator   = m_config.allocator;
+        }
+    }
+
+    if (!m_source->read(slot->frame))
+    {
+        m_free.push(slot);
+        m_eos = true;
+        return false;
+    }
+
+    slot->frame.clear_stages();
+    slot->frame.stamp(Frame::STAGE_READ);
+    slot->index = m_decoded++;
+    return true;
+}
+
+
+// sink node body: serial and in source order
+void FlowPipeline::present(Slot* slot)
+{
+    slot->frame.stamp(Frame::STAGE_SINK);
+    m_sink->consume(slot->frame, slot->output);
+    slot->frame.stamp(Frame::STAGE_PRESENTED);
+    m_latency.add(slot->frame);
+
+    const int64 latency = now_us() - slot->frame.timestamp_us;
+    m_latency_sum_us += latency;
+    m_latency_max_us = std::max(m_latency_max_us, latency);
+
+    if (m_frames > 0 && slot->frame.seq <= m_last_seq)
+        m_out_of_order++;
+    m_last_seq = slot->frame.seq;
+    m_frames++;
+
+    m_free.push(slot);
+}
+
+
+size_t FlowPipeline::run(size_t max_frames)
+{
+    using namespace tbb::flow;
+
+    const size_t frames_before = m_frames;
+    m_limit   = max_frames;
+    m_decoded = 0;
+
+    graph g;
+
+    input_node<Slot*> decode_node(g, [this](Slot*& slot) { return decode(slot); });
+
+    limiter_node<Slot*> limiter(g, m_config.max_in_flight);
+
+    function_node<Slot*, Slot*> convert(g, m_config.convert_concurrency, [](Slot* slot) {
+        // the wait behind the limiter and for a free converter is handoff, not conversion
+        slot->frame.stamp(Frame::STAGE_CONVERTING);
+        frame_to_rgba(slot->frame, slot->rgba);
+        slot->frame.stamp(Frame::STAGE_CONVERTED);
+        return slot;
+    });
+
+    function_node<Slot*, Slot*> preprocess(g, m_config.preprocess_concurrency, [this](Slot* slot) {
+        if (m_config.blur_ksize.area() > 1)
+            box_blur_rgba(slot->rgba, m_config.blur_ksize);
+        return slot;
+    });
+
+    function_node<Slot*, Slot*> infer(g, m_config.infer_concurrency, [this](Slot* slot) {
+        if (m_infer)
+        {
+            m_infer(slot->rgba, slot->inferred);
+            slot->frame.stamp(Frame::STAGE_INFERRED);
+        }
+        return slot;
+    });
+
+    sequencer_node<Slot*> sequencer(g, [](Slot* const& slot) { return slot->index; });
+
+    function_node<Slot*, Slot*> postprocess(g, serial, [this](Slot* slot) {
+        const bool inferred = m_infer && slot->inferred.size() == slot->rgba.size() && slot->inferred.type() == slot->rgba.type();
+        slot->output = inferred ? slot->inferred : slot->rgba;
+
+        if (m_config.overlay)
+        {
+            const cv::Size size = slot->frame.size();
+            m_overlay.set_line(0, cv::format("source: %dx%d %s", size.width, size.height,
+                                             slot->frame.format == FRAME_NV12 ? "NV12" : "BGR"));
+            m_overlay.set_line(1, cv::format("processing: flow graph, %d in flight", (int)m_config.max_in_flight));
+            m_overlay.set_line_throttled(2, cv::format("frame: %llu", (unsigned long long)slot->frame.seq));
+            m_overlay.compose(slot->output);
+        }
+        if (m_config.watermark)
+            draw_watermark(slot->output, slot->frame);
+        return slot;
+    });
+
+    function_node<Slot*, continue_msg> sink(g, serial, [this](Slot* slot) {
+        present(slot);
+        return continue_msg();
+    });
+
+    make_edge(decode_node, limiter);
+    make_edge(limiter, convert);
+    make_edge(convert, preprocess);
+    make_edge(preprocess, infer);
+    make_edge(infer, sequencer);
+    make_edge(sequencer, postprocess);
+    make_edge(postprocess, sink);
+    make_edge(sink, limiter.decrement);
+
+    decode_node.activate();
+    g.wait_for_all();
+
+    return m_frames - frames_before;
+}
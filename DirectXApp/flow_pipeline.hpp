@@ -0,0 +1,97 @@
+/*
+// Frame pipeline as a TBB flow graph: stages of consecutive frames run concurrently
+*/
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "opencv2/core.hpp"
+#include "tbb/concurrent_queue.h"
+
+#include "frame_source.hpp"
+#include "overlay.hpp"
+#include "pipeline.hpp"
+
+// The stages of FramePipeline as a flow graph:
+//
+//   decode -> limiter -> convert -> preprocess -> infer -> sequencer -> postprocess -> sink
+//      ^          ^                                                                    |
+//      |          +-------------------- frame done (decrement) ------------------------+
+//
+// decode reads the source serially; the limiter caps the number of frames in flight, so
+// memory and latency stay bounded; convert (BGR/NV12 -> RGBA), preprocess (blur) and
+// infer run with configurable concurrency, so several frames are processed at once; the
+// sequencer restores source order before the serial postprocess (network output
+// selection, overlay) and sink stages. Frame buffers are recycled through a free list.
+//
+// With infer_concurrency > 1 the InferFn is called from several threads at once and must
+// be thread safe (e.g. one infer request per thread).
+class FlowPipeline
+{
+public:
+    typedef FramePipeline::InferFn InferFn;
+
+    struct Config
+    {
+        cv::Size          blur_ksize             = cv::Size(15, 15);
+        bool              overlay                = true;
+        size_t            max_in_flight          = 4;
+        size_t            convert_concurrency    = 0;   // 0 - unlimited
+        size_t            preprocess_concurrency = 0;   // 0 - unlimited
+        size_t            infer_concurrency      = 1;   // 0 - unlimited
+        cv::MatAllocator* allocator              = 0;   // frame buffers, e.g. node-local; 0 - OpenCV's default.
+                                                        // Source frames only if the source fills frame.data
+        bool              watermark              = false;   // draw_watermark() on every frame before the sink
+    };
+
+    FlowPipeline(const Config& config, const cv::Ptr<FrameSource>& source, const cv::Ptr<FrameSink>& sink,
+                 const InferFn& infer = InferFn());
+
+    // process up to max_frames frames (0 - until the source ends); returns the number processed
+    size_t run(size_t max_frames = 0);
+
+    size_t frames() const { return m_frames; }
+    size_t out_of_order() const { return m_out_of_order; }
+
+    // source read to sink, per frame
+    double mean_latency_ms() const { return m_frames ? m_latency_sum_us / 1000. / m_frames : 0.; }
+    double max_latency_ms() const { return m_latency_max_us / 1000.; }
+
+    // the same, stage by stage; the sink stands in for the screen
+    const FrameLatency& latency() const { return m_latency; }
+
+private:
+    struct Slot
+    {
+        Frame   frame;
+        cv::Mat rgba;
+        cv::Mat inferred;
+        cv::Mat output;   // rgba or inferred
+        size_t  index;    // decode order within run(), for the sequencer
+    };
+
+    bool decode(Slot*& slot);
+    void present(Slot* slot);
+
+    Config                         m_config;
+    cv::Ptr<FrameSource>           m_source;
+    cv::Ptr<FrameSink>             m_sink;
+    InferFn                        m_infer;
+    TextOverlay                    m_overlay;
+
+    std::vector<std::unique_ptr<Slot> > m_slots;
+    tbb::concurrent_queue<Slot*>   m_free;
+
+    size_t                         m_limit;    // frames to decode in the current run()
+    size_t                         m_decoded;  // in the current run()
+    bool                           m_eos;
+
+    size_t                         m_frames;
+    size_t                         m_out_of_order;
+    uint64                         m_last_seq;
+    int64                          m_latency_sum_us;
+    int64                          m_latency_max_us;
+    FrameLatency                   m_latency;
+};
@@ -0,0 +1,158 @@
+/*
+// End-to-end frame latency: capture to sink and to screen, stage by stage
+*/
+#include "frame_latency.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "opencv2/imgproc.hpp"
+
+namespace
+{
+
+// narrower frames can't hold the blocks at a readable size
+const int WATERMARK_MIN_WIDTH = 256;
+
+// white, black, 64 data bits (seq then capture ms, most significant first), black, white
+const int WATERMARK_BITS   = 64;
+const int WATERMARK_BLOCKS = WATERMARK_BITS + 4;
+
+int block_size(int cols)
+{
+    return std::max(cols / (WATERMARK_BLOCKS + 12), 3);
+}
+
+} // namespace
+
+
+const char* FrameLatency::name(Interval interval)
+{
+    switch (interval)
+    {
+    case QUEUE:              return "queue";
+    case HANDOFF:            return "handoff";
+    case CONVERT:            return "convert";
+    case PROCESS:            return "process";
+    case DELIVER:            return "deliver";
+    case PRESENT:            return "present";
+    case CAPTURE_TO_SINK:    return "capture_to_sink";
+    case CAPTURE_TO_PRESENT: return "capture_to_present";
+    default:                 return "?";
+    }
+}
+
+
+void FrameLatency::add(const Frame& frame)
+{
+    // skipped stages are reached with the one before
+    int64 t[Frame::STAGE_COUNT];
+    int64 last = frame.timestamp_us;
+    for (int i = 0; i < Frame::STAGE_COUNT; i++)
+        t[i] = last = frame.stage_us[i] ? frame.stage_us[i] : last;
+
+    const double ms = 1e-3;
+    m_histograms[QUEUE].add((t[Frame::STAGE_READ] - frame.timestamp_us) * ms);
+    m_histograms[HANDOFF].add((t[Frame::STAGE_CONVERTING] - t[Frame::STAGE_READ]) * ms);
+    m_histograms[CONVERT].add((t[Frame::STAGE_CONVERTED] - t[Frame::STAGE_CONVERTING]) * ms);
+    m_histograms[PROCESS].add((t[Frame::STAGE_INFERRED] - t[Frame::STAGE_CONVERTED]) * ms);
+    m_histograms[DELIVER].add((t[Frame::STAGE_SINK] - t[Frame::STAGE_INFERRED]) * ms);
+    m_histograms[PRESENT].add((t[Frame::STAGE_PRESENTED] - t[Frame::STAGE_SINK]) * ms);
+    m_histograms[CAPTURE_TO_SINK].add((t[Frame::STAGE_SINK] - frame.timestamp_us) * ms);
+    m_histograms[CAPTURE_TO_PRESENT].add((t[Frame::STAGE_PRESENTED] - frame.timestamp_us) * ms);
+}
+
+
+void FrameLatency::reset()
+{
+    for (int i = 0; i < INTERVAL_COUNT; i++)
+        m_histograms[i].reset();
+}
+
+
+void FrameLatency::print(std::ostream& out) const
+{
+    for (int i = 0; i < INTERVAL_COUNT; i++)
+        m_histograms[i].print(out, std::string("[latency] ") + name((Interval)i));
+}
+
+
+int64 wall_clock_ms(int64 steady_us)
+{
+    using namespace std::chrono;
+    const int64 now_ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+    return now_ms - (now_us() - steady_us) / 1000;
+}
+
+
+void draw_watermark(cv::InputOutputArray rgba, const Frame& frame)
+{
+    const cv::Size size = rgba.size();
+    CV_Assert(rgba.type() == CV_8UC4);
+    if (size.width < WATERMARK_MIN_WIDTH)
+        return;
+
+    const int b = block_size(size.width);
+    const uint32_t seq = (uint32_t)frame.seq;
+    const uint32_t capture_ms = (uint32_t)wall_clock_ms(frame.timestamp_us);
+
+    cv::Mat strip(b, WATERMARK_BLOCKS * b, CV_8UC4);
+    for (int i = 0; i < WATERMARK_BLOCKS; i++)
+    {
+        bool white;
+        if (i == 0 || i == WATERMARK_BLOCKS - 1)
+            white = true;
+        else if (i == 1 || i == WATERMARK_BLOCKS - 2)
+            white = false;
+        else
+        {
+            const int bit = i - 2;
+            const uint32_t word = bit < 32 ? seq : capture_ms;
+            white = ((word >> (31 - bit % 32)) & 1) != 0;
+        }
+        strip(cv::Rect(i * b, 0, b, b)).setTo(white ? cv::Scalar::all(255) : cv::Scalar(0, 0, 0, 255));
+    }
+
+    const cv::Rect roi(b, size.height - 2 * b, strip.cols, b);
+    if (rgba.isUMat())
+    {
+        cv::UMat u = rgba.getUMat();
+        strip.copyTo(u(roi));
+    }
+    else
+    {
+        cv::Mat m = rgba.getMat();
+        strip.copyTo(m(roi));
+    }
+
+    cv::putText(rgba, cv::format("#%u  capture %u ms", seq, capture_ms), cv::Point(b, size.height - 3 * b),
+                cv::FONT_HERSHEY_SIMPLEX, b / 24., cv::Scalar(255, 255, 0, 255), std::max(b / 8, 1));
+}
+
+
+bool read_watermark(const cv::Mat& rgba, uint32_t& seq, uint32_t& capture_ms)
+{
+    CV_Assert(rgba.type() == CV_8UC4);
+    if (rgba.cols < WATERMARK_MIN_WIDTH)
+        return false;
+
+    const int b = block_size(rgba.cols);
+    const int y = rgba.rows - 2 * b + b / 2;
+
+    bool bits[WATERMARK_BLOCKS];
+    for (int i = 0; i < WATERMARK_BLOCKS; i++)
+    {
+        const cv::Vec4b& p = rgba.at<cv::Vec4b>(y, b + i * b + b / 2);
+        bits[i] = p[0] + p[1] + p[2] > 3 * 128;
+    }
+    if (!bits[0] || bits[1] || bits[WATERMARK_BLOCKS - 2] || !bits[WATERMARK_BLOCKS - 1])
+        return false;
+
+    seq = capture_ms = 0;
+    for (int bit = 0; bit < WATERMARK_BITS; bit++)
+    {
+        uint32_t& word = bit < 32 ? seq : capture_ms;
+        word = (word << 1) | (bits[bit + 2] ? 1 : 0);
+    }
+    return true;
+}
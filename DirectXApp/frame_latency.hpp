@@ -0,0 +1,62 @@
+/*
+// End-to-end frame latency: capture to sink and to screen, stage by stage
+*/
+#pragma once
+
+#include <ostream>
+
+#include "opencv2/core.hpp"
+
+#include "frame_source.hpp"
+#include "latency_histogram.hpp"
+
+// Distributions of where frames spent their time, from the stage stamps they carry. A
+// stage a frame skipped (no network) counts as reached together with the one before it,
+// so the intervals of a frame always add up to its capture-to-present latency. Not
+// thread safe: add() from the stage that presents frames.
+class FrameLatency
+{
+public:
+    enum Interval
+    {
+        QUEUE,                // capture - read: decoding and waiting in the source
+        HANDOFF,              // read - conversion started: queued between pipeline stages
+        CONVERT,              // conversion started - converted
+        PROCESS,              // converted - inferred: filtering and the network
+        DELIVER,              // inferred - sink: overlay, ordering
+        PRESENT,              // sink - presented
+        CAPTURE_TO_SINK,
+        CAPTURE_TO_PRESENT,
+        INTERVAL_COUNT
+    };
+
+    static const char* name(Interval interval);
+
+    // a frame stamped up to Frame::STAGE_PRESENTED
+    void add(const Frame& frame);
+
+    void reset();
+
+    const LatencyHistogram& histogram(Interval interval) const { return m_histograms[interval]; }
+    size_t frames() const { return m_histograms[CAPTURE_TO_PRESENT].count(); }
+
+    // one LatencyHistogram line per interval
+    void print(std::ostream& out) const;
+
+private:
+    LatencyHistogram m_histograms[INTERVAL_COUNT];
+};
+
+// wall-clock time (ms since the Unix epoch) of a now_us() time point
+int64 wall_clock_ms(int64 steady_us);
+
+// Visible stamp for checking latency from outside, e.g. a camera filming the screen next
+// to a reference clock: the sequence number and wall-clock capture time as text, and as
+// a strip of 64 black and white blocks along the bottom edge that survive video
+// compression and can be read back by read_watermark(). RGBA Mat or UMat; frames
+// narrower than 256 pixels are left unmarked.
+void draw_watermark(cv::InputOutputArray rgba, const Frame& frame);
+
+// decode the block strip; false if there is none. capture_ms is the low 32 bits of
+// wall_clock_ms() of the capture time.
+bool read_watermark(const cv::Mat& rgba, uint32_t& seq, uint32_t& capture_ms);
@@ -0,0 +1,212 @@
+/*
+// Record/replay of raw decoded frames for repeatable benchmarking
+*/
+#include "frame_record.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "opencv2/imgproc.hpp"
+
+#include "color_convert.hpp"
+
+namespace
+{
+
+const char     FRAME_FILE_MAGIC[8] = { 'D', 'X', 'F', 'R', 'A', 'M', 'E', '1' };
+const uint32_t FRAME_FILE_VERSION  = 1;
+const uint64_t FRAME_DATA_OFFSET   = 4096;
+const uint64_t FRAME_ALIGN         = 64;
+const uint32_t MAX_FRAME_SIDE      = 1 << 15;   // keeps sizes and frame_bytes in range
+
+uint64 frame_bytes(FrameFormat format, cv::Size size)
+{
+    return format == FRAME_NV12 ? (uint64)size.width * size.height * 3 / 2 : (uint64)size.width * size.height * 3;
+}
+
+} // namespace
+
+
+FrameRecorder::FrameRecorder(const std::string& path, FrameFormat format, cv::Size size)
+{
+    CV_Assert(format == FRAME_BGR || (size.width % 2 == 0 && size.height % 2 == 0));
+
+    m_file = fopen(path.c_str(), "wb");
+    if (!m_file)
+        throw std::runtime_error("can't create " + path);
+
+    memset(&m_header, 0, sizeof(m_header));
+    memcpy(m_header.magic, FRAME_FILE_MAGIC, sizeof(m_header.magic));
+    m_header.version       = FRAME_FILE_VERSION;
+    m_header.format        = format;
+    m_header.width         = size.width;
+    m_header.height        = size.height;
+    m_header.frame_bytes   = frame_bytes(format, size);
+    m_header.record_stride = (sizeof(FrameRecordHeader) + m_header.frame_bytes + FRAME_ALIGN - 1) / FRAME_ALIGN * FRAME_ALIGN;
+    m_header.frame_count   = 0;
+    m_header.data_offset   = FRAME_DATA_OFFSET;
+
+    // header page, rewritten with the final frame count on close()
+    std::vector<uchar> page(FRAME_DATA_OFFSET, 0);
+    memcpy(&page[0], &m_header, sizeof(m_header));
+    if (fwrite(&page[0], 1, page.size(), m_file) != page.size())
+    {
+        fclose(m_file);
+        throw std::runtime_error("can't write " + path);
+    }
+
+    m_padding = cv::Mat::zeros(1, (int)FRAME_ALIGN, CV_8UC1);
+}
+
+
+FrameRecorder::~FrameRecorder()
+{
+    try
+    {
+        close();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+
+void FrameRecorder::write(const Frame& frame)
+{
+    CV_Assert(m_file);
+
+    const FrameFormat format = (FrameFormat)m_header.format;
+    const cv::Size size((int)m_header.width, (int)m_header.height);
+    CV_Assert(frame.size() == size);
+
+    cv::Mat data = frame.data;
+    if (format == FRAME_NV12 && frame.format == FRAME_BGR)
+    {
+        cv::cvtColor(frame.data, m_i420, cv::COLOR_BGR2YUV_I420);
+        convert_I420_to_NV12(m_i420, m_nv12, size.width, size.height);
+        data = m_nv12;
+    }
+    CV_Assert(data.type() == (format == FRAME_NV12 ? CV_8UC1 : CV_8UC3));
+
+    FrameRecordHeader record;
+    memset(&record, 0, sizeof(record));
+    record.timestamp_us = frame.timestamp_us;
+    record.seq          = frame.seq;
+    bool ok = fwrite(&record, 1, sizeof(record), m_file) == sizeof(record);
+
+    const size_t row_bytes = (size_t)data.cols * data.elemSize();
+    for (int y = 0; y < data.rows && ok; y++)
+        ok = fwrite(data.ptr(y), 1, row_bytes, m_file) == row_bytes;
+
+    const size_t padding = (size_t)(m_header.record_stride - sizeof(record) - m_header.frame_bytes);
+    if (padding && ok)
+        ok = fwrite(m_padding.data, 1, padding, m_file) == padding;
+
+    // a partial record is past the frame count, and dropped on replay
+    if (!ok)
+        throw std::runtime_error("frame recording: write failed");
+
+    m_header.frame_count++;
+}
+
+
+void FrameRecorder::close()
+{
+    if (!m_file)
+        return;
+
+    bool ok = fseek(m_file, 0, SEEK_SET) == 0 &&
+              fwrite(&m_header, 1, sizeof(m_header), m_file) == sizeof(m_header);
+    ok = fclose(m_file) == 0 && ok;
+    m_file = 0;
+
+    if (!ok)
+        throw std::runtime_error("frame recording: can't finalize the header");
+}
+
+
+ReplaySource::ReplaySource(const std::string& path, bool throttle, bool loop) :
+    m_throttle(throttle),
+    m_loop(loop),
+    m_index(0),
+    m_seq(0),
+    m_first_ts(0),
+    m_start_us(-1)
+{
+    m_file.open(path);
+
+    if (m_file.size() < sizeof(m_header))
+        throw std::runtime_error(path + " is not a frame recording");
+    memcpy(&m_header, m_file.data(), sizeof(m_header));
+
+    if (memcmp(m_header.magic, FRAME_FILE_MAGIC, sizeof(m_header.magic)) != 0 || m_header.version != FRAME_FILE_VERSION)
+        throw std::runtime_error(path + " is not a frame recording");
+
+    const cv::Size sz = size();
+    if ((m_header.format != FRAME_BGR && m_header.format != FRAME_NV12) ||
+        m_header.width == 0 || m_header.height == 0 || m_header.width > MAX_FRAME_SIDE || m_header.height > MAX_FRAME_SIDE ||
+        m_header.frame_bytes != frame_bytes(format(), sz) ||
+        m_header.record_stride < sizeof(FrameRecordHeader) + m_header.frame_bytes ||
+        m_header.data_offset > m_file.size())
+        throw std::runtime_error(path + ": corrupted frame recording header");
+
+    // an unfinished recording has no frame count; take every complete record. Counting
+    // in records rather than multiplying the header's count by the stride can't overflow,
+    // and every record read() addresses then lies within the file.
+    const uint64 available = (m_file.size() - m_header.data_offset) / m_header.record_stride;
+    if (m_header.frame_count == 0 || m_header.frame_count > available)
+        m_header.frame_count = available;
+}
+
+
+bool ReplaySource::read(Frame& frame)
+{
+    if (m_index >= m_header.frame_count)
+    {
+        if (!m_loop || m_header.frame_count == 0)
+            return false;
+        m_index = 0;
+        m_start_us = -1;
+    }
+
+    const uchar* record = m_file.data() + m_header.data_offset + m_index * m_header.record_stride;
+    FrameRecordHeader rh;
+    memcpy(&rh, record, sizeof(rh));
+
+    // a throttled replay captures the frame at its due time, so falling behind shows up
+    // as queueing in the source
+    int64 captured = now_us();
+    if (m_throttle)
+    {
+        if (m_start_us < 0)
+        {
+            m_start_us = captured;
+            m_first_ts = rh.timestamp_us;
+        }
+
+        captured = m_start_us + (rh.timestamp_us - m_first_ts);
+        const int64 wait = captured - now_us();
+        if (wait > 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(wait));
+    }
+
+    // the mapping is read-only: the Mat header must not be written through
+    uchar* data = const_cast<uchar*>(record + sizeof(FrameRecordHeader));
+    const cv::Size sz = size();
+    if (format() == FRAME_NV12)
+        frame.data = cv::Mat(sz.height * 3 / 2, sz.width, CV_8UC1, data);
+    else
+        frame.data = cv::Mat(sz.height, sz.width, CV_8UC3, data);
+
+    frame.format       = format();
+    frame.timestamp_us = captured;
+    frame.seq          = m_seq++;
+
+    m_index++;
+    return true;
+}
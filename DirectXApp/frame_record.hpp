@@ -0,0 +1,98 @@
+/*
+// Record/replay of raw decoded frames for repeatable benchmarking
+//
+// Container layout (little endian):
+//   [0, 4096)        FrameFileHeader
+//   data_offset + i * record_stride:
+//                    FrameRecordHeader (64 bytes), then frame_bytes of pixel data
+// Records are 64-byte aligned, so replayed frames can be used in place from the mapping.
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "opencv2/core.hpp"
+
+#include "frame_source.hpp"
+#include "mapped_file.hpp"
+
+struct FrameFileHeader
+{
+    char     magic[8];       // "DXFRAME1"
+    uint32_t version;
+    uint32_t format;         // FrameFormat
+    uint32_t width;
+    uint32_t height;
+    uint64_t frame_bytes;
+    uint64_t record_stride;
+    uint64_t frame_count;    // 0 if the recording was not closed cleanly
+    uint64_t data_offset;
+};
+
+struct FrameRecordHeader
+{
+    int64_t  timestamp_us;
+    uint64_t seq;
+    uint64_t reserved[6];
+};
+
+// Appends frames to a container file. Frames must be in the recorder's format; a
+// recorder created for FRAME_NV12 also accepts BGR frames and converts them.
+class FrameRecorder
+{
+public:
+    // throws std::runtime_error if the file can't be created
+    FrameRecorder(const std::string& path, FrameFormat format, cv::Size size);
+    ~FrameRecorder();
+
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    // throws std::runtime_error if the frame can't be written
+    void write(const Frame& frame);
+
+    // finalize the header; called by the destructor, which only reports a failure.
+    // Throws std::runtime_error if the header can't be written; the file is closed
+    // either way, and replays as an unfinished recording.
+    void close();
+
+    size_t frames() const { return (size_t)m_header.frame_count; }
+
+private:
+    FILE*           m_file;
+    FrameFileHeader m_header;
+    cv::Mat         m_i420;
+    cv::Mat         m_nv12;
+    cv::Mat         m_padding;
+};
+
+// Serves frames of a container file straight from its memory mapping.
+//
+// Frames returned by read() are read-only views into the mapping, valid as long as the
+// source exists. They are never copied, so an allocator set on frame.data is dropped.
+// With `throttle` frames are released at the recorded pace and stamped with the time
+// they were due, otherwise as fast as they are requested; with `loop` the recording
+// restarts at its end.
+class ReplaySource : public FrameSource
+{
+public:
+    ReplaySource(const std::string& path, bool throttle, bool loop = false);
+
+    bool read(Frame& frame);
+    cv::Size size() const { return cv::Size((int)m_header.width, (int)m_header.height); }
+    FrameFormat format() const { return (FrameFormat)m_header.format; }
+
+    size_t frame_count() const { return (size_t)m_header.frame_count; }
+
+private:
+    MappedFile      m_file;
+    FrameFileHeader m_header;
+    bool            m_throttle;
+    bool            m_loop;
+    size_t          m_index;
+    uint64          m_seq;
+    int64           m_first_ts;
+    int64           m_start_us;
+};
@@ -0,0 +1,308 @@
+/*
+// Shared-memory ring of processed frames for consumer processes on the same machine
+*/
+#include "frame_ring.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include "frame_source.hpp"
+
+namespace
+{
+
+const char     FRAME_RING_MAGIC[8]  = { 'D', 'X', 'R', 'I', 'N', 'G', '0', '1' };
+const uint32_t FRAME_RING_VERSION   = 1;
+
+// a reader silent this long while frames are published has died without detaching
+const int64    STALE_READER_US      = 10 * 1000 * 1000;
+
+size_t align_up(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+FrameSlotHeader* slot_at(FrameRingHeader* header, uint64 frame)
+{
+    uchar* base = (uchar*)header + header->data_offset;
+    return (FrameSlotHeader*)(base + (frame % header->slot_count) * header->slot_stride);
+}
+
+cv::Mat slot_pixels(FrameRingHeader* header, FrameSlotHeader* slot)
+{
+    return cv::Mat((int)header->height, (int)header->width, header->type, (uchar*)slot + sizeof(FrameSlotHeader));
+}
+
+} // namespace
+
+
+FrameRingWriter::FrameRingWriter(const std::string& name, cv::Size size, int type, int slots) :
+    m_header(0),
+    m_next(0),
+    m_writing(false),
+    m_readers(0),
+    m_lagging(0),
+    m_reclaimed(0)
+{
+    CV_Assert(slots >= 2 && size.area() > 0);
+
+    const size_t frame_bytes = (size_t)size.area() * CV_ELEM_SIZE(type);
+    const size_t stride      = align_up(sizeof(FrameSlotHeader) + frame_bytes, 64);
+    const size_t offset      = align_up(sizeof(FrameRingHeader), 4096);
+
+    m_shm.create(name, offset + stride * slots);
+
+    m_header = new (m_shm.data()) FrameRingHeader;
+    m_header->version     = FRAME_RING_VERSION;
+    m_header->slot_count  = (uint32_t)slots;
+    m_header->width       = (uint32_t)size.width;
+    m_header->height      = (uint32_t)size.height;
+    m_header->type        = type;
+    m_header->reserved    = 0;
+    m_header->frame_bytes = frame_bytes;
+    m_header->slot_stride = stride;
+    m_header->data_offset = offset;
+    m_header->published.store(0);
+    m_header->closed.store(0);
+
+    for (int i = 0; i < FRAME_RING_MAX_READERS; i++)
+    {
+        FrameRingReaderEntry& e = m_header->readers[i];
+        e.owner.store(0);
+        e.position.store(0);
+        e.skipped.store(0);
+        e.seen_us.store(0);
+    }
+
+    for (int i = 0; i < slots; i++)
+    {
+        FrameSlotHeader* slot = new (slot_at(m_header, (uint64)i)) FrameSlotHeader;
+        slot->seq.store(0);
+        slot->timestamp_us = 0;
+    }
+
+    // readers check the magic first
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(m_header->magic, FRAME_RING_MAGIC, sizeof(m_header->magic));
+}
+
+
+FrameRingWriter::~FrameRingWriter()
+{
+    m_header->closed.store(1, std::memory_order_release);
+}
+
+
+cv::Mat FrameRingWriter::begin()
+{
+    CV_Assert(!m_writing);
+
+    FrameSlotHeader* slot = slot_at(m_header, m_next);
+    slot->seq.store(2 * m_next + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    m_writing = true;
+    return slot_pixels(m_header, slot);
+}
+
+
+void FrameRingWriter::commit(int64 timestamp_us)
+{
+    CV_Assert(m_writing);
+
+    FrameSlotHeader* slot = slot_at(m_header, m_next);
+    slot->timestamp_us = timestamp_us;
+    slot->seq.store(2 * m_next + 2, std::memory_order_release);
+
+    m_next++;
+    m_writing = false;
+    m_header->published.store(m_next, std::memory_order_release);
+
+    if (m_next % m_header->slot_count == 0)
+        scan_readers();
+}
+
+
+void FrameRingWriter::write(cv::InputArray frame, int64 timestamp_us)
+{
+    cv::Mat slot = begin();
+    CV_Assert(frame.size() == slot.size() && frame.type() == slot.type());
+
+    // the slot header keeps size and type, so the copy lands in the ring
+    frame.copyTo(slot);
+    commit(timestamp_us);
+}
+
+
+void FrameRingWriter::scan_readers()
+{
+    const int64 now = now_us();
+
+    m_readers = 0;
+    m_lagging = 0;
+    for (int i = 0; i < FRAME_RING_MAX_READERS; i++)
+    {
+        FrameRingReaderEntry& e = m_header->readers[i];
+        uint64 owner = e.owner.load(std::memory_order_acquire);
+        if (!owner)
+            continue;
+
+        if (now - e.seen_us.load(std::memory_order_relaxed) > STALE_READER_US)
+        {
+            if (e.owner.compare_exchange_strong(owner, 0))
+                m_reclaimed++;
+            continue;
+        }
+
+        m_readers++;
+        if (e.position.load(std::memory_order_relaxed) + m_header->slot_count <= m_next)
+            m_lagging++;
+    }
+}
+
+
+FrameRingReader::FrameRingReader(const std::string& name) :
+    m_header(0),
+    m_entry(0),
+    m_owner(0),
+    m_next(0),
+    m_slot(0),
+    m_slot_seq(0),
+    m_received(0),
+    m_torn(0)
+{
+    m_shm.open(name);
+
+    m_header = (FrameRingHeader*)m_shm.data();
+    if (m_shm.size() < sizeof(FrameRingHeader) ||
+        memcmp(m_header->magic, FRAME_RING_MAGIC, sizeof(m_header->magic)) != 0 ||
+        m_header->version != FRAME_RING_VERSION)
+        throw std::runtime_error(name + " is not a frame ring");
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (m_header->data_offset + m_header->slot_stride * m_header->slot_count > m_shm.size())
+        throw std::runtime_error(name + ": corrupted frame ring header");
+
+    m_local.owner.store(0);
+    m_local.position.store(0);
+    m_local.skipped.store(0);
+    m_local.seen_us.store(0);
+
+    // any nonzero value unlikely to be used by another reader at the same time
+    m_owner = (((uint64)now_us() << 16) ^ (uint64)(uintptr_t)this) | 1;
+
+    const uint64 published = m_header->published.load(std::memory_order_acquire);
+    m_next = published ? published - 1 : 0;
+
+    for (int i = 0; i < FRAME_RING_MAX_READERS && !m_entry; i++)
+    {
+        FrameRingReaderEntry& e = m_header->readers[i];
+        if (e.owner.load(std::memory_order_relaxed) != 0)
+            continue;
+
+        // fresh before the entry shows up as taken, or the producer would reclaim it
+        e.seen_us.store(now_us(), std::memory_order_relaxed);
+        e.position.store(m_next, std::memory_order_relaxed);
+
+        uint64 expected = 0;
+        if (e.owner.compare_exchange_strong(expected, m_owner))
+        {
+            e.skipped.store(0, std::memory_order_relaxed);
+            m_entry = &e;
+        }
+    }
+
+    if (!m_entry)
+        throw std::runtime_error(cv::format("%s: all %d reader entries are taken", name.c_str(), (int)FRAME_RING_MAX_READERS));
+}
+
+
+FrameRingReader::~FrameRingReader()
+{
+    uint64 owner = m_owner;
+    if (m_entry != &m_local)
+        m_entry->owner.compare_exchange_strong(owner, 0);
+}
+
+
+bool FrameRingReader::acquire(RingFrame& frame, int timeout_ms)
+{
+    if (m_slot)
+        release();
+
+    // the producer took the entry back after a long silence: keep counting locally
+    if (m_entry != &m_local && m_entry->owner.load(std::memory_order_relaxed) != m_owner)
+    {
+        m_local.skipped.store(m_entry->skipped.load(std::memory_order_relaxed));
+        m_entry = &m_local;
+    }
+
+    const uint64 slots = m_header->slot_count;
+    const int64 deadline = now_us() + (int64)timeout_ms * 1000;
+
+    for (int spins = 0;; spins++)
+    {
+        const uint64 published = m_header->published.load(std::memory_order_acquire);
+        if (published > m_next)
+        {
+            // the wanted frame's slot is taken by a newer one: skip to the newest
+            if (published - m_next >= slots)
+            {
+                m_entry->skipped.fetch_add(published - 1 - m_next, std::memory_order_relaxed);
+                m_next = published - 1;
+            }
+
+            FrameSlotHeader* slot = slot_at(m_header, m_next);
+            const uint64 seq = slot->seq.load(std::memory_order_acquire);
+            if (seq == 2 * m_next + 2)
+            {
+                frame.data         = slot_pixels(m_header, slot);
+                frame.timestamp_us = slot->timestamp_us;
+                frame.seq          = m_next;
+
+                m_slot     = slot;
+                m_slot_seq = seq;
+                m_next++;
+                m_received++;
+
+                m_entry->position.store(m_next, std::memory_order_relaxed);
+                m_entry->seen_us.store(now_us(), std::memory_order_relaxed);
+                return true;
+            }
+
+            // overtaken between the two loads
+            continue;
+        }
+
+        if (m_header->closed.load(std::memory_order_acquire))
+            return false;
+
+        const int64 now = now_us();
+        if (now >= deadline)
+            return false;
+        m_entry->seen_us.store(now, std::memory_order_relaxed);
+
+        if (spins < 64)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+
+bool FrameRingReader::release()
+{
+    if (!m_slot)
+        return false;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const bool intact = m_slot->seq.load(std::memory_order_relaxed) == m_slot_seq;
+    m_slot = 0;
+
+    if (!intact)
+        m_torn++;
+    return intact;
+}
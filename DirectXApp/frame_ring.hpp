@@ -0,0 +1,143 @@
+/*
+// Shared-memory ring of processed frames for consumer processes on the same machine
+//
+// Segment layout:
+//   [0, data_offset)                FrameRingHeader, reader table included
+//   data_offset + i * slot_stride:  FrameSlotHeader (64 bytes), then frame_bytes of pixels
+//
+// One producer, lock free. Frame n goes to slot n % slot_count under a sequence lock:
+// the slot's seq is 2n+1 while the producer writes it and 2n+2 once it is complete.
+// Readers use the pixels in place and check seq again when done with them, so a frame
+// the producer overwrote meanwhile is detected instead of being used torn. The producer
+// never waits for readers: one that falls a whole ring behind skips to the newest frame.
+*/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "opencv2/core.hpp"
+
+#include "shared_memory.hpp"
+
+// the atomics below are shared between processes, which needs them address free
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "64-bit atomics must be lock free");
+
+enum { FRAME_RING_MAX_READERS = 16 };
+
+struct alignas(64) FrameRingReaderEntry
+{
+    std::atomic<uint64_t> owner;      // 0 - free
+    std::atomic<uint64_t> position;   // next frame the reader wants
+    std::atomic<uint64_t> skipped;    // frames it lost to the producer overtaking it
+    std::atomic<int64_t>  seen_us;    // last acquire, now_us() clock
+};
+
+struct FrameRingHeader
+{
+    char     magic[8];                // "DXRING01"
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t width;
+    uint32_t height;
+    int32_t  type;                    // cv::Mat type
+    uint32_t reserved;
+    uint64_t frame_bytes;             // continuous rows
+    uint64_t slot_stride;
+    uint64_t data_offset;
+
+    alignas(64) std::atomic<uint64_t> published;   // frames completed
+    std::atomic<uint32_t>             closed;      // the producer is gone
+
+    FrameRingReaderEntry readers[FRAME_RING_MAX_READERS];
+};
+
+struct alignas(64) FrameSlotHeader
+{
+    std::atomic<uint64_t> seq;
+    int64_t               timestamp_us;
+};
+
+struct RingFrame
+{
+    cv::Mat data;           // read-only view into the ring
+    int64   timestamp_us;   // as given to the producer
+    uint64  seq;            // frame number, from 0
+
+    RingFrame() : timestamp_us(0), seq(0) {}
+};
+
+class FrameRingWriter
+{
+public:
+    // throws std::runtime_error if the segment can't be created
+    FrameRingWriter(const std::string& name, cv::Size size, int type, int slots);
+
+    // marks the ring closed for its readers
+    ~FrameRingWriter();
+
+    // Slot for the next frame, to fill in place and publish with commit(). Readers of
+    // the frame it replaces find out when they release it.
+    cv::Mat begin();
+    void commit(int64 timestamp_us);
+
+    // begin(), copy (downloads a UMat straight into the slot), commit()
+    void write(cv::InputArray frame, int64 timestamp_us);
+
+    const std::string& name() const { return m_shm.name(); }
+    uint64 published() const { return m_header->published.load(std::memory_order_relaxed); }
+
+    // as of the last scan of the reader table, once per ring of frames
+    int readers() const { return m_readers; }
+    int lagging() const { return m_lagging; }      // a whole ring behind, about to skip
+    uint64 reclaimed() const { return m_reclaimed; }
+
+private:
+    void scan_readers();
+
+    SharedMemory     m_shm;
+    FrameRingHeader* m_header;
+    uint64           m_next;
+    bool             m_writing;
+    int              m_readers;
+    int              m_lagging;
+    uint64           m_reclaimed;
+};
+
+class FrameRingReader
+{
+public:
+    // attach to the ring of a running producer; throws std::runtime_error if there is
+    // none or all reader entries are taken
+    explicit FrameRingReader(const std::string& name);
+    ~FrameRingReader();
+
+    // Wait up to `timeout_ms` for a frame newer than the last one acquired; false on
+    // timeout or once the producer closed the ring. Releases the previous frame.
+    // frame.data becomes a view of the slot, whatever allocator it had.
+    bool acquire(RingFrame& frame, int timeout_ms);
+
+    // Done with the acquired frame: false if the producer overwrote it while in use, in
+    // which case whatever was computed from it should be dropped.
+    bool release();
+
+    cv::Size size() const { return cv::Size((int)m_header->width, (int)m_header->height); }
+    int type() const { return m_header->type; }
+
+    uint64 received() const { return m_received; }
+    uint64 skipped() const { return m_entry->skipped.load(std::memory_order_relaxed); }
+    uint64 torn() const { return m_torn; }
+
+private:
+    SharedMemory          m_shm;
+    FrameRingHeader*      m_header;
+    FrameRingReaderEntry* m_entry;      // in the ring, or m_local once the producer reclaimed it
+    FrameRingReaderEntry  m_local;
+    uint64                m_owner;
+    uint64                m_next;
+    FrameSlotHeader*      m_slot;       // acquired, or 0
+    uint64                m_slot_seq;
+    uint64                m_received;
+    uint64                m_torn;
+};
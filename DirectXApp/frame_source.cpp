@@ -0,0 +1,33 @@
+/*
+// Frame sources feeding the processing pipeline
+*/
+#include "frame_source.hpp"
+
+int64 now_us()
+{
+    static const double ticks_per_us = cv::getTickFrequency() / 1e6;
+    return (int64)(cv::getTickCount() / ticks_per_us);
+}
+
+
+CaptureSource::CaptureSource(const cv::VideoCapture& cap) :
+    m_cap(cap),
+    m_seq(0)
+{
+    m_size = cv::Size((int)m_cap.get(cv::CAP_PROP_FRAME_WIDTH), (int)m_cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+}
+
+
+bool CaptureSource::read(Frame& frame)
+{
+    // stamped between grab and decode
+    if (!m_cap.grab())
+        return false;
+    frame.timestamp_us = now_us();
+    if (!m_cap.retrieve(frame.data))
+        return false;
+
+    frame.format       = FRAME_BGR;
+    frame.seq          = m_seq++;
+    return true;
+}
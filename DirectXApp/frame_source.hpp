@@ -0,0 +1,90 @@
+/*
+// Frame sources feeding the processing pipeline
+*/
+#pragma once
+
+#include "opencv2/core.hpp"
+#include "opencv2/videoio.hpp"
+
+enum FrameFormat
+{
+    FRAME_BGR,    // CV_8UC3, height x width
+    FRAME_NV12    // CV_8UC1, (height * 3 / 2) x width: Y plane followed by interleaved UV
+};
+
+// microseconds on a monotonic clock
+int64 now_us();
+
+struct Frame
+{
+    // points a frame passes between capture (timestamp_us) and the screen, for FrameLatency
+    enum Stage
+    {
+        STAGE_READ,        // out of the source, after any queueing in it
+        STAGE_CONVERTING,  // conversion started; unstamped where it directly follows STAGE_READ
+        STAGE_CONVERTED,   // RGBA, ready for processing
+        STAGE_INFERRED,    // network output in place; unstamped when the network was skipped
+        STAGE_SINK,        // handed to the sinks: ring, video writer, headless consumer
+        STAGE_PRESENTED,   // on screen; right after STAGE_SINK where there is no screen
+        STAGE_COUNT
+    };
+
+    cv::Mat     data;
+    FrameFormat format;
+    int64       timestamp_us;            // capture time: when the source grabbed the frame, before decoding
+    uint64      seq;                     // position in the source, from 0
+    int64       stage_us[STAGE_COUNT];   // now_us() at each stage, 0 if not reached
+
+    Frame() : format(FRAME_BGR), timestamp_us(0), seq(0)
+    {
+        clear_stages();
+    }
+
+    // picture size, independent of the memory layout of the format
+    cv::Size size() const
+    {
+        return format == FRAME_NV12 ? cv::Size(data.cols, data.rows * 2 / 3) : data.size();
+    }
+
+    void stamp(Stage stage) { stage_us[stage] = now_us(); }
+
+    // before stamping a frame read into a reused Frame
+    void clear_stages()
+    {
+        for (int i = 0; i < STAGE_COUNT; i++)
+            stage_us[i] = 0;
+    }
+};
+
+class FrameSource
+{
+public:
+    virtual ~FrameSource() {}
+
+    // Next frame; false at the end of the stream. Frames read earlier must stay intact:
+    // sources write into frame.data or hand out memory they never modify, so callers
+    // can keep several frames in flight by reading into distinct Frame objects. Only
+    // sources writing into frame.data keep its allocator (e.g. an arena's); the others
+    // replace frame.data with a view of their own memory. frame.timestamp_us is taken
+    // when the frame is grabbed, so decoding counts as time spent in the source.
+    virtual bool read(Frame& frame) = 0;
+
+    virtual cv::Size size() const = 0;
+    virtual FrameFormat format() const = 0;
+};
+
+// live camera or video file decoded by cv::VideoCapture
+class CaptureSource : public FrameSource
+{
+public:
+    explicit CaptureSource(const cv::VideoCapture& cap);
+
+    bool read(Frame& frame);
+    cv::Size size() const { return m_size; }
+    FrameFormat format() const { return FRAME_BGR; }
+
+private:
+    cv::VideoCapture m_cap;
+    cv::Size         m_size;
+    uint64           m_seq;
+};
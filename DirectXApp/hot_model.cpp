@@ -0,0 +1,212 @@
+/*
+// Style network that can be replaced between frames without stalling them
+*/
+#include "hot_model.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sys/stat.h>
+
+#include "opencv2/imgproc.hpp"
+
+
+namespace
+{
+
+std::time_t modification_time(const std::string& path)
+{
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? st.st_mtime : 0;
+}
+
+} // namespace
+
+
+HostNetwork::HostNetwork(ov::CompiledModel compiled, cv::Size input_size, const std::string& path,
+                         HugePageArena* arena) :
+    m_path(path),
+    m_binding(std::make_shared<HostBinding>(std::string(), input_size))   // compiled already, no device needed
+{
+    if (arena)
+        m_binding->use_arena(*arena);
+    m_cnn.Init(compiled, m_binding);
+}
+
+
+void HostNetwork::infer(const cv::Mat& rgba)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_binding->set_input(rgba);
+    m_cnn.Infer();
+}
+
+
+void HostNetwork::infer(const cv::Mat& rgba, cv::Mat& output)
+{
+    cv::Mat bgr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_binding->set_input(rgba);
+        m_cnn.Infer();
+        m_binding->output_bgr(bgr);
+    }
+
+    cv::Mat styled;
+    cv::cvtColor(bgr, styled, cv::COLOR_BGR2RGBA);
+    if (styled.size() == rgba.size())
+        styled.copyTo(output);
+    else
+        cv::resize(styled, output, rgba.size(), 0, 0, cv::INTER_LINEAR);
+}
+
+
+void HostNetwork::warm_up()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_binding->set_input(cv::Mat(m_binding->input_size(), CV_8UC4, cv::Scalar::all(0)));
+    m_cnn.Infer();
+}
+
+
+HotModel::HotModel(const Config& config) :
+    m_config(config),
+    m_mtime(0),
+    m_pending_mtime(0),
+    m_last_poll(cv::getTickCount()),
+    m_swaps(0),
+    m_failures(0)
+{}
+
+
+HotModel::~HotModel()
+{
+    if (m_pending.valid())
+        m_pending.wait();
+    for (size_t i = 0; i < m_retired.size(); i++)
+        m_retired[i].wait();
+}
+
+
+void HotModel::load(const cv::Ptr<ModelLoader>& loader)
+{
+    if (m_pending.valid())
+    {
+        m_pending.wait();
+        update();
+    }
+    start(loader);
+}
+
+
+void HotModel::reload(const std::string& path)
+{
+    if (m_pending.valid())
+    {
+        m_next_path = path;
+        return;
+    }
+
+    const cv::Size input_size = m_config.input_size;
+    start(cv::makePtr<ModelLoader>(path, m_config.device,
+        [input_size](const std::shared_ptr<ov::Model>& model) { return prepare_host_input(model, input_size); }));
+}
+
+
+void HotModel::start(const cv::Ptr<ModelLoader>& loader)
+{
+    m_pending_path  = loader->path();
+    m_pending_mtime = modification_time(loader->path());
+    if (m_path.empty())
+        m_path = m_pending_path;
+
+    const cv::Size input_size = m_config.input_size;
+    HugePageArena* arena = m_config.arena;
+    m_pending = std::async(std::launch::async, [loader, input_size, arena]() {
+        std::shared_ptr<HostNetwork> network =
+            std::make_shared<HostNetwork>(loader->wait(), input_size, loader->path(), arena);
+        network->warm_up();
+        return network;
+    });
+}
+
+
+bool HotModel::update()
+{
+    bool swapped = false;
+
+    if (m_pending.valid() && m_pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        try
+        {
+            std::shared_ptr<HostNetwork> network = m_pending.get();
+            std::shared_ptr<HostNetwork> old;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                old = m_current;
+                m_current = network;
+            }
+            retire(std::move(old));
+
+            m_path  = m_pending_path;
+            m_mtime = m_pending_mtime;
+            m_swaps++;
+            swapped = true;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "can not load " << m_pending_path << ": " << e.what() << std::endl;
+            m_failures++;
+
+            // a broken version of the watched file isn't retried until it changes again
+            if (m_pending_path == m_path)
+                m_mtime = m_pending_mtime;
+        }
+
+        if (!m_next_path.empty())
+        {
+            std::string next;
+            next.swap(m_next_path);
+            reload(next);
+        }
+    }
+
+    if (m_config.watch_interval_ms > 0 && !m_pending.valid() && !m_path.empty())
+    {
+        const int64 now = cv::getTickCount();
+        if ((now - m_last_poll) * 1000. / cv::getTickFrequency() >= m_config.watch_interval_ms)
+        {
+            m_last_poll = now;
+            const std::time_t mtime = modification_time(m_path);
+            if (mtime != 0 && mtime != m_mtime)
+                reload(m_path);
+        }
+    }
+
+    return swapped;
+}
+
+
+void HotModel::retire(std::shared_ptr<HostNetwork> network)
+{
+    if (!network)
+        return;
+
+    // only finished releases are dropped: waiting for one here would stall the frame
+    // that swapped in the new network
+    m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(), [](const std::future<void>& f) {
+                        return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                    }),
+                    m_retired.end());
+
+    // unless a frame in flight still holds it, the last reference goes on another thread,
+    // so freeing the compiled model doesn't land between two frames
+    m_retired.push_back(std::async(std::launch::async, [old = std::move(network)]() mutable { old.reset(); }));
+}
+
+
+std::shared_ptr<HostNetwork> HotModel::current() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_current;
+}
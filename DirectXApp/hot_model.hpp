@@ -0,0 +1,108 @@
+/*
+// Style network that can be replaced between frames without stalling them
+*/
+#pragma once
+
+#include <ctime>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "opencv2/core.hpp"
+#include "openvino/openvino.hpp"
+
+#include "cnn.hpp"
+#include "huge_page_arena.hpp"
+#include "model_loader.hpp"
+
+// One compiled network with its infer request, fed host RGBA frames of any size.
+// infer() may be called from several threads; calls on one network are serialized.
+class HostNetwork
+{
+public:
+    // with `arena`, its input and output tensors are allocated there
+    HostNetwork(ov::CompiledModel compiled, cv::Size input_size, const std::string& path,
+                HugePageArena* arena = 0);
+
+    void infer(const cv::Mat& rgba);
+
+    // same, with the stylized frame as RGBA of the input's size in `output`
+    void infer(const cv::Mat& rgba, cv::Mat& output);
+
+    // one inference on a blank frame, so the first real frame doesn't pay for lazy
+    // allocations and kernel selection in the plugin
+    void warm_up();
+
+    const std::string& path() const { return m_path; }
+    size_t ncalls() const { return m_cnn.ncalls(); }
+
+private:
+    std::string                  m_path;
+    std::mutex                   m_mutex;
+    std::shared_ptr<HostBinding> m_binding;
+    Cnn                          m_cnn;
+};
+
+// The network a stream infers with, replaceable at frame granularity. A new model is
+// read, compiled and warmed up on a background thread; update(), called between frames,
+// then swaps it in with a pointer exchange. Frames already holding the old network from
+// current() finish on it, and it is released once the last of them lets go, off the
+// calling thread. A failed load leaves the current network in place.
+class HotModel
+{
+public:
+    struct Config
+    {
+        std::string    device            = "CPU";
+        cv::Size       input_size        = cv::Size(640, 480);
+        double         watch_interval_ms = 0;   // reload when the model file changes (0 - off)
+        HugePageArena* arena             = 0;   // host tensors, outlives the HotModel (0 - own memory)
+    };
+
+    explicit HotModel(const Config& config);
+
+    // waits for a running load and for the release of retired networks
+    ~HotModel();
+
+    // take over a load started elsewhere, e.g. at startup; its model must have been
+    // prepared with prepare_host_input for config.input_size
+    void load(const cv::Ptr<ModelLoader>& loader);
+
+    // start loading `path`; while another load runs, it starts after that one
+    void reload(const std::string& path);
+
+    // call between frames: installs a finished load and polls the watched file; never
+    // waits for a load. True if a new network was swapped in.
+    bool update();
+
+    // network for one frame, empty until the first load finishes
+    std::shared_ptr<HostNetwork> current() const;
+
+    bool loading() const { return m_pending.valid(); }
+
+    // path of the current network, or of the first load before that
+    const std::string& path() const { return m_path; }
+
+    size_t swaps() const { return m_swaps; }
+    size_t failures() const { return m_failures; }
+
+private:
+    void start(const cv::Ptr<ModelLoader>& loader);
+    void retire(std::shared_ptr<HostNetwork> network);
+
+    Config                                     m_config;
+    mutable std::mutex                         m_mutex;     // guards m_current
+    std::shared_ptr<HostNetwork>               m_current;
+    std::future<std::shared_ptr<HostNetwork> > m_pending;
+    std::string                                m_pending_path;
+    std::string                                m_next_path;   // reload requested during a load
+    std::vector<std::future<void> >            m_retired;     // releases still running
+    std::string                                m_path;
+    std::time_t                                m_mtime;       // of m_path when its load started
+    std::time_t                                m_pending_mtime;
+    int64                                      m_last_poll;
+    size_t                                     m_swaps;
+    size_t                                     m_failures;
+};
@@ -0,0 +1,375 @@
+/*
+// Arena of huge-page-backed memory for frame buffers and host tensors
+*/
+#include "huge_page_arena.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#pragma comment (lib, "advapi32.lib")
+#else
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+
+const size_t PAGE = 4096;
+
+size_t round_up(size_t bytes, size_t multiple)
+{
+    return (bytes + multiple - 1) / multiple * multiple;
+}
+
+#ifdef _WIN32
+
+// MEM_LARGE_PAGES needs SeLockMemoryPrivilege held by the account and enabled in the token
+bool enable_lock_memory_privilege()
+{
+    static const bool enabled = []() {
+        HANDLE token;
+        if (!::OpenProcessToken(::GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+            return false;
+
+        TOKEN_PRIVILEGES privileges = {};
+        privileges.PrivilegeCount = 1;
+        privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        bool ok = ::LookupPrivilegeValueA(NULL, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid) &&
+                  ::AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL) &&
+                  ::GetLastError() == ERROR_SUCCESS;   // not ERROR_NOT_ALL_ASSIGNED
+        ::CloseHandle(token);
+        return ok;
+    }();
+    return enabled;
+}
+
+size_t system_huge_page_size()
+{
+    const size_t size = ::GetLargePageMinimum();
+    return size ? size : (size_t)2 << 20;
+}
+
+#else
+
+size_t system_huge_page_size()
+{
+    std::ifstream meminfo("/proc/meminfo");
+    std::string line;
+    while (std::getline(meminfo, line))
+    {
+        size_t kb = 0;
+        if (sscanf(line.c_str(), "Hugepagesize: %zu kB", &kb) == 1 && kb)
+            return kb << 10;
+    }
+    return (size_t)2 << 20;
+}
+
+#endif
+
+} // namespace
+
+
+class HugePageArena::MatAllocator : public cv::MatAllocator
+{
+public:
+    explicit MatAllocator(HugePageArena* arena) : m_arena(arena) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data0, size_t* step,
+                           cv::AccessFlag, cv::UMatUsageFlags) const
+    {
+        // same layout as OpenCV's own allocator
+        size_t total = CV_ELEM_SIZE(type);
+        for (int i = dims - 1; i >= 0; i--)
+        {
+            if (step)
+            {
+                if (data0 && step[i] != cv::Mat::AUTO_STEP)
+                {
+                    CV_Assert(total <= step[i]);
+                    total = step[i];
+                }
+                else
+                {
+                    step[i] = total;
+                }
+            }
+            total *= sizes[i];
+        }
+
+        cv::UMatData* u = new cv::UMatData(this);
+        u->data = u->origdata = data0 ? (uchar*)data0 : (uchar*)m_arena->allocate(total);
+        u->size = total;
+        if (data0)
+            u->flags |= cv::UMatData::USER_ALLOCATED;
+        return u;
+    }
+
+    bool allocate(cv::UMatData* u, cv::AccessFlag, cv::UMatUsageFlags) const
+    {
+        return u != 0;
+    }
+
+    void deallocate(cv::UMatData* u) const
+    {
+        if (!u)
+            return;
+
+        CV_Assert(u->urefcount == 0 && u->refcount == 0);
+        if (!(u->flags & cv::UMatData::USER_ALLOCATED))
+            m_arena->deallocate(u->origdata);
+        delete u;
+    }
+
+private:
+    HugePageArena* m_arena;
+};
+
+
+class HugePageArena::TensorAllocator : public ov::AllocatorImpl
+{
+public:
+    explicit TensorAllocator(HugePageArena* arena) : m_arena(arena) {}
+
+    void* allocate(const size_t bytes, const size_t alignment)
+    {
+        if (alignment > PAGE)
+            throw std::runtime_error("arena blocks are only page aligned");
+        return m_arena->allocate(bytes);
+    }
+
+    void deallocate(void* handle, const size_t, size_t)
+    {
+        m_arena->deallocate(handle);
+    }
+
+    bool is_equal(const ov::AllocatorImpl& other) const
+    {
+        const TensorAllocator* arena = dynamic_cast<const TensorAllocator*>(&other);
+        return arena && arena->m_arena == m_arena;
+    }
+
+private:
+    HugePageArena* m_arena;
+};
+
+
+const char* HugePageArena::name(Pages pages)
+{
+    switch (pages)
+    {
+    case PAGES_DEFAULT:     return "default";
+    case PAGES_TRANSPARENT: return "transparent";
+    case PAGES_EXPLICIT:    return "explicit";
+    }
+    return "?";
+}
+
+
+HugePageArena::HugePageArena(const Config& config) :
+    m_config(config),
+    m_huge_page(system_huge_page_size()),
+    m_used(0),
+    m_mat_allocator(new MatAllocator(this))
+{
+    CV_Assert(config.chunk_bytes > 0);
+}
+
+
+HugePageArena::~HugePageArena()
+{
+    for (size_t i = 0; i < m_chunks.size(); i++)
+        unmap_chunk(m_chunks[i]);
+}
+
+
+#ifdef _WIN32
+
+HugePageArena::Chunk HugePageArena::map_chunk(size_t bytes)
+{
+    Chunk chunk = { 0, round_up(bytes, m_huge_page), 0, PAGES_DEFAULT };
+
+    if (m_config.pages == PAGES_EXPLICIT && enable_lock_memory_privilege())
+    {
+        chunk.base = (char*)::VirtualAlloc(NULL, chunk.size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (chunk.base)
+            chunk.pages = PAGES_EXPLICIT;
+    }
+    if (!chunk.base)
+        chunk.base = (char*)::VirtualAlloc(NULL, chunk.size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!chunk.base)
+        throw std::bad_alloc();
+    return chunk;
+}
+
+
+void HugePageArena::unmap_chunk(const Chunk& chunk)
+{
+    ::VirtualFree(chunk.base, 0, MEM_RELEASE);
+}
+
+#else
+
+HugePageArena::Chunk HugePageArena::map_chunk(size_t bytes)
+{
+    Chunk chunk = { 0, round_up(bytes, m_huge_page), 0, PAGES_DEFAULT };
+
+    if (m_config.pages == PAGES_EXPLICIT)
+    {
+        void* p = ::mmap(0, chunk.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            chunk.base  = (char*)p;
+            chunk.pages = PAGES_EXPLICIT;
+            return chunk;
+        }
+    }
+
+    if (m_config.pages == PAGES_DEFAULT)
+    {
+        void* p = ::mmap(0, chunk.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            throw std::bad_alloc();
+        chunk.base = (char*)p;
+        return chunk;
+    }
+
+    // a huge page can only back a huge-page-aligned range: over-map, then trim both ends
+    void* p = ::mmap(0, chunk.size + m_huge_page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        throw std::bad_alloc();
+
+    char* mapped = (char*)p;
+    char* base   = (char*)round_up((size_t)mapped, m_huge_page);
+    if (base > mapped)
+        ::munmap(mapped, base - mapped);
+    ::munmap(base + chunk.size, mapped + m_huge_page - base);
+
+    chunk.base = base;
+    if (::madvise(base, chunk.size, MADV_HUGEPAGE) == 0)
+        chunk.pages = PAGES_TRANSPARENT;
+    return chunk;
+}
+
+
+void HugePageArena::unmap_chunk(const Chunk& chunk)
+{
+    ::munmap(chunk.base, chunk.size);
+}
+
+#endif
+
+
+void* HugePageArena::allocate(size_t bytes)
+{
+    const size_t size = round_up(std::max<size_t>(bytes, 1), PAGE);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    char*  p     = 0;
+    size_t block = size;
+
+    std::multimap<size_t, char*>::iterator it = m_free.lower_bound(size);
+    if (it != m_free.end() && it->first - size <= size / 4)
+    {
+        block = it->first;
+        p     = it->second;
+        m_free.erase(it);
+    }
+    else
+    {
+        if (m_chunks.empty() || m_chunks.back().size - m_chunks.back().used < size)
+        {
+            // the tail of the full chunk stays available to smaller blocks
+            if (!m_chunks.empty() && m_chunks.back().used < m_chunks.back().size)
+            {
+                Chunk& last = m_chunks.back();
+                m_free.insert(std::make_pair(last.size - last.used, last.base + last.used));
+                last.used = last.size;
+            }
+            m_chunks.push_back(map_chunk(std::max(m_config.chunk_bytes, size)));
+        }
+
+        Chunk& chunk = m_chunks.back();
+        p = chunk.base + chunk.used;
+        chunk.used += size;
+    }
+
+    m_blocks[p] = block;
+    m_used += block;
+    return p;
+}
+
+
+void HugePageArena::deallocate(void* p)
+{
+    if (!p)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unordered_map<char*, size_t>::iterator it = m_blocks.find((char*)p);
+    CV_Assert(it != m_blocks.end());
+
+    m_free.insert(std::make_pair(it->second, it->first));
+    m_used -= it->second;
+    m_blocks.erase(it);
+}
+
+
+cv::MatAllocator* HugePageArena::mat_allocator()
+{
+    return m_mat_allocator.get();
+}
+
+
+ov::Allocator HugePageArena::tensor_allocator()
+{
+    return ov::Allocator(std::make_shared<TensorAllocator>(this));
+}
+
+
+size_t HugePageArena::reserved_bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < m_chunks.size(); i++)
+        bytes += m_chunks[i].size;
+    return bytes;
+}
+
+
+size_t HugePageArena::reserved_bytes(Pages pages) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < m_chunks.size(); i++)
+        if (m_chunks[i].pages == pages)
+            bytes += m_chunks[i].size;
+    return bytes;
+}
+
+
+size_t HugePageArena::used_bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_used;
+}
+
+
+void HugePageArena::print(std::ostream& out) const
+{
+    out << cv::format("[arena] %s pages of %d KB asked for: %d MB reserved (%d MB explicit, %d MB transparent, "
+                      "%d MB default), %d MB in use",
+                      name(m_config.pages), (int)(m_huge_page >> 10), (int)(reserved_bytes() >> 20),
+                      (int)(reserved_bytes(PAGES_EXPLICIT) >> 20), (int)(reserved_bytes(PAGES_TRANSPARENT) >> 20),
+                      (int)(reserved_bytes(PAGES_DEFAULT) >> 20), (int)(used_bytes() >> 20)) << std::endl;
+}
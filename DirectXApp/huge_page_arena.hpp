@@ -0,0 +1,92 @@
+/*
+// Arena of huge-page-backed memory for frame buffers and host tensors
+*/
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "opencv2/core.hpp"
+#include "openvino/runtime/allocator.hpp"
+
+// Frame buffers and host tensors carved out of large chunks that the OS may back with
+// huge pages, so a frame spans a handful of TLB entries instead of hundreds:
+//   PAGES_DEFAULT      regular pages, for comparison
+//   PAGES_TRANSPARENT  2 MB-aligned chunks advised for transparent huge pages (madvise on
+//                      Linux); Windows has no transparent huge pages and gets regular ones
+//   PAGES_EXPLICIT     reserved huge pages: MAP_HUGETLB, or MEM_LARGE_PAGES with the "lock
+//                      pages in memory" privilege on Windows. A chunk that can't get them
+//                      falls back to PAGES_TRANSPARENT.
+//
+// Blocks are whole 4 KB pages. A freed block goes to a free list and is handed out again
+// for requests up to a quarter smaller; frame buffers come back at the sizes they left
+// with, so there is no coalescing. Chunks are returned to the OS only with the arena,
+// which must outlive every Mat and tensor it allocated.
+class HugePageArena
+{
+public:
+    enum Pages
+    {
+        PAGES_DEFAULT,
+        PAGES_TRANSPARENT,
+        PAGES_EXPLICIT
+    };
+
+    static const char* name(Pages pages);
+
+    struct Config
+    {
+        Pages  pages       = PAGES_TRANSPARENT;
+        size_t chunk_bytes = 64 << 20;   // larger requests get a chunk of their own
+    };
+
+    explicit HugePageArena(const Config& config);
+    ~HugePageArena();
+
+    // page aligned; throws std::bad_alloc when the OS refuses a chunk
+    void* allocate(size_t bytes);
+    void  deallocate(void* p);
+
+    // set as cv::Mat::allocator before the Mat is created
+    cv::MatAllocator* mat_allocator();
+
+    // for ov::Tensor(type, shape, allocator)
+    ov::Allocator tensor_allocator();
+
+    size_t huge_page_size() const { return m_huge_page; }
+    size_t reserved_bytes() const;
+    size_t used_bytes() const;
+    size_t reserved_bytes(Pages pages) const;   // by what the chunks actually got
+
+    void print(std::ostream& out) const;
+
+private:
+    struct Chunk
+    {
+        char*  base;
+        size_t size;
+        size_t used;
+        Pages  pages;
+    };
+
+    class MatAllocator;
+    class TensorAllocator;
+
+    Chunk map_chunk(size_t bytes);
+    void  unmap_chunk(const Chunk& chunk);
+
+    Config                            m_config;
+    size_t                            m_huge_page;
+
+    mutable std::mutex                m_mutex;
+    std::vector<Chunk>                m_chunks;
+    std::multimap<size_t, char*>      m_free;     // by size
+    std::unordered_map<char*, size_t> m_blocks;   // live ones
+    size_t                            m_used;
+
+    std::unique_ptr<MatAllocator>     m_mat_allocator;
+};
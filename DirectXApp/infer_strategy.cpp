@@ -0,0 +1,83 @@
+/*
+// Strategies that spare the style network work across frames
+*/
+#include "infer_strategy.hpp"
+
+const char* InferStrategy::name(Mode mode)
+{
+    switch (mode)
+    {
+    case MODE_EVERY_FRAME: return "every_frame";
+    case MODE_TEMPORAL:    return "temporal";
+    case MODE_CHANGE:      return "change";
+    case MODE_TILES:       return "tiles";
+    }
+    return "?";
+}
+
+
+InferStrategy::InferStrategy(const Config& config) :
+    m_config(config),
+    m_frames(0),
+    m_inferences(0)
+{
+    if (config.mode == MODE_TEMPORAL)
+        m_temporal.reset(new TemporalReuse(config.temporal));
+    else if (config.mode == MODE_CHANGE)
+        m_change.reset(new ChangeDetector(config.change));
+    else if (config.mode == MODE_TILES)
+        m_tiles.reset(new TileRestyler(config.tiles));
+}
+
+
+void InferStrategy::process(const cv::Mat& frame, cv::Mat& output, const InferFn& infer)
+{
+    m_frames++;
+
+    // counts what the strategy lets through
+    const InferFn counted = [this, &infer](const cv::Mat& input, cv::Mat& out) {
+        m_inferences++;
+        infer(input, out);
+    };
+
+    switch (m_config.mode)
+    {
+    case MODE_TEMPORAL:
+        m_temporal->process(frame, output, counted);
+        break;
+    case MODE_CHANGE:
+        m_change->process(frame, output, counted);
+        break;
+    case MODE_TILES:
+        m_tiles->process(frame, output, counted);
+        break;
+    default:
+        counted(frame, output);
+        break;
+    }
+}
+
+
+void InferStrategy::reset()
+{
+    if (m_temporal)
+        m_temporal->reset();
+    if (m_change)
+        m_change->reset();
+    if (m_tiles)
+        m_tiles->reset();
+}
+
+
+void InferStrategy::print(std::ostream& out) const
+{
+    out << "[strategy] " << name(m_config.mode) << ": network on " << m_inferences << " of " << m_frames
+        << " frames";
+    if (m_temporal)
+        out << ", keyframe interval " << m_temporal->interval();
+    if (m_change)
+        out << ", threshold " << m_config.change.threshold;
+    if (m_tiles)
+        out << ", " << cvRound(m_tiles->mean_tile_ratio() * 100) << "% of tiles per frame";
+    out << std::endl;
+}
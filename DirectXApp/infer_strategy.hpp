@@ -0,0 +1,70 @@
+/*
+// Strategies that spare the style network work across frames
+*/
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <memory>
+
+#include "opencv2/core.hpp"
+
+#include "change_detector.hpp"
+#include "temporal_reuse.hpp"
+#include "tile_restyler.hpp"
+
+// The stylized output of a frame, through one of the ways of running the network less
+// often than on every frame:
+//   MODE_EVERY_FRAME  the network on every frame
+//   MODE_TEMPORAL     TemporalReuse: keyframes, flow-warped output in between
+//   MODE_CHANGE       ChangeDetector: the last output again while the frame barely changes
+//   MODE_TILES        TileRestyler: the network only on tiles where the scene changed
+//
+// Strategies keep state from frame to frame, so frames must come in order, from one
+// stream. `infer` must produce an output of its input's size and type.
+class InferStrategy
+{
+public:
+    enum Mode
+    {
+        MODE_EVERY_FRAME,
+        MODE_TEMPORAL,
+        MODE_CHANGE,
+        MODE_TILES
+    };
+
+    static const char* name(Mode mode);
+
+    struct Config
+    {
+        Mode                  mode     = MODE_EVERY_FRAME;
+        TemporalReuse::Config temporal;
+        ChangeDetector::Config change;
+        TileRestyler::Config   tiles;   // set tiles.network_input for a network with a fixed input
+    };
+
+    typedef std::function<void(const cv::Mat&, cv::Mat&)> InferFn;
+
+    explicit InferStrategy(const Config& config);
+
+    Mode mode() const { return m_config.mode; }
+
+    void process(const cv::Mat& frame, cv::Mat& output, const InferFn& infer);
+
+    // forget earlier frames, e.g. on a source change
+    void reset();
+
+    size_t frames() const { return m_frames; }
+    size_t inferences() const { return m_inferences; }
+
+    // "[strategy] ..." line with the frames the network ran on
+    void print(std::ostream& out) const;
+
+private:
+    Config                          m_config;
+    std::unique_ptr<TemporalReuse>  m_temporal;
+    std::unique_ptr<ChangeDetector> m_change;
+    std::unique_ptr<TileRestyler>   m_tiles;
+    size_t                          m_frames;
+    size_t                          m_inferences;
+};
@@ -0,0 +1,102 @@
+/*
+// Client of the local inference daemon
+*/
+#include "inference_client.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "frame_source.hpp"
+#include "inference_protocol.hpp"
+
+namespace
+{
+
+InferMessage message(int type)
+{
+    InferMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.magic   = INFER_PROTOCOL_MAGIC;
+    msg.version = INFER_PROTOCOL_VERSION;
+    msg.type    = (uint32_t)type;
+    return msg;
+}
+
+} // namespace
+
+
+InferenceClient::InferenceClient(const std::string& socket_path, cv::Size frame_size) :
+    m_frame_size(frame_size),
+    m_requests(0),
+    m_server_ms(0)
+{
+    CV_Assert(frame_size.area() > 0);
+
+    m_socket = LocalSocket::connect(socket_path);
+
+    InferMessage msg = message(INFER_HELLO);
+    msg.width  = (uint32_t)frame_size.width;
+    msg.height = (uint32_t)frame_size.height;
+    exchange(msg, INFER_HELLO);
+
+    const size_t frame_bytes  = (size_t)frame_size.area() * 4;
+    const size_t output_bytes = (size_t)msg.output_bytes;
+    for (int i = 0; i < 4 && msg.output_shape[i]; i++)
+        m_output_shape.push_back((int)msg.output_shape[i]);
+
+    // unique among the sessions of this machine
+    const std::string name = cv::format("dxinfer_%llx",
+        (unsigned long long)((((uint64)now_us() << 16) ^ (uint64)(uintptr_t)this) | 1));
+    m_shm.create(name, frame_bytes + output_bytes);
+
+    m_input  = cv::Mat(frame_size, CV_8UC4, m_shm.data());
+    m_output = cv::Mat(1, (int)(output_bytes / sizeof(float)), CV_32F, m_shm.data() + frame_bytes);
+
+    msg = message(INFER_ATTACH);
+    strncpy(msg.text, name.c_str(), sizeof(msg.text) - 1);
+    exchange(msg, INFER_ATTACH);
+}
+
+
+void InferenceClient::exchange(InferMessage& msg, int expected)
+{
+    if (!m_socket.send(&msg, sizeof(msg)) || !m_socket.receive(&msg, sizeof(msg)))
+        throw std::runtime_error("connection to the inference server lost");
+
+    if (msg.magic != INFER_PROTOCOL_MAGIC || msg.version != INFER_PROTOCOL_VERSION)
+        throw std::runtime_error("inference server protocol mismatch");
+    if (msg.type == INFER_ERROR)
+        throw std::runtime_error("inference server: " + std::string(msg.text, strnlen(msg.text, sizeof(msg.text))));
+    if (msg.type != (uint32_t)expected)
+        throw std::runtime_error("unexpected reply from the inference server");
+}
+
+
+void InferenceClient::infer()
+{
+    InferMessage msg = message(INFER_RUN);
+    msg.id = m_requests;
+    exchange(msg, INFER_DONE);
+
+    if (msg.id != m_requests)
+        throw std::runtime_error("inference server replied out of order");
+
+    m_server_ms = msg.infer_ms;
+    m_requests++;
+}
+
+
+void InferenceClient::infer(const cv::Mat& rgba)
+{
+    CV_Assert(rgba.size() == m_frame_size && rgba.type() == CV_8UC4);
+    rgba.copyTo(m_input);
+    infer();
+}
+
+
+void InferenceClient::shutdown_server()
+{
+    InferMessage msg = message(INFER_SHUTDOWN);
+    exchange(msg, INFER_SHUTDOWN);
+    m_socket.close();
+}
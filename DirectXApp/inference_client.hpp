@@ -0,0 +1,58 @@
+/*
+// Client of the local inference daemon
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "opencv2/core.hpp"
+
+#include "local_socket.hpp"
+#include "shared_memory.hpp"
+
+struct InferMessage;
+
+// One session with an InferenceServer. Frames are written into shared memory the client
+// creates, and the server writes the output tensor next to them; only a request id and
+// its reply travel over the socket. Not thread safe: one session per thread.
+class InferenceClient
+{
+public:
+    // connect and set up the shared memory for RGBA frames of `frame_size`; throws
+    // std::runtime_error if the server can't be reached or refuses the session
+    InferenceClient(const std::string& socket_path, cv::Size frame_size);
+
+    // RGBA frame in shared memory, to fill in place before infer()
+    const cv::Mat& input() const { return m_input; }
+
+    // output tensor as written by the server, flat f32, and its shape
+    const cv::Mat& output() const { return m_output; }
+    const std::vector<int>& output_shape() const { return m_output_shape; }
+
+    // run the network on input(); throws std::runtime_error on a server error or a lost
+    // connection. The output is complete when this returns.
+    void infer();
+
+    // copy `rgba` to input() first
+    void infer(const cv::Mat& rgba);
+
+    // time the last request spent in the network on the server side
+    double server_infer_ms() const { return m_server_ms; }
+    uint64 requests() const { return m_requests; }
+
+    // ask the server to exit; the session ends with it
+    void shutdown_server();
+
+private:
+    void exchange(InferMessage& msg, int expected);
+
+    LocalSocket      m_socket;
+    SharedMemory     m_shm;
+    cv::Size         m_frame_size;
+    cv::Mat          m_input;
+    cv::Mat          m_output;
+    std::vector<int> m_output_shape;
+    uint64           m_requests;
+    double           m_server_ms;
+};
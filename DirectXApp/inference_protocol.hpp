@@ -0,0 +1,50 @@
+/*
+// Messages between the inference server and its clients
+//
+// Control messages only: every message is one InferMessage over the Unix domain socket.
+// Pixels and tensors stay in a shared memory segment the client creates per connection:
+//   [0, frame_bytes)                            RGBA input frame, continuous rows
+//   [frame_bytes, frame_bytes + output_bytes)   f32 output tensor, written by the server
+//
+// A session is
+//   client HELLO (frame size)        -> server HELLO (output shape and bytes)
+//   client ATTACH (segment name)     -> server ATTACH
+//   client RUN (id), repeated        -> server DONE (id, inference time)
+// and ends when either side closes the socket. Any request can be answered with ERROR.
+// SHUTDOWN stops the server after the session it arrives on.
+*/
+#pragma once
+
+#include <cstdint>
+
+enum InferMessageType
+{
+    INFER_HELLO    = 1,
+    INFER_ATTACH   = 2,
+    INFER_RUN      = 3,
+    INFER_DONE     = 4,
+    INFER_ERROR    = 5,
+    INFER_SHUTDOWN = 6
+};
+
+const uint32_t INFER_PROTOCOL_MAGIC   = 0x44584946;   // "DXIF"
+const uint32_t INFER_PROTOCOL_VERSION = 1;
+
+struct InferMessage
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t type;              // InferMessageType
+    int32_t  status;            // 0 - ok
+    uint64_t id;                // RUN/DONE: request id, echoed
+
+    uint32_t width;             // HELLO: input frame size
+    uint32_t height;
+    uint64_t output_bytes;      // HELLO reply
+    uint32_t output_shape[4];
+    double   infer_ms;          // DONE: time in the network
+
+    char     text[64];          // ATTACH: segment name; ERROR: reason
+};
+
+static_assert(sizeof(InferMessage) == 128, "InferMessage layout is part of the protocol");
@@ -0,0 +1,256 @@
+/*
+// Local inference daemon: one compiled style network serving client processes
+*/
+#include "inference_server.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "cnn.hpp"
+#include "inference_protocol.hpp"
+#include "model_loader.hpp"
+#include "shared_memory.hpp"
+#include "tensor_binding.hpp"
+
+struct InferenceServer::Session
+{
+    LocalSocket       socket;
+    std::thread       thread;
+    std::atomic<bool> done;
+
+    Session() : done(false) {}
+};
+
+
+InferenceServer::InferenceServer(const Config& config) :
+    m_config(config),
+    m_stop(false),
+    m_requests(0),
+    m_sessions_total(0)
+{
+    ov::Core core;
+    m_compiled = core.compile_model(prepare_host_input(core.read_model(m_config.model), m_config.input_size),
+                                    m_config.device, m_config.openvino_config);
+
+    m_listener = LocalSocket::listen(m_config.socket_path);
+}
+
+
+InferenceServer::~InferenceServer()
+{
+    m_stop = true;
+    reap(true);
+}
+
+
+void InferenceServer::stop()
+{
+    m_stop = true;
+
+    // accept() has no portable way to be interrupted; hand it a connection instead
+    try
+    {
+        LocalSocket::connect(m_config.socket_path);
+    }
+    catch (const std::exception&)
+    {
+    }
+}
+
+
+void InferenceServer::reap(bool all)
+{
+    std::list<std::unique_ptr<Session> > finished;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (std::list<std::unique_ptr<Session> >::iterator it = m_sessions.begin(); it != m_sessions.end();)
+        {
+            if (all || (*it)->done)
+            {
+                if (all)
+                    (*it)->socket.shutdown();
+                finished.push_back(std::move(*it));
+                it = m_sessions.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    for (std::list<std::unique_ptr<Session> >::iterator it = finished.begin(); it != finished.end(); ++it)
+        (*it)->thread.join();
+}
+
+
+void InferenceServer::run(std::ostream& log)
+{
+    log << "[server] " << m_config.model << " on " << m_config.device << ", listening on "
+        << m_config.socket_path << std::endl;
+
+    while (!m_stop)
+    {
+        LocalSocket client = m_listener.accept();
+        if (m_stop)
+            break;
+        if (!client.is_open())
+            throw std::runtime_error("accept() failed on " + m_config.socket_path);
+
+        reap(false);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if ((int)m_sessions.size() >= m_config.max_clients)
+        {
+            InferMessage reply;
+            memset(&reply, 0, sizeof(reply));
+            reply.magic   = INFER_PROTOCOL_MAGIC;
+            reply.version = INFER_PROTOCOL_VERSION;
+            reply.type    = INFER_ERROR;
+            reply.status  = -1;
+            strncpy(reply.text, "too many clients", sizeof(reply.text) - 1);
+            client.send(&reply, sizeof(reply));
+            continue;
+        }
+
+        m_sessions.push_back(std::unique_ptr<Session>(new Session));
+        Session* session = m_sessions.back().get();
+        session->socket = std::move(client);
+        session->thread = std::thread(&InferenceServer::serve, this, session, std::ref(log));
+        m_sessions_total++;
+    }
+
+    reap(true);
+    log << "[server] stopped after " << m_sessions_total << " sessions, " << m_requests << " requests" << std::endl;
+}
+
+
+void InferenceServer::serve(Session* session, std::ostream& log)
+{
+    LocalSocket& socket = session->socket;
+
+    const ov::Shape output_shape = m_compiled.output().get_shape();
+    const size_t output_bytes = ov::shape_size(output_shape) * m_compiled.output().get_element_type().size();
+
+    // destroyed in reverse: the tensors on the segment go before the segment
+    SharedMemory                 shm;
+    std::shared_ptr<HostBinding> binding;
+    Cnn                          cnn;
+    cv::Size                     frame_size;
+    size_t                       frame_bytes = 0;
+    size_t                       requests = 0;
+    bool                         shutdown = false;
+
+    InferMessage msg;
+    while (!m_stop && !shutdown && socket.receive(&msg, sizeof(msg)))
+    {
+        InferMessage reply;
+        memset(&reply, 0, sizeof(reply));
+        reply.magic   = INFER_PROTOCOL_MAGIC;
+        reply.version = INFER_PROTOCOL_VERSION;
+        reply.type    = msg.type;
+        reply.id      = msg.id;
+
+        try
+        {
+            if (msg.magic != INFER_PROTOCOL_MAGIC || msg.version != INFER_PROTOCOL_VERSION)
+                throw std::runtime_error("protocol mismatch");
+
+            switch (msg.type)
+            {
+            case INFER_HELLO:
+                // the attached segment and tensors are laid out for the frame size
+                if (binding)
+                    throw std::runtime_error("HELLO after ATTACH");
+                if (msg.width == 0 || msg.height == 0 || msg.width > 8192 || msg.height > 8192)
+                    throw std::runtime_error("bad frame size");
+                frame_size  = cv::Size((int)msg.width, (int)msg.height);
+                frame_bytes = (size_t)frame_size.area() * 4;
+
+                reply.output_bytes = output_bytes;
+                for (size_t i = 0; i < output_shape.size() && i < 4; i++)
+                    reply.output_shape[i] = (uint32_t)output_shape[i];
+                break;
+
+            case INFER_ATTACH:
+                if (!frame_bytes)
+                    throw std::runtime_error("ATTACH before HELLO");
+
+                // the tensors on the previous segment go first; a failed ATTACH leaves
+                // the session unattached
+                cnn = Cnn();
+                binding.reset();
+                shm.open(std::string(msg.text, strnlen(msg.text, sizeof(msg.text))));
+                if (shm.size() < frame_bytes + output_bytes)
+                {
+                    shm.close();
+                    throw std::runtime_error("shared memory too small");
+                }
+
+                binding = std::make_shared<HostBinding>("", m_config.input_size, shm.data() + frame_bytes);
+                cnn.Init(m_compiled, binding);
+                break;
+
+            case INFER_RUN:
+            {
+                if (!cnn.is_initialized() || !binding)
+                    throw std::runtime_error("RUN before ATTACH");
+                if (!shm.is_open() || shm.size() < frame_bytes + output_bytes)
+                    throw std::runtime_error("shared memory too small");
+
+                const double before = cnn.time_elapsed();
+                binding->set_input(cv::Mat(frame_size, CV_8UC4, shm.data()));
+                cnn.Infer();
+
+                reply.type     = INFER_DONE;
+                reply.infer_ms = cnn.time_elapsed() - before;
+                requests++;
+                m_requests++;
+                break;
+            }
+
+            case INFER_SHUTDOWN:
+                shutdown = true;
+                break;
+
+            default:
+                throw std::runtime_error("unknown message");
+            }
+        }
+        catch (const std::exception& e)
+        {
+            reply.type   = INFER_ERROR;
+            reply.status = -1;
+            strncpy(reply.text, e.what(), sizeof(reply.text) - 1);
+        }
+
+        if (!socket.send(&reply, sizeof(reply)))
+            break;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        log << "[server] session ended after " << requests << " requests" << std::endl;
+    }
+
+    if (shutdown)
+        stop();
+    session->done = true;
+}
+
+
+int run_inference_server(const InferenceServer::Config& config)
+{
+    try
+    {
+        InferenceServer server(config);
+        server.run(std::cout);
+        return EXIT_SUCCESS;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "inference server: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,71 @@
+/*
+// Local inference daemon: one compiled style network serving client processes
+*/
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include "opencv2/core.hpp"
+#include "openvino/openvino.hpp"
+
+#include "local_socket.hpp"
+
+// Serves the protocol of inference_protocol.hpp on a Unix domain socket. The model is
+// read and compiled once; every client session gets its own infer request on it, so the
+// weights are shared by all clients while their inferences run concurrently. A session's
+// input is read from and its output written to the client's shared memory in place.
+class InferenceServer
+{
+public:
+    struct Config
+    {
+        std::string socket_path;
+        std::string model;
+        std::string device      = "CPU";
+        cv::Size    input_size  = cv::Size(640, 480);
+        int         max_clients = 16;
+        ov::AnyMap  openvino_config = { ov::hint::performance_mode(ov::hint::PerformanceMode::THROUGHPUT) };
+    };
+
+    // compiles the model and starts listening; throws on failure
+    explicit InferenceServer(const Config& config);
+
+    // stop()s and waits for the sessions
+    ~InferenceServer();
+
+    // accept clients until stop() or a client's SHUTDOWN
+    void run(std::ostream& log);
+
+    // may be called from any thread
+    void stop();
+
+    size_t sessions() const { return m_sessions_total; }
+    uint64 requests() const { return m_requests; }
+
+private:
+    struct Session;
+
+    void serve(Session* session, std::ostream& log);
+    void reap(bool all);
+
+    Config              m_config;
+    ov::CompiledModel   m_compiled;
+    LocalSocket         m_listener;
+
+    std::atomic<bool>   m_stop;
+    std::atomic<uint64> m_requests;
+    size_t              m_sessions_total;
+
+    std::mutex                            m_mutex;      // m_sessions, log output
+    std::list<std::unique_ptr<Session> >  m_sessions;
+};
+
+// Body of a server process: serve until a client asks for shutdown. Returns the process
+// exit code.
+int run_inference_server(const InferenceServer::Config& config);
@@ -0,0 +1,126 @@
+/*
+// Index of a video file's frames and the points decoding can be restarted from
+*/
+#include "keyframe_index.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "opencv2/imgproc.hpp"
+
+KeyframeIndex::KeyframeIndex(const std::string& path) :
+    m_path(path),
+    m_fps(0)
+{
+    cv::VideoCapture cap(path);
+    if (!cap.isOpened())
+        throw std::runtime_error("can't open " + path);
+
+    m_fps = cap.get(cv::CAP_PROP_FPS);
+
+    const double expected = cap.get(cv::CAP_PROP_FRAME_COUNT);
+    if (expected > 0)
+        m_fingerprints.reserve((size_t)expected);
+
+    cv::Mat frame;
+    while (cap.read(frame))
+    {
+        m_size = frame.size();
+        m_fingerprints.push_back(fingerprint(frame));
+    }
+
+    if (m_fingerprints.empty())
+        throw std::runtime_error("no frames decoded from " + path);
+
+    m_probed[0] = true;
+}
+
+
+uint64 KeyframeIndex::fingerprint(const cv::Mat& frame)
+{
+    CV_Assert(frame.type() == CV_8UC3);
+
+    // area averaging over a small grid: any decoding difference that matters shows up,
+    // and hashing it costs nothing next to the decode
+    cv::Mat thumb;
+    cv::resize(frame, thumb, cv::Size(32, 18), 0, 0, cv::INTER_AREA);
+
+    // FNV-1a
+    uint64 h = 14695981039346656037ULL;
+    const uint64 dims[2] = { (uint64)frame.cols, (uint64)frame.rows };
+    for (int i = 0; i < 2; i++)
+        h = (h ^ dims[i]) * 1099511628211ULL;
+    for (int y = 0; y < thumb.rows; y++)
+    {
+        const uchar* p = thumb.ptr<uchar>(y);
+        for (int x = 0; x < thumb.cols * 3; x++)
+            h = (h ^ p[x]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+
+bool KeyframeIndex::probe(cv::VideoCapture& cap, int frame)
+{
+    std::map<int, bool>::const_iterator it = m_probed.find(frame);
+    if (it != m_probed.end())
+        return it->second;
+
+    cv::Mat decoded;
+    const bool entry = cap.set(cv::CAP_PROP_POS_FRAMES, frame) && cap.read(decoded) &&
+                       fingerprint(decoded) == m_fingerprints[frame];
+    m_probed[frame] = entry;
+    return entry;
+}
+
+
+std::vector<VideoSegment> KeyframeIndex::segments(int count, int max_shift)
+{
+    CV_Assert(count > 0);
+
+    const int n = frames();
+    if (max_shift <= 0)
+        max_shift = std::max(1, cvRound((m_fps > 0 ? m_fps : 30) * 2));
+
+    std::vector<int> starts(1, 0);
+
+    cv::VideoCapture cap;
+    for (int i = 1; i < count; i++)
+    {
+        const int target = std::max((int)((int64)n * i / count), starts.back() + 1);
+        const int limit  = std::min(n, target + max_shift);
+
+        for (int f = target; f < limit; f++)
+        {
+            if (!cap.isOpened() && !cap.open(m_path))
+                throw std::runtime_error("can't open " + m_path);
+
+            if (probe(cap, f))
+            {
+                starts.push_back(f);
+                break;
+            }
+        }
+    }
+
+    std::vector<VideoSegment> result;
+    for (size_t i = 0; i < starts.size(); i++)
+    {
+        VideoSegment s;
+        s.first       = starts[i];
+        s.count       = (i + 1 < starts.size() ? starts[i + 1] : n) - starts[i];
+        s.fingerprint = m_fingerprints[starts[i]];
+        result.push_back(s);
+    }
+    return result;
+}
+
+
+std::vector<int> KeyframeIndex::entry_points() const
+{
+    std::vector<int> result;
+    for (std::map<int, bool>::const_iterator it = m_probed.begin(); it != m_probed.end(); ++it)
+        if (it->second)
+            result.push_back(it->first);
+    return result;
+}
@@ -0,0 +1,62 @@
+/*
+// Index of a video file's frames and the points decoding can be restarted from
+*/
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "opencv2/core.hpp"
+#include "opencv2/videoio.hpp"
+
+// Run of frames decoded independently of the rest of the video
+struct VideoSegment
+{
+    int    first;          // index of the first frame
+    int    count;
+    uint64 fingerprint;    // of the first frame, for the decoder to check its seek
+};
+
+// Frame count, rate and a fingerprint of every frame of a video file, from one
+// sequential decoding pass through cv::VideoCapture.
+//
+// OpenCV's capture API doesn't report key frames, so entry points are found by probing:
+// a frame is an entry point if seeking to it with CAP_PROP_POS_FRAMES decodes a frame
+// with the fingerprint recorded in the sequential pass. Backends that seek to the
+// preceding key frame and decode forward pass the probe at every frame, others only at
+// key frames; either way a segment starting at an entry point decodes exactly the frames
+// a sequential decode would.
+class KeyframeIndex
+{
+public:
+    // throws std::runtime_error if the file can't be opened or has no frames
+    explicit KeyframeIndex(const std::string& path);
+
+    const std::string& path() const { return m_path; }
+    int frames() const { return (int)m_fingerprints.size(); }
+    double fps() const { return m_fps; }
+    cv::Size size() const { return m_size; }
+
+    uint64 fingerprint(int frame) const { return m_fingerprints[frame]; }
+
+    // Split into at most `count` segments of similar length. Each boundary is the first
+    // entry point at or after the even split position, within `max_shift` frames
+    // (0 - two seconds); a boundary without one is dropped, merging its segments.
+    std::vector<VideoSegment> segments(int count, int max_shift = 0);
+
+    // entry points probed so far, ascending; frame 0 always is one
+    std::vector<int> entry_points() const;
+
+    // of a decoded BGR frame; cheap and stable across decoders of the same stream
+    static uint64 fingerprint(const cv::Mat& frame);
+
+private:
+    bool probe(cv::VideoCapture& cap, int frame);
+
+    std::string         m_path;
+    double              m_fps;
+    cv::Size            m_size;
+    std::vector<uint64> m_fingerprints;
+    std::map<int, bool> m_probed;
+};
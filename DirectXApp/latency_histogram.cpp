@@ -0,0 +1,97 @@
+/*
+// Latency histogram with logarithmic buckets, for per-stream percentiles
+*/
+#include "latency_histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace
+{
+
+const double MIN_MS  = 0.01;
+const double GROWTH  = 1.1;
+const int    BUCKETS = 170;   // MIN_MS * GROWTH^170 ~ 110 s
+
+} // namespace
+
+
+LatencyHistogram::LatencyHistogram() :
+    m_buckets(BUCKETS, 0),
+    m_count(0),
+    m_sum(0),
+    m_max(0)
+{}
+
+
+int LatencyHistogram::bucket(double ms)
+{
+    if (ms <= MIN_MS)
+        return 0;
+    const int b = (int)std::ceil(std::log(ms / MIN_MS) / std::log(GROWTH));
+    return std::min(b, BUCKETS - 1);
+}
+
+
+double LatencyHistogram::upper_bound(int bucket)
+{
+    return MIN_MS * std::pow(GROWTH, bucket);
+}
+
+
+void LatencyHistogram::add(double ms)
+{
+    m_buckets[bucket(ms)]++;
+    m_count++;
+    m_sum += ms;
+    m_max = std::max(m_max, ms);
+}
+
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    for (int i = 0; i < BUCKETS; i++)
+        m_buckets[i] += other.m_buckets[i];
+    m_count += other.m_count;
+    m_sum   += other.m_sum;
+    m_max    = std::max(m_max, other.m_max);
+}
+
+
+void LatencyHistogram::reset()
+{
+    std::fill(m_buckets.begin(), m_buckets.end(), 0);
+    m_count = 0;
+    m_sum   = 0;
+    m_max   = 0;
+}
+
+
+double LatencyHistogram::percentile(double p) const
+{
+    if (m_count == 0)
+        return 0;
+
+    const size_t rank = std::max<size_t>(1, (size_t)std::ceil(p / 100. * m_count));
+    size_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        seen += m_buckets[i];
+        if (seen >= rank)
+            return std::min(upper_bound(i), m_max);
+    }
+    return m_max;
+}
+
+
+void LatencyHistogram::print(std::ostream& out, const std::string& name) const
+{
+    out << std::fixed << std::setprecision(2)
+        << name << ": n=" << m_count
+        << " mean=" << mean()
+        << " p50=" << percentile(50)
+        << " p90=" << percentile(90)
+        << " p99=" << percentile(99)
+        << " max=" << m_max << " ms" << std::endl;
+}
@@ -0,0 +1,39 @@
+/*
+// Latency histogram with logarithmic buckets, for per-stream percentiles
+*/
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Buckets grow by ~10% from 10 us to ~100 s, so percentiles are within 10% of the
+// true value at any scale with a fixed, small footprint. Not thread safe.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void add(double ms);
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    size_t count() const { return m_count; }
+    double mean() const { return m_count ? m_sum / m_count : 0.; }
+    double max() const { return m_max; }
+
+    // upper bound of the bucket holding the p-th percentile, p in [0, 100]
+    double percentile(double p) const;
+
+    // "<name>: n=.. mean=.. p50=.. p90=.. p99=.. max=.. ms"
+    void print(std::ostream& out, const std::string& name) const;
+
+private:
+    static int bucket(double ms);
+    static double upper_bound(int bucket);
+
+    std::vector<size_t> m_buckets;
+    size_t              m_count;
+    double              m_sum;
+    double              m_max;
+};
@@ -0,0 +1,230 @@
+/*
+// Unix domain stream sockets (AF_UNIX, also on Windows 10 and later)
+*/
+#include "local_socket.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <afunix.h>
+#pragma comment (lib, "ws2_32.lib")
+
+typedef SOCKET socket_t;
+#define SHUT_RDWR SD_BOTH
+#else
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+typedef int socket_t;
+#define INVALID_SOCKET (-1)
+#endif
+
+namespace
+{
+
+void close_socket(intptr_t fd)
+{
+#ifdef _WIN32
+    ::closesocket((SOCKET)fd);
+#else
+    ::close((int)fd);
+#endif
+}
+
+intptr_t open_socket()
+{
+#ifdef _WIN32
+    static std::once_flag started;
+    std::call_once(started, []() {
+        WSADATA data;
+        if (::WSAStartup(MAKEWORD(2, 2), &data) != 0)
+            throw std::runtime_error("WSAStartup() failed");
+    });
+#endif
+
+    const intptr_t fd = (intptr_t)::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == (intptr_t)INVALID_SOCKET)
+        throw std::runtime_error("can't create a Unix domain socket");
+    return fd;
+}
+
+sockaddr_un socket_address(const std::string& path)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        throw std::runtime_error("socket path too long: " + path);
+    memcpy(addr.sun_path, path.c_str(), path.size());
+    return addr;
+}
+
+// true if a connection to `addr` is accepted
+bool listening(const sockaddr_un& addr)
+{
+    const intptr_t fd = open_socket();
+    const bool connected = ::connect((socket_t)fd, (const sockaddr*)&addr, sizeof(addr)) == 0;
+    close_socket(fd);
+    return connected;
+}
+
+} // namespace
+
+
+LocalSocket::LocalSocket() :
+    m_fd((intptr_t)INVALID_SOCKET)
+{}
+
+
+LocalSocket::~LocalSocket()
+{
+    close();
+}
+
+
+LocalSocket::LocalSocket(LocalSocket&& other) :
+    m_fd(other.m_fd),
+    m_path(other.m_path)
+{
+    other.m_fd = (intptr_t)INVALID_SOCKET;
+    other.m_path.clear();
+}
+
+
+LocalSocket& LocalSocket::operator=(LocalSocket&& other)
+{
+    if (this != &other)
+    {
+        close();
+        m_fd   = other.m_fd;
+        m_path = other.m_path;
+        other.m_fd = (intptr_t)INVALID_SOCKET;
+        other.m_path.clear();
+    }
+    return *this;
+}
+
+
+LocalSocket LocalSocket::listen(const std::string& path)
+{
+    const sockaddr_un addr = socket_address(path);
+
+    // a server that died leaves the file behind, and bind() fails on it; one that still
+    // accepts connections keeps it
+    if (listening(addr))
+        throw std::runtime_error("a server already listens on " + path);
+    std::remove(path.c_str());
+
+    LocalSocket s;
+    s.m_fd = open_socket();
+
+    if (::bind((socket_t)s.m_fd, (const sockaddr*)&addr, sizeof(addr)) != 0)
+        throw std::runtime_error("can't bind " + path);
+    s.m_path = path;
+
+    if (::listen((socket_t)s.m_fd, SOMAXCONN) != 0)
+        throw std::runtime_error("can't listen on " + path);
+    return s;
+}
+
+
+LocalSocket LocalSocket::connect(const std::string& path)
+{
+    const sockaddr_un addr = socket_address(path);
+
+    LocalSocket s;
+    s.m_fd = open_socket();
+    if (::connect((socket_t)s.m_fd, (const sockaddr*)&addr, sizeof(addr)) != 0)
+        throw std::runtime_error("nothing listens on " + path);
+    return s;
+}
+
+
+LocalSocket LocalSocket::accept()
+{
+    LocalSocket s;
+    for (;;)
+    {
+        s.m_fd = (intptr_t)::accept((socket_t)m_fd, NULL, NULL);
+#ifndef _WIN32
+        if (s.m_fd < 0 && errno == EINTR)
+            continue;
+#endif
+        break;
+    }
+    return s;
+}
+
+
+bool LocalSocket::send(const void* data, size_t size)
+{
+    const char* p = (const char*)data;
+    while (size > 0)
+    {
+#ifdef _WIN32
+        const int n = ::send((SOCKET)m_fd, p, (int)size, 0);
+#else
+        const ssize_t n = ::send((int)m_fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+#endif
+        if (n <= 0)
+            return false;
+        p    += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+
+bool LocalSocket::receive(void* data, size_t size)
+{
+    char* p = (char*)data;
+    while (size > 0)
+    {
+#ifdef _WIN32
+        const int n = ::recv((SOCKET)m_fd, p, (int)size, 0);
+#else
+        const ssize_t n = ::recv((int)m_fd, p, size, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+#endif
+        if (n <= 0)
+            return false;
+        p    += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+
+void LocalSocket::shutdown()
+{
+    if (is_open())
+        ::shutdown((socket_t)m_fd, SHUT_RDWR);
+}
+
+
+void LocalSocket::close()
+{
+    if (is_open())
+        close_socket(m_fd);
+    if (!m_path.empty())
+        std::remove(m_path.c_str());
+
+    m_fd = (intptr_t)INVALID_SOCKET;
+    m_path.clear();
+}
+
+
+bool LocalSocket::is_open() const
+{
+    return m_fd != (intptr_t)INVALID_SOCKET;
+}
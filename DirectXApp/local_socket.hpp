@@ -0,0 +1,48 @@
+/*
+// Unix domain stream sockets (AF_UNIX, also on Windows 10 and later)
+*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Owning handle of a connected or listening socket; movable, not copyable. Transfers
+// are whole: send() and receive() loop until every byte has gone through.
+class LocalSocket
+{
+public:
+    LocalSocket();
+    ~LocalSocket();
+
+    LocalSocket(LocalSocket&& other);
+    LocalSocket& operator=(LocalSocket&& other);
+
+    LocalSocket(const LocalSocket&) = delete;
+    LocalSocket& operator=(const LocalSocket&) = delete;
+
+    // bind `path`, replacing a socket file left by a server that died; the file is
+    // removed again when the listener closes. Throws std::runtime_error on failure, and
+    // if a server still accepts connections on `path`.
+    static LocalSocket listen(const std::string& path);
+
+    // throws std::runtime_error if nothing listens on `path`
+    static LocalSocket connect(const std::string& path);
+
+    // next connection; a closed socket on failure
+    LocalSocket accept();
+
+    // false once the peer is gone
+    bool send(const void* data, size_t size);
+    bool receive(void* data, size_t size);
+
+    // end the connection both ways; a thread blocked in receive() returns false
+    void shutdown();
+
+    void close();
+
+    bool is_open() const;
+
+private:
+    intptr_t    m_fd;      // SOCKET on Windows
+    std::string m_path;    // of a listener
+};
@@ -0,0 +1,128 @@
+/*
+// Read-only memory mapping of a file
+*/
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() :
+    m_data(0),
+    m_size(0),
+#ifdef _WIN32
+    m_file(INVALID_HANDLE_VALUE),
+    m_mapping(0)
+#else
+    m_fd(-1)
+#endif
+{}
+
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+
+#ifdef _WIN32
+
+void MappedFile::open(const std::string& path)
+{
+    close();
+
+    m_file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (m_file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("can't open " + path);
+
+    LARGE_INTEGER size;
+    if (!::GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+    {
+        close();
+        throw std::runtime_error("can't map empty file " + path);
+    }
+
+    m_mapping = ::CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!m_mapping)
+    {
+        close();
+        throw std::runtime_error("CreateFileMapping() failed for " + path);
+    }
+
+    m_data = (const uchar*)::MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m_data)
+    {
+        close();
+        throw std::runtime_error("MapViewOfFile() failed for " + path);
+    }
+    m_size = (size_t)size.QuadPart;
+}
+
+
+void MappedFile::close()
+{
+    if (m_data)
+        ::UnmapViewOfFile(m_data);
+    if (m_mapping)
+        ::CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE)
+        ::CloseHandle(m_file);
+
+    m_data    = 0;
+    m_size    = 0;
+    m_mapping = 0;
+    m_file    = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+void MappedFile::open(const std::string& path)
+{
+    close();
+
+    m_fd = ::open(path.c_str(), O_RDONLY);
+    if (m_fd < 0)
+        throw std::runtime_error("can't open " + path);
+
+    struct stat st;
+    if (::fstat(m_fd, &st) != 0 || st.st_size == 0)
+    {
+        close();
+        throw std::runtime_error("can't map empty file " + path);
+    }
+
+    void* p = ::mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (p == MAP_FAILED)
+    {
+        close();
+        throw std::runtime_error("mmap() failed for " + path);
+    }
+    ::madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    m_data = (const uchar*)p;
+    m_size = (size_t)st.st_size;
+}
+
+
+void MappedFile::close()
+{
+    if (m_data)
+        ::munmap((void*)m_data, m_size);
+    if (m_fd >= 0)
+        ::close(m_fd);
+
+    m_data = 0;
+    m_size = 0;
+    m_fd   = -1;
+}
+
+#endif
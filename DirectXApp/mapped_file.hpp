@@ -0,0 +1,36 @@
+/*
+// Read-only memory mapping of a file
+*/
+#pragma once
+
+#include <string>
+
+#include "opencv2/core.hpp"
+
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // map the whole file read-only; throws std::runtime_error on failure
+    void open(const std::string& path);
+    void close();
+
+    bool is_open() const { return m_data != 0; }
+    const uchar* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const uchar* m_data;
+    size_t       m_size;
+#ifdef _WIN32
+    void*        m_file;
+    void*        m_mapping;
+#else
+    int          m_fd;
+#endif
+};
@@ -0,0 +1,91 @@
+/*
+// Background model read and compile, with a readiness barrier
+*/
+#include "model_loader.hpp"
+
+#include <chrono>
+
+std::shared_ptr<ov::Model> prepare_host_input(const std::shared_ptr<ov::Model>& model, cv::Size input_size,
+                                              size_t batch)
+{
+    ov::preprocess::PrePostProcessor ppp(model);
+    ppp.input()
+        .tensor()
+        .set_layout("NHWC")
+        .set_element_type(ov::element::u8)
+        .set_shape({ 1, input_size.height, input_size.width, 3 });
+
+    ppp.input().preprocess()
+        .convert_layout("NCHW")
+        .resize(ov::preprocess::ResizeAlgorithm::RESIZE_LINEAR)
+        .convert_element_type(ov::element::f32);
+
+    ppp.input().model().set_layout("NCHW");
+
+    ppp.output().tensor()
+        .set_element_type(ov::element::f32);
+
+    std::shared_ptr<ov::Model> prepared = ppp.build();
+    if (batch != 1)
+        ov::set_batch(prepared, (int64_t)batch);
+    return prepared;
+}
+
+
+ModelLoader::ModelLoader(const std::string& path, const std::string& device, const PrepareFn& prepare,
+                         const ov::AnyMap& config, StartupReport* report) :
+    m_path(path),
+    m_report(report),
+    m_read_ms(0),
+    m_compile_ms(0)
+{
+    m_future = std::async(std::launch::async, &ModelLoader::load, this, device, prepare, config).share();
+}
+
+
+ModelLoader::~ModelLoader()
+{
+    if (m_future.valid())
+        m_future.wait();
+}
+
+
+ov::CompiledModel ModelLoader::load(const std::string& device, const PrepareFn& prepare, const ov::AnyMap& config)
+{
+    int64 t0 = cv::getTickCount();
+    if (m_report)
+        m_report->begin("model read");
+
+    ov::Core core;
+    std::shared_ptr<ov::Model> model = core.read_model(m_path);
+    if (prepare)
+        model = prepare(model);
+
+    m_read_ms = (cv::getTickCount() - t0) * 1000. / cv::getTickFrequency();
+    if (m_report)
+    {
+        m_report->end("model read");
+        m_report->begin("model compile on " + device);
+    }
+
+    t0 = cv::getTickCount();
+    ov::CompiledModel compiled = core.compile_model(model, device, config);
+
+    m_compile_ms = (cv::getTickCount() - t0) * 1000. / cv::getTickFrequency();
+    if (m_report)
+        m_report->end("model compile on " + device);
+
+    return compiled;
+}
+
+
+bool ModelLoader::ready() const
+{
+    return m_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+
+ov::CompiledModel ModelLoader::wait()
+{
+    return m_future.get();
+}
@@ -0,0 +1,55 @@
+/*
+// Background model read and compile, with a readiness barrier
+*/
+#pragma once
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+
+#include "opencv2/core.hpp"
+#include "openvino/openvino.hpp"
+
+#include "startup_report.hpp"
+
+// Attach the host-frame input preprocessing used by Cnn: u8 NHWC RGB frames of
+// `input_size`, converted to the model's f32 NCHW input by the runtime. With batch > 1
+// the input takes that many frames at once.
+std::shared_ptr<ov::Model> prepare_host_input(const std::shared_ptr<ov::Model>& model, cv::Size input_size,
+                                              size_t batch = 1);
+
+// Reads and compiles a model on a background thread, starting at construction, so the
+// work overlaps with window, device and capture setup. Frames can be processed without
+// the network until ready() turns true; wait() is the barrier before the first inference.
+class ModelLoader
+{
+public:
+    // turns the model as read from disk into the one to compile (e.g. prepare_host_input)
+    typedef std::function<std::shared_ptr<ov::Model>(const std::shared_ptr<ov::Model>&)> PrepareFn;
+
+    ModelLoader(const std::string& path, const std::string& device, const PrepareFn& prepare,
+                const ov::AnyMap& config = ov::AnyMap(), StartupReport* report = 0);
+
+    // waits for the background work, which can't be cancelled
+    ~ModelLoader();
+
+    // true once the model is compiled or loading failed; never blocks
+    bool ready() const;
+
+    // block until ready; rethrows a load failure
+    ov::CompiledModel wait();
+
+    const std::string& path() const { return m_path; }
+    double read_ms() const { return m_read_ms; }
+    double compile_ms() const { return m_compile_ms; }
+
+private:
+    ov::CompiledModel load(const std::string& device, const PrepareFn& prepare, const ov::AnyMap& config);
+
+    std::string                          m_path;
+    StartupReport*                       m_report;
+    double                               m_read_ms;
+    double                               m_compile_ms;
+    std::shared_future<ov::CompiledModel> m_future;
+};
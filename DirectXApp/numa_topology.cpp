@@ -0,0 +1,289 @@
+/*
+// NUMA nodes of the machine, thread pinning and node-local memory
+*/
+#include "numa_topology.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+#ifndef _WIN32
+
+// "0-7,16-23" as written by the kernel, for cores and nodes alike
+std::vector<int> parse_cpu_list(const std::string& list)
+{
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ','))
+    {
+        int first, last;
+        const int n = sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (n < 1)
+            continue;
+        if (n == 1)
+            last = first;
+        for (int cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+const int MPOL_PREFERRED_ = 1;   // <numaif.h> comes with libnuma, the syscall doesn't need it
+
+#endif
+
+class NumaAllocator : public cv::MatAllocator
+{
+public:
+    explicit NumaAllocator(int node) : m_node(node) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data0, size_t* step,
+                           cv::AccessFlag, cv::UMatUsageFlags) const
+    {
+        // same layout as OpenCV's own allocator
+        size_t total = CV_ELEM_SIZE(type);
+        for (int i = dims - 1; i >= 0; i--)
+        {
+            if (step)
+            {
+                if (data0 && step[i] != cv::Mat::AUTO_STEP)
+                {
+                    CV_Assert(total <= step[i]);
+                    total = step[i];
+                }
+                else
+                {
+                    step[i] = total;
+                }
+            }
+            total *= sizes[i];
+        }
+
+        uchar* data = data0 ? (uchar*)data0 : (uchar*)map(total);
+        if (!data)
+            throw std::bad_alloc();
+
+        cv::UMatData* u = new cv::UMatData(this);
+        u->data = u->origdata = data;
+        u->size = total;
+        if (data0)
+            u->flags |= cv::UMatData::USER_ALLOCATED;
+        return u;
+    }
+
+    bool allocate(cv::UMatData* u, cv::AccessFlag, cv::UMatUsageFlags) const
+    {
+        return u != 0;
+    }
+
+    void deallocate(cv::UMatData* u) const
+    {
+        if (!u)
+            return;
+
+        CV_Assert(u->urefcount == 0 && u->refcount == 0);
+        if (!(u->flags & cv::UMatData::USER_ALLOCATED))
+            unmap(u->origdata, u->size);
+        delete u;
+    }
+
+private:
+    void* map(size_t bytes) const
+    {
+        bytes = std::max<size_t>(bytes, 1);
+#ifdef _WIN32
+        return ::VirtualAllocExNuma(::GetCurrentProcess(), NULL, bytes, MEM_RESERVE | MEM_COMMIT,
+                                    PAGE_READWRITE, (DWORD)m_node);
+#else
+        void* p = ::mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            return 0;
+
+        // a failed bind leaves the default policy, the memory is still good
+        unsigned long mask[16] = {};
+        if (m_node < (int)(8 * sizeof(mask)))
+        {
+            mask[m_node / (8 * sizeof(mask[0]))] |= 1UL << (m_node % (8 * sizeof(mask[0])));
+            ::syscall(SYS_mbind, p, bytes, MPOL_PREFERRED_, mask, 8 * sizeof(mask) + 1, 0);
+        }
+        return p;
+#endif
+    }
+
+    void unmap(void* p, size_t bytes) const
+    {
+#ifdef _WIN32
+        (void)bytes;
+        ::VirtualFree(p, 0, MEM_RELEASE);
+#else
+        ::munmap(p, std::max<size_t>(bytes, 1));
+#endif
+    }
+
+    int m_node;
+};
+
+} // namespace
+
+
+NumaTopology::NumaTopology()
+{
+#ifdef _WIN32
+    ULONG highest = 0;
+    if (::GetNumaHighestNodeNumber(&highest))
+    {
+        for (USHORT node = 0; node <= highest; node++)
+        {
+            GROUP_AFFINITY affinity = {};
+            if (!::GetNumaNodeProcessorMaskEx(node, &affinity) || affinity.Group != 0 || !affinity.Mask)
+                continue;
+
+            NumaNode n;
+            n.id = node;
+            for (int i = 0; i < (int)(8 * sizeof(affinity.Mask)); i++)
+                if (affinity.Mask & ((KAFFINITY)1 << i))
+                    n.cpus.push_back(i);
+            m_nodes.push_back(n);
+        }
+    }
+#else
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string ids;
+    if (online && std::getline(online, ids))
+    {
+        const std::vector<int> nodes = parse_cpu_list(ids);
+        for (size_t i = 0; i < nodes.size(); i++)
+        {
+            std::ifstream file(cv::format("/sys/devices/system/node/node%d/cpulist", nodes[i]));
+            std::string list;
+            if (!file || !std::getline(file, list))
+                continue;
+
+            NumaNode n;
+            n.id   = nodes[i];
+            n.cpus = parse_cpu_list(list);
+            if (!n.cpus.empty())   // memory-only nodes have no cores to pin to
+                m_nodes.push_back(n);
+        }
+    }
+#endif
+
+    if (m_nodes.empty())
+    {
+        NumaNode n;
+        n.id = 0;
+        for (int i = 0; i < cv::getNumberOfCPUs(); i++)
+            n.cpus.push_back(i);
+        m_nodes.push_back(n);
+    }
+}
+
+
+const NumaTopology& NumaTopology::system()
+{
+    static const NumaTopology topology;
+    return topology;
+}
+
+
+int NumaTopology::node_of_cpu(int cpu) const
+{
+    for (size_t i = 0; i < m_nodes.size(); i++)
+        if (std::find(m_nodes[i].cpus.begin(), m_nodes[i].cpus.end(), cpu) != m_nodes[i].cpus.end())
+            return m_nodes[i].id;
+    return -1;
+}
+
+
+int NumaTopology::current_node() const
+{
+#ifdef _WIN32
+    return node_of_cpu((int)::GetCurrentProcessorNumber());
+#else
+    const int cpu = ::sched_getcpu();
+    return cpu < 0 ? -1 : node_of_cpu(cpu);
+#endif
+}
+
+
+void NumaTopology::print(std::ostream& out) const
+{
+    out << "[numa] " << m_nodes.size() << " node(s):";
+    for (size_t i = 0; i < m_nodes.size(); i++)
+        out << (i ? ", " : " ") << "node " << m_nodes[i].id << " cores " << cpu_list(m_nodes[i].cpus);
+    out << std::endl;
+}
+
+
+void pin_current_thread(const std::vector<int>& cpus)
+{
+    if (cpus.empty())
+        return;
+
+#ifdef _WIN32
+    DWORD_PTR mask = 0;
+    for (size_t i = 0; i < cpus.size(); i++)
+        if (cpus[i] < (int)(8 * sizeof(mask)))
+            mask |= (DWORD_PTR)1 << cpus[i];
+    if (mask)
+        ::SetThreadAffinityMask(::GetCurrentThread(), mask);
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < cpus.size(); i++)
+        if (cpus[i] < CPU_SETSIZE)
+            CPU_SET(cpus[i], &set);
+    ::sched_setaffinity(0, sizeof(set), &set);
+#endif
+}
+
+
+std::string cpu_list(const std::vector<int>& cpus)
+{
+    std::string list;
+    for (size_t i = 0; i < cpus.size();)
+    {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+            j++;
+
+        if (!list.empty())
+            list += ",";
+        list += j > i ? cv::format("%d-%d", cpus[i], cpus[j]) : cv::format("%d", cpus[i]);
+        i = j + 1;
+    }
+    return list;
+}
+
+
+cv::MatAllocator* numa_allocator(int node)
+{
+    // never freed: static Mats may release their memory after static destructors ran
+    static std::mutex mutex;
+    static std::map<int, NumaAllocator*>* allocators = new std::map<int, NumaAllocator*>();
+
+    CV_Assert(node >= 0);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    NumaAllocator*& allocator = (*allocators)[node];
+    if (!allocator)
+        allocator = new NumaAllocator(node);
+    return allocator;
+}
@@ -0,0 +1,54 @@
+/*
+// NUMA nodes of the machine, thread pinning and node-local memory
+*/
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "opencv2/core.hpp"
+
+struct NumaNode
+{
+    int              id;
+    std::vector<int> cpus;   // logical cores
+};
+
+// Nodes as the OS reports them: /sys/devices/system/node on Linux, the processor group 0
+// masks on Windows. A machine without NUMA, or an OS that doesn't say, is one node with
+// every core.
+class NumaTopology
+{
+public:
+    // read once per process
+    static const NumaTopology& system();
+
+    const std::vector<NumaNode>& nodes() const { return m_nodes; }
+    int node_count() const { return (int)m_nodes.size(); }
+
+    // -1 if the core is on no known node
+    int node_of_cpu(int cpu) const;
+
+    // node of the core the calling thread runs on at this moment, -1 if unknown
+    int current_node() const;
+
+    void print(std::ostream& out) const;
+
+private:
+    NumaTopology();
+
+    std::vector<NumaNode> m_nodes;
+};
+
+// bind the calling thread to `cpus`; empty leaves it as it is
+void pin_current_thread(const std::vector<int>& cpus);
+
+// "0-7,16-23"
+std::string cpu_list(const std::vector<int>& cpus);
+
+// Page-granular allocations placed on `node` (VirtualAllocExNuma, mbind with
+// MPOL_PREFERRED): the memory comes from the node while it has free pages, wherever the
+// thread that first touches it runs. Meant for frame-sized buffers; small Mats waste
+// most of a page. The allocator of each node lives for the whole process.
+cv::MatAllocator* numa_allocator(int node);
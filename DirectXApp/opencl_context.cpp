@@ -0,0 +1,90 @@
+/*
+// OpenCL context of OpenCV created on first use, optionally pre-warmed in the background
+*/
+#include "opencl_context.hpp"
+
+#include "opencv2/imgproc.hpp"
+
+LazyOpenCLContext::LazyOpenCLContext(const CreateFn& create, StartupReport* report) :
+    m_create(create),
+    m_report(report),
+    m_initialized(false),
+    m_available(false),
+    m_device_name("No OpenCL device")
+{}
+
+
+LazyOpenCLContext::~LazyOpenCLContext()
+{
+    if (m_prewarm.valid())
+        m_prewarm.wait();
+}
+
+
+cv::ocl::OpenCLExecutionContext LazyOpenCLContext::init(cv::Size frame_size)
+{
+    if (!cv::ocl::haveOpenCL())
+        return cv::ocl::OpenCLExecutionContext();
+
+    if (m_report)
+        m_report->begin("opencl context");
+    m_create();
+    cv::ocl::OpenCLExecutionContext context = cv::ocl::OpenCLExecutionContext::getCurrent();
+    if (m_report)
+        m_report->end("opencl context");
+
+    if (!frame_size.empty() && context.useOpenCL())
+    {
+        // run what the GPU modes run per frame once, so its kernels are built and cached
+        if (m_report)
+            m_report->begin("opencl kernels");
+
+        cv::UMat frame(frame_size, CV_8UC4, cv::Scalar::all(0));
+        cv::UMat mask(frame_size, CV_8UC1, cv::Scalar::all(255));
+        cv::UMat dst(frame_size, CV_8UC4);
+
+        cv::blur(frame, frame, cv::Size(15, 15));
+        frame.copyTo(dst, mask);
+        cv::ocl::finish();
+
+        if (m_report)
+            m_report->end("opencl kernels");
+    }
+
+    return context;
+}
+
+
+void LazyOpenCLContext::prewarm(cv::Size frame_size)
+{
+    if (m_initialized || m_prewarm.valid())
+        return;
+
+    m_prewarm = std::async(std::launch::async, &LazyOpenCLContext::init, this, frame_size).share();
+}
+
+
+bool LazyOpenCLContext::ensure()
+{
+    if (m_initialized)
+        return m_available;
+
+    cv::ocl::OpenCLExecutionContext context;
+    if (m_prewarm.valid())
+    {
+        context = m_prewarm.get();
+        if (!context.empty())
+            context.bind();
+    }
+    else
+    {
+        context = init(cv::Size());
+    }
+
+    m_initialized = true;
+    m_available   = !context.empty() && cv::ocl::useOpenCL();
+    if (m_available)
+        m_device_name = cv::ocl::Context::getDefault().device(0).name();
+
+    return m_available;
+}
@@ -0,0 +1,52 @@
+/*
+// OpenCL context of OpenCV created on first use, optionally pre-warmed in the background
+*/
+#pragma once
+
+#include <functional>
+#include <future>
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/ocl.hpp"
+
+#include "startup_report.hpp"
+
+// Defers OpenCL platform discovery, context creation and kernel compilation until a
+// processing mode needs the UMat path, so runs that stay on the CPU never pay for them.
+// prewarm() does the same work on a background thread ahead of time; ensure() then only
+// binds the finished context to the calling thread.
+class LazyOpenCLContext
+{
+public:
+    // `create` initializes the OpenCL context of OpenCV on the calling thread, e.g. from a
+    // D3D11 device with cv::directx::ocl::initializeContextFromD3D11Device
+    typedef std::function<void()> CreateFn;
+
+    LazyOpenCLContext(const CreateFn& create, StartupReport* report = 0);
+
+    // waits for a running pre-warm
+    ~LazyOpenCLContext();
+
+    // create the context and compile the kernels of the GPU modes for frames of
+    // `frame_size` in the background; no-op once started
+    void prewarm(cv::Size frame_size);
+
+    // create the context (or wait for the pre-warm) and bind it to the calling thread;
+    // false if there is no OpenCL device
+    bool ensure();
+
+    bool initialized() const { return m_initialized; }
+
+    // "No OpenCL device" until initialized or without OpenCL
+    const cv::String& device_name() const { return m_device_name; }
+
+private:
+    cv::ocl::OpenCLExecutionContext init(cv::Size frame_size);
+
+    CreateFn                                          m_create;
+    StartupReport*                                    m_report;
+    bool                                              m_initialized;
+    bool                                              m_available;
+    cv::String                                        m_device_name;
+    std::shared_future<cv::ocl::OpenCLExecutionContext> m_prewarm;
+};
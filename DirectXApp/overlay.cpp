@@ -0,0 +1,184 @@
+/*
+// Cached text overlay for the status lines drawn over each frame
+*/
+#include "overlay.hpp"
+
+#include <algorithm>
+
+#include "opencv2/core/hal/intrin.hpp"
+#include "opencv2/imgproc.hpp"
+
+namespace
+{
+
+const int    FONT        = cv::FONT_HERSHEY_SIMPLEX;
+const double FONT_SCALE  = 0.8;
+const int    THICKNESS   = 2;
+const int    LINE_HEIGHT = 20;
+
+// dst = (src * alpha + dst * (255 - alpha)) / 255, rounded, per byte
+void blend_row(const uchar* src, const uchar* alpha, uchar* dst, int len)
+{
+    int i = 0;
+#if CV_SIMD
+    const cv::v_uint16 v255 = cv::vx_setall_u16(255);
+    const cv::v_uint16 v128 = cv::vx_setall_u16(128);
+    for (; i <= len - cv::v_uint8::nlanes; i += cv::v_uint8::nlanes)
+    {
+        cv::v_uint16 s0, s1, a0, a1, d0, d1;
+        cv::v_expand(cv::vx_load(src + i), s0, s1);
+        cv::v_expand(cv::vx_load(alpha + i), a0, a1);
+        cv::v_expand(cv::vx_load(dst + i), d0, d1);
+
+        cv::v_uint16 x0 = cv::v_mul_wrap(s0, a0) + cv::v_mul_wrap(d0, v255 - a0) + v128;
+        cv::v_uint16 x1 = cv::v_mul_wrap(s1, a1) + cv::v_mul_wrap(d1, v255 - a1) + v128;
+        x0 = (x0 + (x0 >> 8)) >> 8;
+        x1 = (x1 + (x1 >> 8)) >> 8;
+
+        cv::v_store(dst + i, cv::v_pack(x0, x1));
+    }
+#endif
+    for (; i < len; i++)
+    {
+        unsigned x = src[i] * alpha[i] + dst[i] * (255 - alpha[i]) + 128;
+        dst[i] = (uchar)((x + (x >> 8)) >> 8);
+    }
+}
+
+} // namespace
+
+
+TextOverlay::TextOverlay(int nlines, cv::Scalar color, double refresh_interval_ms) :
+    m_lines(nlines),
+    m_color(color),
+    m_refresh_ticks((int64)(refresh_interval_ms * cv::getTickFrequency() / 1000.)),
+    m_last_raster(0),
+    m_dirty(true),
+    m_rasterizations(0),
+    m_upload(false)
+{
+    for (auto& line : m_lines)
+        line.throttled = false;
+}
+
+
+void TextOverlay::set_line(int line, const cv::String& text)
+{
+    CV_Assert(line >= 0 && line < (int)m_lines.size());
+
+    Line& l = m_lines[line];
+    l.pending   = text;
+    l.throttled = false;
+    if (l.text != text)
+        m_dirty = true;
+}
+
+
+void TextOverlay::set_line_throttled(int line, const cv::String& text)
+{
+    CV_Assert(line >= 0 && line < (int)m_lines.size());
+
+    Line& l = m_lines[line];
+    l.pending   = text;
+    l.throttled = true;
+}
+
+
+// pick up pending content; returns true if the sprite was re-rasterized
+bool TextOverlay::update()
+{
+    const int64 now = cv::getTickCount();
+    const bool refresh_due = now - m_last_raster >= m_refresh_ticks;
+
+    bool changed = m_dirty;
+    if (!changed && refresh_due)
+    {
+        for (const auto& l : m_lines)
+        {
+            if (l.throttled && l.text != l.pending)
+            {
+                changed = true;
+                break;
+            }
+        }
+    }
+
+    if (!changed)
+        return false;
+
+    // an urgent change also takes whatever throttled content is pending at that moment
+    for (auto& l : m_lines)
+        l.text = l.pending;
+
+    rasterize();
+
+    m_last_raster = now;
+    m_dirty = false;
+    return true;
+}
+
+
+void TextOverlay::rasterize()
+{
+    int width = 0, baseline = 0;
+    for (const auto& l : m_lines)
+    {
+        if (l.text.empty())
+            continue;
+        cv::Size sz = cv::getTextSize(l.text, FONT, FONT_SCALE, THICKNESS, &baseline);
+        width = std::max(width, sz.width);
+    }
+
+    // cover descenders and stroke thickness below the last baseline
+    const cv::Size size(width + THICKNESS, LINE_HEIGHT * (int)m_lines.size() + baseline + THICKNESS);
+
+    m_sprite.create(size, CV_8UC4);
+    m_mask.create(size, CV_8UC1);
+    m_sprite.setTo(cv::Scalar::all(0));
+    m_mask.setTo(cv::Scalar::all(0));
+
+    for (size_t i = 0; i < m_lines.size(); i++)
+    {
+        const cv::Point org(0, LINE_HEIGHT * (int)(i + 1));
+        cv::putText(m_sprite, m_lines[i].text, org, FONT, FONT_SCALE, m_color, THICKNESS);
+        cv::putText(m_mask, m_lines[i].text, org, FONT, FONT_SCALE, cv::Scalar::all(255), THICKNESS);
+    }
+
+    cv::Mat planes[] = { m_mask, m_mask, m_mask, m_mask };
+    cv::merge(planes, 4, m_alpha);
+
+    m_upload = true;
+    m_rasterizations++;
+}
+
+
+void TextOverlay::compose(cv::Mat& frame)
+{
+    CV_Assert(frame.type() == CV_8UC4);
+
+    update();
+
+    const cv::Rect roi = cv::Rect(0, 0, m_sprite.cols, m_sprite.rows) & cv::Rect(0, 0, frame.cols, frame.rows);
+    for (int y = roi.y; y < roi.y + roi.height; y++)
+        blend_row(m_sprite.ptr(y), m_alpha.ptr(y), frame.ptr(y), roi.width * 4);
+}
+
+
+void TextOverlay::compose(cv::UMat& frame)
+{
+    CV_Assert(frame.type() == CV_8UC4);
+
+    update();
+
+    if (m_upload)
+    {
+        m_sprite.copyTo(m_sprite_u);
+        m_mask.copyTo(m_mask_u);
+        m_upload = false;
+    }
+
+    // text is rasterized without anti-aliasing, so alpha is either 0 or 255 and the
+    // blend reduces to a masked copy, one kernel on the device
+    const cv::Rect roi = cv::Rect(0, 0, m_sprite.cols, m_sprite.rows) & cv::Rect(0, 0, frame.cols, frame.rows);
+    m_sprite_u(roi).copyTo(frame(roi), m_mask_u(roi));
+}
@@ -0,0 +1,62 @@
+/*
+// Cached text overlay for the status lines drawn over each frame
+*/
+#pragma once
+
+#include <vector>
+
+#include "opencv2/core.hpp"
+
+// Status text rendered as a small RGBA sprite that is composited onto the frame.
+//
+// cv::putText only runs when a line's content changes; every other frame just blends
+// the cached sprite onto the top-left corner of the frame. Lines set through
+// set_line_throttled() (e.g. timings that change every frame) are picked up at most
+// once per refresh interval, so they do not force a re-rasterization per frame.
+//
+// Text placement and style match the putText calls used previously: line i has its
+// baseline at (0, 20 * (i + 1)), FONT_HERSHEY_SIMPLEX, scale 0.8, thickness 2.
+class TextOverlay
+{
+public:
+    TextOverlay(int nlines, cv::Scalar color, double refresh_interval_ms = 250.);
+
+    // content changes are rasterized on the next compose()
+    void set_line(int line, const cv::String& text);
+
+    // content changes are rasterized at most once per refresh interval
+    void set_line_throttled(int line, const cv::String& text);
+
+    // blend the overlay onto a CV_8UC4 frame
+    void compose(cv::Mat& frame);
+
+    // GPU variant: the sprite is kept on the device and re-uploaded only when it changes
+    void compose(cv::UMat& frame);
+
+    size_t rasterizations() const { return m_rasterizations; }
+
+private:
+    bool update();
+    void rasterize();
+
+    struct Line
+    {
+        cv::String text;
+        cv::String pending;
+        bool       throttled;
+    };
+
+    std::vector<Line> m_lines;
+    cv::Scalar        m_color;
+    int64             m_refresh_ticks;
+    int64             m_last_raster;
+    bool              m_dirty;
+    size_t            m_rasterizations;
+
+    cv::Mat           m_sprite;   // CV_8UC4 color
+    cv::Mat           m_alpha;    // CV_8UC4, per pixel alpha replicated to all channels
+    cv::Mat           m_mask;     // CV_8UC1 alpha
+    cv::UMat          m_sprite_u;
+    cv::UMat          m_mask_u;
+    bool              m_upload;
+};
@@ -0,0 +1,175 @@
+/*
+// Headless frame pipeline: the CPU processing path of the sample without a window
+*/
+#include "pipeline.hpp"
+
+#include "opencv2/imgproc.hpp"
+
+#include "box_filter.hpp"
+#include "color_convert.hpp"
+
+namespace
+{
+
+QualityController::Config quality_config(const FramePipeline::Config& config)
+{
+    QualityController::Config qc;
+    qc.target_frame_ms = config.target_frame_ms;
+    return qc;
+}
+
+double ms_since(int64 t0)
+{
+    return (cv::getTickCount() - t0) * 1000. / cv::getTickFrequency();
+}
+
+} // namespace
+
+
+void frame_to_rgba(const Frame& frame, cv::Mat& rgba)
+{
+    const cv::Size size = frame.size();
+    rgba.create(size, CV_8UC4);
+    if (frame.format == FRAME_NV12)
+    {
+        convert_NV12_to_RGBA(frame.data.ptr(0), frame.data.step[0],
+                             frame.data.ptr(size.height), frame.data.step[0],
+                             rgba.data, rgba.step[0], size.width, size.height);
+    }
+    else
+    {
+        cv::cvtColor(frame.data, rgba, cv::COLOR_BGR2RGBA);
+    }
+}
+
+
+FramePipeline::FramePipeline(const Config& config, const cv::Ptr<FrameSource>& source, const cv::Ptr<FrameSink>& sink,
+                             const InferFn& infer) :
+    m_config(config),
+    m_source(source),
+    m_sink(sink),
+    m_infer(infer),
+    m_quality(quality_config(config),
+              infer ? QualityController::LEVEL_CNN_FULL : QualityController::LEVEL_BLUR),
+    m_strategy(config.strategy),
+    m_overlay(3, cv::Scalar(0, 0, 200)),
+    m_reuse_valid(false),
+    m_frames(0)
+{
+    CV_Assert(m_source && m_sink);
+
+    // the stages create these in place, so every buffer comes from it
+    if (m_config.allocator)
+    {
+        m_frame.data.allocator = m_config.allocator;
+        m_rgba.allocator       = m_config.allocator;
+        m_inferred.allocator   = m_config.allocator;
+        m_last_output.allocator = m_config.allocator;
+    }
+}
+
+
+bool FramePipeline::step()
+{
+    const QualityController::Level level = m_quality.level();
+
+    int64 t0 = cv::getTickCount();
+    if (!m_source->read(m_frame))
+        return false;
+    m_frame.clear_stages();
+    m_frame.stamp(Frame::STAGE_READ);
+
+    const cv::Size size = m_frame.size();
+    frame_to_rgba(m_frame, m_rgba);
+    m_frame.stamp(Frame::STAGE_CONVERTED);
+    m_quality.report(QualityController::STAGE_CAPTURE, ms_since(t0));
+
+    const bool cnn   = level >= QualityController::LEVEL_CNN_REDUCED && m_infer;
+    const bool reuse = cnn && m_reuse_valid && !m_quality.infer_frame();
+
+    if (!reuse && level >= QualityController::LEVEL_BLUR && m_config.blur_ksize.area() > 1)
+    {
+        t0 = cv::getTickCount();
+        box_blur_rgba(m_rgba, m_config.blur_ksize);
+        m_quality.report(QualityController::STAGE_PROCESS, ms_since(t0));
+    }
+
+    cv::Mat* output = &m_rgba;
+    if (reuse)
+    {
+        t0 = cv::getTickCount();
+        m_last_output.copyTo(m_rgba);
+        m_quality.report(QualityController::STAGE_INFER, ms_since(t0));
+    }
+    else if (cnn)
+    {
+        t0 = cv::getTickCount();
+        if (m_strategy.mode() == InferStrategy::MODE_EVERY_FRAME)
+        {
+            m_infer(m_rgba, m_inferred);
+        }
+        else
+        {
+            // strategies blend and warp outputs, so a network output they can't use
+            // stands for the unstyled frame
+            m_strategy.process(m_rgba, m_inferred, [this](const cv::Mat& input, cv::Mat& out) {
+                m_infer(input, out);
+                if (out.size() != input.size() || out.type() != input.type())
+                    input.copyTo(out);
+            });
+        }
+        m_reuse_valid = false;
+        if (m_inferred.size() == m_rgba.size() && m_inferred.type() == m_rgba.type())
+        {
+            output = &m_inferred;
+
+            // without the overlay, for the frames of LEVEL_CNN_REDUCED that skip the
+            // network; the level never changes without a target
+            if (m_quality.enabled())
+            {
+                m_inferred.copyTo(m_last_output);
+                m_reuse_valid = true;
+            }
+        }
+        m_quality.report(QualityController::STAGE_INFER, ms_since(t0));
+        m_frame.stamp(Frame::STAGE_INFERRED);
+    }
+    else
+    {
+        // the next network frame is no continuation of the last one
+        m_strategy.reset();
+        m_reuse_valid = false;
+    }
+
+    t0 = cv::getTickCount();
+    if (m_config.overlay)
+    {
+        m_overlay.set_line(0, cv::format("source: %dx%d %s", size.width, size.height,
+                                         m_frame.format == FRAME_NV12 ? "NV12" : "BGR"));
+        m_overlay.set_line(1, cv::format("processing: %s", QualityController::level_name(level)));
+        m_overlay.set_line_throttled(2, cv::format("frame: %4.3f msec", m_quality.frame_ms()));
+        m_overlay.compose(*output);
+    }
+    if (m_config.watermark)
+        draw_watermark(*output, m_frame);
+
+    // the sink is the screen of a headless run
+    m_frame.stamp(Frame::STAGE_SINK);
+    m_sink->consume(m_frame, *output);
+    m_frame.stamp(Frame::STAGE_PRESENTED);
+    m_latency.add(m_frame);
+    m_quality.report(QualityController::STAGE_PRESENT, ms_since(t0));
+
+    m_quality.end_frame();
+    m_frames++;
+    return true;
+}
+
+
+size_t FramePipeline::run(size_t max_frames)
+{
+    size_t n = 0;
+    while ((max_frames == 0 || n < max_frames) && step())
+        n++;
+    return n;
+}
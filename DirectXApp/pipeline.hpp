@@ -0,0 +1,96 @@
+/*
+// Headless frame pipeline: the CPU processing path of the sample without a window
+*/
+#pragma once
+
+#include <functional>
+
+#include "opencv2/core.hpp"
+
+#include "frame_latency.hpp"
+#include "frame_source.hpp"
+#include "infer_strategy.hpp"
+#include "overlay.hpp"
+#include "quality_controller.hpp"
+
+// Receives every processed frame. The RGBA image is only valid during the call.
+class FrameSink
+{
+public:
+    virtual ~FrameSink() {}
+
+    virtual void consume(const Frame& frame, const cv::Mat& rgba) = 0;
+};
+
+// discards frames, counting them
+class NullSink : public FrameSink
+{
+public:
+    NullSink() : m_frames(0) {}
+
+    void consume(const Frame&, const cv::Mat&) { m_frames++; }
+
+    size_t frames() const { return m_frames; }
+
+private:
+    size_t m_frames;
+};
+
+// convert a source frame (BGR or NV12) to CV_8UC4 RGBA
+void frame_to_rgba(const Frame& frame, cv::Mat& rgba);
+
+// Runs source -> RGBA conversion -> blur -> inference -> overlay -> sink, one frame per
+// step(), with the same quality gating as the interactive CPU mode. Stage latencies are
+// reported to the pipeline's QualityController, which is disabled unless a frame time
+// target is set.
+class FramePipeline
+{
+public:
+    // infer(rgba, output) runs the network; an output of the input's size and type
+    // replaces the frame, any other output is dropped
+    typedef std::function<void(const cv::Mat&, cv::Mat&)> InferFn;
+
+    struct Config
+    {
+        cv::Size          blur_ksize      = cv::Size(15, 15);
+        bool              overlay         = true;
+        double            target_frame_ms = 0;   // 0 - always process fully
+        cv::MatAllocator* allocator       = 0;   // frame buffers, e.g. a HugePageArena's; 0 - OpenCV's default.
+                                                 // Source frames only if the source fills frame.data
+        bool              watermark       = false;   // draw_watermark() on every frame before the sink
+        InferStrategy::Config strategy;              // how often the network runs on the frames it gets
+    };
+
+    FramePipeline(const Config& config, const cv::Ptr<FrameSource>& source, const cv::Ptr<FrameSink>& sink,
+                  const InferFn& infer = InferFn());
+
+    // process one frame; false at the end of the source
+    bool step();
+
+    // process up to max_frames frames (0 - until the source ends); returns the number processed
+    size_t run(size_t max_frames = 0);
+
+    const QualityController& quality() const { return m_quality; }
+    const InferStrategy& strategy() const { return m_strategy; }
+    size_t frames() const { return m_frames; }
+
+    // capture to sink, stage by stage; the sink stands in for the screen
+    const FrameLatency& latency() const { return m_latency; }
+
+private:
+    Config               m_config;
+    cv::Ptr<FrameSource> m_source;
+    cv::Ptr<FrameSink>   m_sink;
+    InferFn              m_infer;
+    QualityController    m_quality;
+    InferStrategy        m_strategy;
+    TextOverlay          m_overlay;
+
+    Frame                m_frame;
+    cv::Mat              m_rgba;
+    cv::Mat              m_inferred;
+    cv::Mat              m_last_output;   // network output reused at LEVEL_CNN_REDUCED
+    bool                 m_reuse_valid;
+    FrameLatency         m_latency;
+    size_t               m_frames;
+};
@@ -0,0 +1,173 @@
+/*
+// Adaptive quality control: pick the processing level that holds a frame time target
+*/
+#include "quality_controller.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+QualityController::QualityController(const Config& config, Level initial, std::ostream* log) :
+    m_config(config),
+    m_log(log),
+    m_level(initial),
+    m_frame_ema(0),
+    m_ema_valid(false),
+    m_frame(0),
+    m_level_since(0),
+    m_over(0),
+    m_under(0),
+    m_transitions(0),
+    m_since_infer(std::max(config.reduced_interval, 1))
+{
+    for (int s = 0; s < STAGE_COUNT; s++)
+    {
+        m_current[s]   = 0;
+        m_stage_ema[s] = 0;
+    }
+
+    for (auto& e : m_estimate)
+    {
+        e.frame_ms   = 0;
+        e.frame      = -1;
+        e.not_before = 0;
+        e.backoff    = 0;
+    }
+}
+
+
+void QualityController::report(Stage stage, double ms)
+{
+    m_current[stage] += ms;
+}
+
+
+void QualityController::discard_frame()
+{
+    for (int s = 0; s < STAGE_COUNT; s++)
+        m_current[s] = 0;
+}
+
+
+bool QualityController::infer_frame() const
+{
+    if (m_level == LEVEL_CNN_FULL)
+        return true;
+    return m_level == LEVEL_CNN_REDUCED && m_since_infer >= m_config.reduced_interval;
+}
+
+
+QualityController::Level QualityController::end_frame()
+{
+    double frame_ms = 0;
+    for (int s = 0; s < STAGE_COUNT; s++)
+    {
+        frame_ms += m_current[s];
+        m_stage_ema[s] = m_ema_valid ? m_stage_ema[s] + m_config.smoothing * (m_current[s] - m_stage_ema[s]) : m_current[s];
+        m_current[s] = 0;
+    }
+    m_frame_ema = m_ema_valid ? m_frame_ema + m_config.smoothing * (frame_ms - m_frame_ema) : frame_ms;
+    m_ema_valid = true;
+
+    m_estimate[m_level].frame_ms = m_frame_ema;
+    m_estimate[m_level].frame    = m_frame;
+    m_frame++;
+    m_since_infer = infer_frame() ? 1 : std::min(m_since_infer + 1, m_config.reduced_interval);
+
+    if (!enabled())
+        return m_level;
+
+    const double target = m_config.target_frame_ms;
+    if (m_frame_ema > target * (1 + m_config.hysteresis))
+    {
+        m_over++;
+        m_under = 0;
+    }
+    else if (m_frame_ema < target * (1 - m_config.hysteresis))
+    {
+        m_under++;
+        m_over = 0;
+    }
+    else
+    {
+        m_over = m_under = 0;
+    }
+
+    if (m_over >= m_config.downgrade_frames && m_level > LEVEL_PASSTHROUGH)
+    {
+        // leaving a level soon after entering it means the probe failed: wait longer
+        // before the next one (at least until its cost estimate expires), otherwise
+        // reset the backoff
+        Estimate& e = m_estimate[m_level];
+        if (m_frame - m_level_since < m_config.upgrade_frames)
+            e.backoff = std::min(std::max(2 * e.backoff, m_config.estimate_ttl), m_config.max_backoff);
+        else
+            e.backoff = 0;
+        e.not_before = m_frame + e.backoff;
+
+        transition((Level)(m_level - 1), "over target");
+    }
+    else if (m_under >= m_config.upgrade_frames && m_level < LEVEL_CNN_FULL)
+    {
+        const Level up = (Level)(m_level + 1);
+        const Estimate& e = m_estimate[up];
+        const bool fresh = e.frame >= 0 && m_frame - e.frame <= m_config.estimate_ttl;
+
+        if (m_frame >= e.not_before && (!fresh || e.frame_ms <= target))
+            transition(up, "headroom");
+    }
+
+    return m_level;
+}
+
+
+void QualityController::transition(Level to, const char* reason)
+{
+    if (m_log)
+    {
+        char stages[256];
+        snprintf(stages, sizeof(stages), "%s %.1f, %s %.1f, %s %.1f, %s %.1f ms",
+                 stage_name(STAGE_CAPTURE), m_stage_ema[STAGE_CAPTURE],
+                 stage_name(STAGE_PROCESS), m_stage_ema[STAGE_PROCESS],
+                 stage_name(STAGE_INFER),   m_stage_ema[STAGE_INFER],
+                 stage_name(STAGE_PRESENT), m_stage_ema[STAGE_PRESENT]);
+
+        char line[512];
+        snprintf(line, sizeof(line), "[quality] frame %ld: %s -> %s, %s (frame %.1f ms, target %.1f ms; %s)",
+                 m_frame, level_name(m_level), level_name(to), reason,
+                 m_frame_ema, m_config.target_frame_ms, stages);
+        *m_log << line << std::endl;
+    }
+
+    m_level       = to;
+    m_level_since = m_frame;
+    m_over        = 0;
+    m_under       = 0;
+    m_ema_valid   = false;
+    m_transitions++;
+}
+
+
+const char* QualityController::level_name(Level level)
+{
+    switch (level)
+    {
+    case LEVEL_PASSTHROUGH: return "passthrough";
+    case LEVEL_BLUR:        return "blur";
+    case LEVEL_CNN_REDUCED: return "CNN reduced";
+    case LEVEL_CNN_FULL:    return "CNN full";
+    default:                return "unknown";
+    }
+}
+
+
+const char* QualityController::stage_name(Stage stage)
+{
+    switch (stage)
+    {
+    case STAGE_CAPTURE: return "capture";
+    case STAGE_PROCESS: return "process";
+    case STAGE_INFER:   return "infer";
+    case STAGE_PRESENT: return "present";
+    default:            return "unknown";
+    }
+}
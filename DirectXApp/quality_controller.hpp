@@ -0,0 +1,111 @@
+/*
+// Adaptive quality control: pick the processing level that holds a frame time target
+*/
+#pragma once
+
+#include <iostream>
+#include <string>
+
+// Watches per-stage latencies reported for every frame and steps the processing level
+// down when the frame time stays above the target, and back up when there is headroom.
+//
+// The controller has no clock of its own: callers measure stages and report them, so
+// synthetic latencies can be fed in for headless runs. Every transition is logged.
+//
+// Hysteresis:
+//   - downgrade after `downgrade_frames` consecutive frames above target * (1 + hysteresis)
+//   - upgrade after `upgrade_frames` consecutive frames below target * (1 - hysteresis),
+//     and only if the last frame time measured at the higher level (if still fresh) fits
+//     the target
+//   - each fast downgrade out of a level doubles the time before it is probed again
+//
+// LEVEL_CNN_REDUCED runs the network on every `reduced_interval`-th frame only, the
+// frames in between reuse its last output (see infer_frame()). Lowering the resolution
+// instead would save nothing: the network input is fixed and frames are resized to it.
+class QualityController
+{
+public:
+    enum Level
+    {
+        LEVEL_PASSTHROUGH,
+        LEVEL_BLUR,
+        LEVEL_CNN_REDUCED,
+        LEVEL_CNN_FULL,
+        LEVEL_COUNT
+    };
+
+    enum Stage
+    {
+        STAGE_CAPTURE,
+        STAGE_PROCESS,
+        STAGE_INFER,
+        STAGE_PRESENT,
+        STAGE_COUNT
+    };
+
+    struct Config
+    {
+        double target_frame_ms  = 1000. / 30;
+        double hysteresis       = 0.15;
+        int    downgrade_frames = 5;
+        int    upgrade_frames   = 60;
+        double smoothing        = 0.1;   // EMA weight of the newest frame
+        int    estimate_ttl     = 600;   // frames a level's measured cost stays valid
+        int    max_backoff      = 3600;  // frames
+        int    reduced_interval = 2;     // frames per inference at LEVEL_CNN_REDUCED
+    };
+
+    explicit QualityController(const Config& config, Level initial = LEVEL_CNN_FULL, std::ostream* log = &std::cout);
+
+    // true if a frame time target is set; a disabled controller stays at its level
+    bool enabled() const { return m_config.target_frame_ms > 0; }
+
+    void report(Stage stage, double ms);
+
+    // close the current frame; returns the level to use for the next one
+    Level end_frame();
+
+    // drop what was reported for the current frame (e.g. processing was switched off)
+    void discard_frame();
+
+    // whether the network runs on the current frame: always at LEVEL_CNN_FULL, every
+    // reduced_interval-th frame at LEVEL_CNN_REDUCED, never below. A frame it skips
+    // reuses the last network output; callers that have none run the network anyway.
+    bool infer_frame() const;
+
+    Level level() const { return m_level; }
+    double frame_ms() const { return m_frame_ema; }
+    double stage_ms(Stage stage) const { return m_stage_ema[stage]; }
+    size_t transitions() const { return m_transitions; }
+
+    static const char* level_name(Level level);
+    static const char* stage_name(Stage stage);
+
+private:
+    void transition(Level to, const char* reason);
+
+    struct Estimate
+    {
+        double frame_ms;
+        long   frame;       // frame counter when measured, -1 if never
+        long   not_before;  // no upgrade into this level before this frame
+        int    backoff;
+    };
+
+    Config        m_config;
+    std::ostream* m_log;
+    Level         m_level;
+
+    double        m_current[STAGE_COUNT];
+    double        m_stage_ema[STAGE_COUNT];
+    double        m_frame_ema;
+    bool          m_ema_valid;
+
+    long          m_frame;
+    long          m_level_since;
+    int           m_over;
+    int           m_under;
+    size_t        m_transitions;
+    int           m_since_infer;   // frames since the network last ran, by infer_frame()
+    Estimate      m_estimate[LEVEL_COUNT];
+};
@@ -0,0 +1,330 @@
+/*
+// Offline restyling of a video file in parallel segments, one worker process each
+*/
+#include "segment_job.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "opencv2/imgproc.hpp"
+#include "opencv2/videoio.hpp"
+
+#include "child_process.hpp"
+#include "cnn.hpp"
+#include "frame_record.hpp"
+#include "tensor_binding.hpp"
+
+namespace
+{
+
+double ms_since(int64 t0)
+{
+    return (cv::getTickCount() - t0) * 1000. / cv::getTickFrequency();
+}
+
+} // namespace
+
+
+SegmentJob::SegmentJob(const Config& config) :
+    m_config(config),
+    m_frames(0),
+    m_index_ms(0),
+    m_process_ms(0),
+    m_stitch_ms(0)
+{
+    const int cores = std::max(1, cv::getNumberOfCPUs());
+
+    if (m_config.workers <= 0)
+        m_config.workers = std::max(1, cores / 4);
+    if (m_config.infer_threads <= 0)
+        m_config.infer_threads = std::max(1, cores / m_config.workers);
+    if (m_config.work_dir.empty())
+        m_config.work_dir = m_config.output + ".parts";
+    if (m_config.worker_command.empty())
+        m_config.worker_command.push_back(ChildProcess::self_path());
+
+    CV_Assert(m_config.fourcc.size() == 4 && m_config.segments_per_worker > 0);
+}
+
+
+double SegmentJob::fps() const
+{
+    const double ms = m_index_ms + m_process_ms + m_stitch_ms;
+    return ms > 0 ? m_frames * 1000. / ms : 0.;
+}
+
+
+std::string SegmentJob::task_path(size_t segment) const
+{
+    return m_config.work_dir + cv::format("/segment_%04d.yml", (int)segment);
+}
+
+
+std::string SegmentJob::part_path(size_t segment) const
+{
+    return m_config.work_dir + cv::format("/segment_%04d.frames", (int)segment);
+}
+
+
+void SegmentJob::write_task(size_t segment) const
+{
+    const VideoSegment& s = m_segments[segment];
+
+    cv::FileStorage fs(task_path(segment), cv::FileStorage::WRITE);
+    if (!fs.isOpened())
+        throw std::runtime_error("can't write " + task_path(segment));
+
+    fs << "input" << m_config.input;
+    fs << "output" << part_path(segment);
+    fs << "model" << m_config.model;
+    fs << "input_size" << m_config.input_size;
+    fs << "threads" << m_config.infer_threads;
+    fs << "first" << s.first;
+    fs << "count" << s.count;
+    // FileStorage integers are 32 bit
+    fs << "fingerprint" << cv::format("%016llx", (unsigned long long)s.fingerprint);
+}
+
+
+bool SegmentJob::run_segment(size_t segment, std::string& error) const
+{
+    std::vector<std::string> args = m_config.worker_command;
+    args.push_back("--segment_worker=" + task_path(segment));
+
+    int code;
+    try
+    {
+        ChildProcess worker(args);
+        code = worker.wait();
+    }
+    catch (const std::exception& e)
+    {
+        error = e.what();
+        return false;
+    }
+
+    if (code != 0)
+    {
+        error = cv::format("worker exited with %d", code);
+        return false;
+    }
+
+    try
+    {
+        ReplaySource part(part_path(segment), false);
+        if (part.frame_count() != (size_t)m_segments[segment].count)
+        {
+            error = cv::format("%d of %d frames written", (int)part.frame_count(), m_segments[segment].count);
+            return false;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        error = e.what();
+        return false;
+    }
+    return true;
+}
+
+
+void SegmentJob::run(std::ostream& log)
+{
+    int64 t0 = cv::getTickCount();
+    KeyframeIndex index(m_config.input);
+    m_segments = index.segments(m_config.workers * m_config.segments_per_worker);
+    m_frames   = index.frames();
+    m_index_ms = ms_since(t0);
+
+    log << cv::format("[job] %s: %d frames, %d segments on %d workers x %d threads (index %.0f ms)",
+                      m_config.input.c_str(), m_frames, segments(), m_config.workers,
+                      m_config.infer_threads, m_index_ms) << std::endl;
+
+    std::filesystem::create_directories(m_config.work_dir);
+    for (size_t i = 0; i < m_segments.size(); i++)
+        write_task(i);
+
+    // longest first, so a long segment doesn't start last and hold up the job
+    std::vector<size_t> order(m_segments.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return m_segments[a].count > m_segments[b].count; });
+
+    t0 = cv::getTickCount();
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool>   failed(false);
+    std::mutex          log_mutex;
+
+    std::vector<std::thread> slots;
+    for (int w = 0; w < std::min(m_config.workers, segments()); w++)
+    {
+        slots.emplace_back([&]() {
+            for (size_t k = next++; k < order.size() && !failed; k = next++)
+            {
+                const size_t i = order[k];
+                const int64 start = cv::getTickCount();
+
+                std::string error;
+                bool ok = run_segment(i, error);
+                if (!ok)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(log_mutex);
+                        log << cv::format("[job] segment %d (frame %d): %s, retrying", (int)i,
+                                          m_segments[i].first, error.c_str()) << std::endl;
+                    }
+                    ok = run_segment(i, error);
+                }
+
+                std::lock_guard<std::mutex> lock(log_mutex);
+                if (ok)
+                {
+                    log << cv::format("[job] segment %d: frames %d..%d in %.0f ms", (int)i, m_segments[i].first,
+                                      m_segments[i].first + m_segments[i].count - 1, ms_since(start)) << std::endl;
+                }
+                else
+                {
+                    log << cv::format("[job] segment %d (frame %d): %s", (int)i, m_segments[i].first,
+                                      error.c_str()) << std::endl;
+                    failed = true;
+                }
+            }
+        });
+    }
+    for (size_t i = 0; i < slots.size(); i++)
+        slots[i].join();
+
+    m_process_ms = ms_since(t0);
+    if (failed)
+        throw std::runtime_error("segment job failed; parts are kept in " + m_config.work_dir);
+
+    t0 = cv::getTickCount();
+    stitch(index.fps() > 0 ? index.fps() : 30, log);
+    m_stitch_ms = ms_since(t0);
+
+    if (!m_config.keep_parts)
+        std::filesystem::remove_all(m_config.work_dir);
+
+    log << cv::format("[job] %s: %d frames in %.0f ms (process %.0f ms, stitch %.0f ms), %.1f fps",
+                      m_config.output.c_str(), m_frames, m_index_ms + m_process_ms + m_stitch_ms,
+                      m_process_ms, m_stitch_ms, fps()) << std::endl;
+}
+
+
+void SegmentJob::stitch(double fps, std::ostream& log)
+{
+    cv::VideoWriter writer;
+    int written = 0;
+
+    for (size_t i = 0; i < m_segments.size(); i++)
+    {
+        ReplaySource part(part_path(i), false);
+
+        if (!writer.isOpened())
+        {
+            const std::string& c = m_config.fourcc;
+            if (!writer.open(m_config.output, cv::VideoWriter::fourcc(c[0], c[1], c[2], c[3]), fps, part.size()))
+                throw std::runtime_error("can't create " + m_config.output);
+        }
+
+        Frame frame;
+        int n = 0;
+        while (part.read(frame))
+        {
+            writer.write(frame.data);
+            n++;
+        }
+
+        if (n != m_segments[i].count)
+            throw std::runtime_error(cv::format("segment %d: %d of %d frames", (int)i, n, m_segments[i].count));
+        written += n;
+    }
+
+    if (written != m_frames)
+        throw std::runtime_error(cv::format("stitched %d of %d frames", written, m_frames));
+
+    log << cv::format("[job] stitched %d segments", segments()) << std::endl;
+}
+
+
+int run_segment_worker(const std::string& task_file)
+{
+    try
+    {
+        cv::FileStorage fs(task_file, cv::FileStorage::READ);
+        if (!fs.isOpened())
+            throw std::runtime_error("can't read " + task_file);
+
+        std::string input, output, model, fingerprint;
+        cv::Size input_size;
+        int threads = 0, first = 0, count = 0;
+        fs["input"] >> input;
+        fs["output"] >> output;
+        fs["model"] >> model;
+        fs["input_size"] >> input_size;
+        fs["threads"] >> threads;
+        fs["first"] >> first;
+        fs["count"] >> count;
+        fs["fingerprint"] >> fingerprint;
+        const uint64 expected = (uint64)std::stoull(fingerprint, 0, 16);
+
+        // the coordinator divided the cores between the workers
+        cv::setNumThreads(threads);
+
+        cv::VideoCapture cap(input);
+        if (!cap.isOpened())
+            throw std::runtime_error("can't open " + input);
+        if (first > 0 && !cap.set(cv::CAP_PROP_POS_FRAMES, first))
+            throw std::runtime_error(cv::format("can't seek to frame %d", first));
+
+        std::shared_ptr<HostBinding> binding = std::make_shared<HostBinding>("CPU", input_size);
+        Cnn cnn;
+        ov::AnyMap config;
+        config.insert(ov::inference_num_threads(threads));
+        cnn.Init(model, binding, config);
+
+        cv::Ptr<FrameRecorder> recorder;
+        cv::Mat bgr, rgba;
+        Frame frame;
+        const int64 t0 = cv::getTickCount();
+
+        for (int i = 0; i < count; i++)
+        {
+            if (!cap.read(bgr))
+                throw std::runtime_error(cv::format("video ended after %d of %d frames from %d", i, count, first));
+            if (i == 0 && KeyframeIndex::fingerprint(bgr) != expected)
+                throw std::runtime_error(cv::format("seeking to frame %d decoded a different frame", first));
+
+            cv::cvtColor(bgr, rgba, cv::COLOR_BGR2RGBA);
+            binding->set_input(rgba);
+            cnn.Infer();
+            binding->output_bgr(frame.data);
+
+            if (!recorder)
+                recorder = cv::makePtr<FrameRecorder>(output, FRAME_BGR, frame.data.size());
+
+            frame.format       = FRAME_BGR;
+            frame.seq          = (uint64)(first + i);
+            frame.timestamp_us = now_us();
+            recorder->write(frame);
+        }
+        if (recorder)
+            recorder->close();
+
+        std::cout << cv::format("[segment %d+%d] %.1f ms/frame, infer %.1f ms", first, count,
+                                ms_since(t0) / std::max(count, 1), cnn.time_elapsed() / std::max<size_t>(cnn.ncalls(), 1))
+                  << std::endl;
+        return EXIT_SUCCESS;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "segment worker " << task_file << ": " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
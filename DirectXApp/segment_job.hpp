@@ -0,0 +1,79 @@
+/*
+// Offline restyling of a video file in parallel segments, one worker process each
+*/
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "opencv2/core.hpp"
+
+#include "keyframe_index.hpp"
+
+// Coordinates an archive restyling job on the local machine.
+//
+// The input is indexed (KeyframeIndex) and split into segments starting at entry points,
+// a few per worker so uneven segment lengths even out. Up to `workers` processes run at
+// a time, longest segments first; each decodes its segment from its entry point,
+// restyles it with its own Cnn on the CPU and writes the frames losslessly to a part
+// file in `work_dir`. A failed segment is retried once. The parts are then stitched in
+// order into `output`, checking every segment delivered exactly its frame count, so the
+// result has the frames of a sequential run, no more and no fewer.
+//
+// Workers are this executable again unless `worker_command` names another program;
+// the task is passed as "--segment_worker=<task file>", which the program's main()
+// hands to run_segment_worker().
+class SegmentJob
+{
+public:
+    struct Config
+    {
+        std::string input;
+        std::string output;                        // written with cv::VideoWriter
+        std::string fourcc              = "MJPG";
+        std::string model;
+        cv::Size    input_size          = cv::Size(640, 480);
+        int         workers             = 0;       // 0 - one per 4 logical cores
+        int         segments_per_worker = 3;
+        int         infer_threads       = 0;       // per worker; 0 - cores / workers
+        std::string work_dir;                      // empty - output + ".parts"
+        bool        keep_parts          = false;
+        std::vector<std::string> worker_command;   // program and leading arguments
+    };
+
+    explicit SegmentJob(const Config& config);
+
+    // throws std::runtime_error if the input can't be indexed, a segment fails twice or
+    // the stitched output would not be frame exact
+    void run(std::ostream& log);
+
+    int workers() const { return m_config.workers; }
+    int frames() const { return m_frames; }
+    int segments() const { return (int)m_segments.size(); }
+
+    double index_ms() const { return m_index_ms; }
+    double process_ms() const { return m_process_ms; }
+    double stitch_ms() const { return m_stitch_ms; }
+
+    // frames per second of the whole job, indexing and stitching included
+    double fps() const;
+
+private:
+    std::string task_path(size_t segment) const;
+    std::string part_path(size_t segment) const;
+    void write_task(size_t segment) const;
+    bool run_segment(size_t segment, std::string& error) const;
+    void stitch(double fps, std::ostream& log);
+
+    Config                    m_config;
+    std::vector<VideoSegment> m_segments;
+    int                       m_frames;
+    double                    m_index_ms;
+    double                    m_process_ms;
+    double                    m_stitch_ms;
+};
+
+// Body of a worker process: restyle the segment described by `task_file`, as written by
+// SegmentJob. Returns the process exit code.
+int run_segment_worker(const std::string& task_file);
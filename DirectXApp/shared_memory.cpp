@@ -0,0 +1,218 @@
+/*
+// Named shared memory segment, mapped read-write by several processes
+*/
+#include "shared_memory.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SharedMemory::SharedMemory() :
+    m_data(0),
+    m_size(0),
+    m_owner(false)
+#ifdef _WIN32
+    , m_mapping(0)
+#else
+    , m_fd(-1)
+#endif
+{}
+
+
+SharedMemory::~SharedMemory()
+{
+    close();
+}
+
+
+#ifdef _WIN32
+
+void SharedMemory::create(const std::string& name, size_t size)
+{
+    close();
+
+    const unsigned long long sz = size;
+    m_mapping = ::CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                     (DWORD)(sz >> 32), (DWORD)(sz & 0xffffffff), ("Local\\" + name).c_str());
+    if (!m_mapping)
+        throw std::runtime_error("CreateFileMapping() failed for " + name);
+
+    // the segment lives as long as any handle to it, so an existing one is still in use
+    if (::GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        close();
+        throw std::runtime_error("shared memory " + name + " is in use");
+    }
+
+    m_data = (uchar*)::MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!m_data)
+    {
+        close();
+        throw std::runtime_error("MapViewOfFile() failed for " + name);
+    }
+    m_size  = size;
+    m_name  = name;
+    m_owner = true;
+}
+
+
+void SharedMemory::open(const std::string& name)
+{
+    close();
+
+    m_mapping = ::OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, ("Local\\" + name).c_str());
+    if (!m_mapping)
+        throw std::runtime_error("no shared memory " + name);
+
+    m_data = (uchar*)::MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (!m_data)
+    {
+        close();
+        throw std::runtime_error("MapViewOfFile() failed for " + name);
+    }
+
+    // rounded up to pages; the content says how much of it is used
+    MEMORY_BASIC_INFORMATION info;
+    ::VirtualQuery(m_data, &info, sizeof(info));
+    m_size = info.RegionSize;
+    m_name = name;
+}
+
+
+void SharedMemory::close()
+{
+    if (m_data)
+        ::UnmapViewOfFile(m_data);
+    if (m_mapping)
+        ::CloseHandle(m_mapping);
+
+    m_data    = 0;
+    m_size    = 0;
+    m_mapping = 0;
+    m_owner   = false;
+    m_name.clear();
+}
+
+#else
+
+namespace
+{
+
+// the creator holds an exclusive lock on the segment for as long as it is open
+bool owner_alive(const std::string& path)
+{
+    const int fd = ::shm_open(path.c_str(), O_RDWR, 0);
+    if (fd < 0)
+        return false;
+    const bool locked = ::flock(fd, LOCK_EX | LOCK_NB) != 0 && errno == EWOULDBLOCK;
+    ::close(fd);
+    return locked;
+}
+
+} // namespace
+
+
+void SharedMemory::create(const std::string& name, size_t size)
+{
+    close();
+
+    const std::string path = "/" + name;
+
+    int fd = ::shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 && errno == EEXIST)
+    {
+        // a producer that crashed leaves its segment behind; only a live owner still
+        // holds the lock
+        if (owner_alive(path))
+            throw std::runtime_error("shared memory " + name + " is in use");
+        ::shm_unlink(path.c_str());
+        fd = ::shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+    if (fd < 0)
+        throw std::runtime_error("shm_open() failed for " + name);
+
+    if (::flock(fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        ::close(fd);
+        ::shm_unlink(path.c_str());
+        throw std::runtime_error("can't lock shared memory " + name);
+    }
+
+    if (::ftruncate(fd, (off_t)size) != 0)
+    {
+        ::close(fd);
+        ::shm_unlink(path.c_str());
+        throw std::runtime_error("can't size shared memory " + name);
+    }
+
+    void* p = ::mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        ::close(fd);
+        ::shm_unlink(path.c_str());
+        throw std::runtime_error("mmap() failed for " + name);
+    }
+
+    m_data  = (uchar*)p;
+    m_size  = size;
+    m_name  = name;
+    m_owner = true;
+    m_fd    = fd;
+}
+
+
+void SharedMemory::open(const std::string& name)
+{
+    close();
+
+    const int fd = ::shm_open(("/" + name).c_str(), O_RDWR, 0);
+    if (fd < 0)
+        throw std::runtime_error("no shared memory " + name);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("empty shared memory " + name);
+    }
+
+    void* p = ::mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+        throw std::runtime_error("mmap() failed for " + name);
+
+    m_data = (uchar*)p;
+    m_size = (size_t)st.st_size;
+    m_name = name;
+}
+
+
+void SharedMemory::close()
+{
+    if (m_data)
+        ::munmap(m_data, m_size);
+
+    // unlinked before the lock goes, so no other creator takes the name for stale
+    if (m_owner)
+        ::shm_unlink(("/" + m_name).c_str());
+    if (m_fd >= 0)
+        ::close(m_fd);
+
+    m_data  = 0;
+    m_size  = 0;
+    m_owner = false;
+    m_fd    = -1;
+    m_name.clear();
+}
+
+#endif
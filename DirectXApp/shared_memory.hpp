@@ -0,0 +1,48 @@
+/*
+// Named shared memory segment, mapped read-write by several processes
+*/
+#pragma once
+
+#include <string>
+
+#include "opencv2/core.hpp"
+
+// POSIX shared memory object (shm_open) or, on Windows, a pagefile-backed file mapping
+// in the session namespace. The creator owns the name and removes it on close(); other
+// processes keep their mappings until they close them. On POSIX the creator also holds
+// an flock() on the segment while it is open, which tells a segment left by a crashed
+// creator from one still in use.
+class SharedMemory
+{
+public:
+    SharedMemory();
+    ~SharedMemory();
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    // create a zero-filled segment, replacing a stale one of the same name; throws
+    // std::runtime_error on failure, and if a live creator holds the name
+    void create(const std::string& name, size_t size);
+
+    // map an existing segment whole; throws std::runtime_error if there is none
+    void open(const std::string& name);
+
+    void close();
+
+    bool is_open() const { return m_data != 0; }
+    uchar* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    const std::string& name() const { return m_name; }
+
+private:
+    uchar*      m_data;
+    size_t      m_size;
+    std::string m_name;
+    bool        m_owner;
+#ifdef _WIN32
+    void*       m_mapping;
+#else
+    int         m_fd;         // holds the creator's lock
+#endif
+};
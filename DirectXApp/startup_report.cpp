@@ -0,0 +1,109 @@
+/*
+// Startup time breakdown: phases and events relative to process start
+*/
+#include "startup_report.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+StartupReport::StartupReport() :
+    m_t0(cv::getTickCount()),
+    m_main(std::this_thread::get_id())
+{}
+
+
+double StartupReport::elapsed_ms() const
+{
+    return (cv::getTickCount() - m_t0) * 1000. / cv::getTickFrequency();
+}
+
+
+void StartupReport::begin(const std::string& phase)
+{
+    Entry e;
+    e.name       = phase;
+    e.start_ms   = elapsed_ms();
+    e.end_ms     = -1;
+    e.background = std::this_thread::get_id() != m_main;
+    e.event      = false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.push_back(e);
+}
+
+
+void StartupReport::end(const std::string& phase)
+{
+    const double now = elapsed_ms();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = m_entries.size(); i-- > 0; )
+    {
+        if (!m_entries[i].event && m_entries[i].end_ms < 0 && m_entries[i].name == phase)
+        {
+            m_entries[i].end_ms = now;
+            return;
+        }
+    }
+}
+
+
+void StartupReport::mark(const std::string& event)
+{
+    const double now = elapsed_ms();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_entries.size(); i++)
+    {
+        if (m_entries[i].event && m_entries[i].name == event)
+            return;
+    }
+
+    Entry e;
+    e.name       = event;
+    e.start_ms   = now;
+    e.end_ms     = now;
+    e.background = std::this_thread::get_id() != m_main;
+    e.event      = true;
+    m_entries.push_back(e);
+}
+
+
+bool StartupReport::marked(const std::string& event) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_entries.size(); i++)
+    {
+        if (m_entries[i].event && m_entries[i].name == event)
+            return true;
+    }
+    return false;
+}
+
+
+void StartupReport::print(std::ostream& out) const
+{
+    std::vector<Entry> entries;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        entries = m_entries;
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry& a, const Entry& b) { return a.start_ms < b.start_ms; });
+
+    out << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        const Entry& e = entries[i];
+        out << "[startup] " << std::setw(8) << e.start_ms << " ms  ";
+        if (e.event)
+            out << std::setw(13) << "" << e.name;
+        else if (e.end_ms < 0)
+            out << std::setw(9) << "running" << "    " << e.name;
+        else
+            out << std::setw(9) << e.end_ms - e.start_ms << " ms " << e.name;
+        if (e.background)
+            out << " (background)";
+        out << std::endl;
+    }
+}
@@ -0,0 +1,48 @@
+/*
+// Startup time breakdown: phases and events relative to process start
+*/
+#pragma once
+
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "opencv2/core.hpp"
+
+// Collects the start/end times of startup phases (window, device, model compile, ...)
+// and one-off events (first frame, first CNN frame). Phases may be reported from any
+// thread; those not on the thread that created the report are shown as background work.
+class StartupReport
+{
+public:
+    StartupReport();
+
+    void begin(const std::string& phase);
+    void end(const std::string& phase);
+
+    // instant event; only the first occurrence of a name is kept
+    void mark(const std::string& event);
+    bool marked(const std::string& event) const;
+
+    // since construction
+    double elapsed_ms() const;
+
+    void print(std::ostream& out) const;
+
+private:
+    struct Entry
+    {
+        std::string name;
+        double      start_ms;
+        double      end_ms;      // < 0 while running; == start_ms for events
+        bool        background;
+        bool        event;
+    };
+
+    int64              m_t0;
+    std::thread::id    m_main;
+    mutable std::mutex m_mutex;
+    std::vector<Entry> m_entries;
+};
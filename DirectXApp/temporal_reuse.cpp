@@ -0,0 +1,119 @@
+/*
+// Temporal reuse of network output: full inference on keyframes, flow warping in between
+*/
+#include "temporal_reuse.hpp"
+
+#include <algorithm>
+
+#include "opencv2/imgproc.hpp"
+
+TemporalReuse::TemporalReuse(const Config& config) :
+    m_config(config),
+    m_dis(cv::DISOpticalFlow::create(cv::DISOpticalFlow::PRESET_FAST)),
+    m_interval(config.min_interval),
+    m_since_key(0),
+    m_motion(0),
+    m_last_keyframe(false),
+    m_keyframes(0),
+    m_warped(0)
+{}
+
+
+void TemporalReuse::reset()
+{
+    m_key_gray.release();
+    m_key_output.release();
+    m_interval  = m_config.min_interval;
+    m_since_key = 0;
+    m_motion    = 0;
+}
+
+
+void TemporalReuse::to_flow_input(const cv::Mat& frame, cv::Mat& gray) const
+{
+    cv::Mat g;
+    switch (frame.channels())
+    {
+    case 1:  g = frame; break;
+    case 3:  cv::cvtColor(frame, g, cv::COLOR_BGR2GRAY); break;
+    case 4:  cv::cvtColor(frame, g, cv::COLOR_BGRA2GRAY); break;
+    default: CV_Error(cv::Error::StsBadArg, "unsupported number of channels");
+    }
+
+    if (m_config.flow_scale != 1.)
+        cv::resize(g, gray, cv::Size(), m_config.flow_scale, m_config.flow_scale, cv::INTER_AREA);
+    else
+        g.copyTo(gray);
+}
+
+
+void TemporalReuse::process(const cv::Mat& frame, cv::Mat& output, const InferFn& infer)
+{
+    to_flow_input(frame, m_gray);
+
+    bool keyframe = m_key_output.empty() || m_key_gray.size() != m_gray.size();
+
+    if (!keyframe)
+    {
+        if (m_since_key >= m_interval)
+        {
+            // interval done: adapt it to the motion accumulated since the keyframe
+            if (m_motion < m_config.low_motion_px)
+                m_interval = std::min(m_interval + 1, m_config.max_interval);
+            else if (m_motion > m_config.high_motion_px)
+                m_interval = std::max(m_interval / 2, m_config.min_interval);
+            keyframe = true;
+        }
+        else
+        {
+            // flow from the current frame back to the keyframe: frame(p) ~ key(p + flow(p))
+            m_dis->calc(m_gray, m_key_gray, m_flow);
+
+            cv::Mat xy[2], mag;
+            cv::split(m_flow, xy);
+            cv::magnitude(xy[0], xy[1], mag);
+            m_motion = cv::mean(mag)[0] / m_config.flow_scale;
+
+            if (m_motion > m_config.max_motion_px)
+            {
+                m_interval = std::max(m_interval / 2, m_config.min_interval);
+                keyframe = true;
+            }
+        }
+    }
+
+    m_last_keyframe = keyframe;
+
+    if (keyframe)
+    {
+        infer(frame, m_key_output);
+        m_key_output.copyTo(output);
+        std::swap(m_key_gray, m_gray);
+
+        m_since_key = 1;
+        m_motion = 0;
+        m_keyframes++;
+        return;
+    }
+
+    // backward warp of the stylized keyframe, flow scaled to the output resolution
+    const cv::Size size = m_key_output.size();
+    const float sx = (float)size.width / m_flow.cols;
+    const float sy = (float)size.height / m_flow.rows;
+
+    cv::resize(m_flow, m_map, size, 0, 0, cv::INTER_LINEAR);
+    for (int y = 0; y < size.height; y++)
+    {
+        float* p = m_map.ptr<float>(y);
+        for (int x = 0; x < size.width; x++)
+        {
+            p[2 * x]     = x + p[2 * x] * sx;
+            p[2 * x + 1] = y + p[2 * x + 1] * sy;
+        }
+    }
+
+    cv::remap(m_key_output, output, m_map, cv::noArray(), cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+
+    m_since_key++;
+    m_warped++;
+}
@@ -0,0 +1,67 @@
+/*
+// Temporal reuse of network output: full inference on keyframes, flow warping in between
+*/
+#pragma once
+
+#include <functional>
+
+#include "opencv2/core.hpp"
+#include "opencv2/video/tracking.hpp"
+
+// Runs the style network only on keyframes. Frames in between are produced by warping
+// the last stylized keyframe with dense optical flow (DIS, PRESET_FAST) computed from the
+// current input frame back to the keyframe input.
+//
+// The keyframe interval adapts to motion: it grows by one while the mean flow since the
+// keyframe stays under `low_motion_px`, is halved when it exceeds `high_motion_px`, and a
+// keyframe is forced as soon as motion exceeds `max_motion_px`. Motion is measured in
+// pixels at the input frame resolution.
+class TemporalReuse
+{
+public:
+    struct Config
+    {
+        int    min_interval   = 1;
+        int    max_interval   = 8;
+        double low_motion_px  = 1.0;
+        double high_motion_px = 4.0;
+        double max_motion_px  = 12.0;
+        double flow_scale     = 0.5;   // optical flow is computed at this fraction of the input size
+    };
+
+    // infer(input, output) runs the network on an input frame
+    typedef std::function<void(const cv::Mat&, cv::Mat&)> InferFn;
+
+    explicit TemporalReuse(const Config& config);
+
+    // produce the stylized output for `frame`, calling `infer` only on keyframes
+    void process(const cv::Mat& frame, cv::Mat& output, const InferFn& infer);
+
+    // drop the keyframe, e.g. on a scene cut or a resolution change
+    void reset();
+
+    bool   last_was_keyframe() const { return m_last_keyframe; }
+    int    interval() const { return m_interval; }
+    double motion() const { return m_motion; }
+    size_t keyframes() const { return m_keyframes; }
+    size_t warped() const { return m_warped; }
+
+private:
+    void to_flow_input(const cv::Mat& frame, cv::Mat& gray) const;
+
+    Config                       m_config;
+    cv::Ptr<cv::DISOpticalFlow>  m_dis;
+
+    cv::Mat  m_key_gray;     // keyframe input at flow resolution
+    cv::Mat  m_key_output;   // stylized keyframe
+    cv::Mat  m_gray;
+    cv::Mat  m_flow;
+    cv::Mat  m_map;
+
+    int      m_interval;
+    int      m_since_key;
+    double   m_motion;
+    bool     m_last_keyframe;
+    size_t   m_keyframes;
+    size_t   m_warped;
+};
@@ -0,0 +1,188 @@
+/*
+// Input/output tensor bindings of Cnn: where frames come from and results go
+*/
+#include "tensor_binding.hpp"
+
+#include "opencv2/core/ocl.hpp"
+#include "opencv2/imgproc.hpp"
+#include "openvino/runtime/intel_gpu/ocl/ocl.hpp"
+#include "openvino/runtime/intel_gpu/properties.hpp"
+
+#include "huge_page_arena.hpp"
+#include "model_loader.hpp"
+
+namespace
+{
+
+ov::Shape nhwc_shape(cv::Size size, int channels)
+{
+    return { 1, (size_t)size.height, (size_t)size.width, (size_t)channels };
+}
+
+} // namespace
+
+
+HostBinding::HostBinding(const std::string& device, cv::Size input_size, void* output) :
+    m_device(device),
+    m_input_size(input_size),
+    m_output_memory(output),
+    m_arena(0)
+{
+    m_rgb.create(input_size, CV_8UC3);
+}
+
+
+void HostBinding::use_arena(HugePageArena& arena)
+{
+    m_arena = &arena;
+
+    m_rgb.release();
+    m_rgb.allocator     = arena.mat_allocator();
+    m_resized.allocator = arena.mat_allocator();
+    m_rgb.create(m_input_size, CV_8UC3);
+}
+
+
+std::shared_ptr<ov::Model> HostBinding::prepare(const std::shared_ptr<ov::Model>& model) const
+{
+    return prepare_host_input(model, m_input_size);
+}
+
+
+ov::CompiledModel HostBinding::compile(ov::Core& core, const std::shared_ptr<ov::Model>& model, const ov::AnyMap& config)
+{
+    return core.compile_model(model, m_device, config);
+}
+
+
+void HostBinding::bind(ov::CompiledModel& compiled, ov::InferRequest& request)
+{
+    if (m_output_memory)
+        m_output = ov::Tensor(compiled.output().get_element_type(), compiled.output().get_shape(), m_output_memory);
+    else if (m_arena)
+        m_output = ov::Tensor(compiled.output().get_element_type(), compiled.output().get_shape(),
+                              m_arena->tensor_allocator());
+    else
+        m_output = ov::Tensor(compiled.output().get_element_type(), compiled.output().get_shape());
+
+    request.set_input_tensor(ov::Tensor(ov::element::u8, nhwc_shape(m_input_size, 3), m_rgb.data));
+    request.set_output_tensor(m_output);
+}
+
+
+void HostBinding::set_input(const cv::Mat& rgba)
+{
+    CV_Assert(rgba.type() == CV_8UC4);
+
+    if (rgba.size() == m_input_size)
+    {
+        cv::cvtColor(rgba, m_rgb, cv::COLOR_RGBA2RGB);
+    }
+    else
+    {
+        cv::resize(rgba, m_resized, m_input_size, 0, 0, cv::INTER_LINEAR);
+        cv::cvtColor(m_resized, m_rgb, cv::COLOR_RGBA2RGB);
+    }
+}
+
+
+void HostBinding::output_bgr(cv::Mat& bgr) const
+{
+    const ov::Shape shape = m_output.get_shape();
+    CV_Assert(shape.size() == 4 && shape[0] == 1 && shape[1] == 3 &&
+              m_output.get_element_type() == ov::element::f32);
+
+    const int rows = (int)shape[2];
+    const int cols = (int)shape[3];
+    float* data = m_output.data<float>();
+
+    cv::Mat planes[3];
+    for (int c = 0; c < 3; c++)
+        planes[2 - c] = cv::Mat(rows, cols, CV_32F, data + (size_t)c * rows * cols);
+
+    cv::Mat merged;
+    cv::merge(planes, 3, merged);
+    merged.convertTo(bgr, CV_8U);
+}
+
+
+OpenCLBinding::OpenCLBinding(cv::Size input_size) :
+    m_input_size(input_size)
+{}
+
+
+// out of line, where ClContext is complete
+OpenCLBinding::~OpenCLBinding()
+{}
+
+
+std::shared_ptr<ov::Model> OpenCLBinding::prepare(const std::shared_ptr<ov::Model>& model) const
+{
+    ov::preprocess::PrePostProcessor ppp(model);
+    ppp.input()
+        .tensor()
+        .set_layout("NHWC")
+        .set_element_type(ov::element::u8)
+        .set_shape(nhwc_shape(m_input_size, 3))
+        .set_memory_type(ov::intel_gpu::memory_type::buffer);
+
+    ppp.input().preprocess()
+        .convert_layout("NCHW")
+        .resize(ov::preprocess::ResizeAlgorithm::RESIZE_LINEAR)
+        .convert_element_type(ov::element::f32);
+
+    ppp.input().model().set_layout("NCHW");
+
+    ppp.output().tensor()
+        .set_element_type(ov::element::f32);
+
+    return ppp.build();
+}
+
+
+ov::CompiledModel OpenCLBinding::compile(ov::Core& core, const std::shared_ptr<ov::Model>& model, const ov::AnyMap& config)
+{
+    CV_Assert(cv::ocl::useOpenCL());
+
+    cl_context context = (cl_context)cv::ocl::Context::getDefault().ptr();
+    m_context.reset(new ov::intel_gpu::ocl::ClContext(core, context));
+
+    return core.compile_model(model, *m_context, config);
+}
+
+
+void OpenCLBinding::bind(ov::CompiledModel& compiled, ov::InferRequest& request)
+{
+    CV_Assert(m_context);
+
+    const ov::Shape output_shape = compiled.output().get_shape();
+    CV_Assert(compiled.output().get_element_type() == ov::element::f32);
+
+    m_rgb.create(m_input_size, CV_8UC3);
+    m_output.create(1, (int)ov::shape_size(output_shape), CV_32F);
+
+    request.set_input_tensor(m_context->create_tensor(ov::element::u8, nhwc_shape(m_input_size, 3),
+                                                      (cl_mem)m_rgb.handle(cv::ACCESS_RW)));
+    request.set_output_tensor(m_context->create_tensor(ov::element::f32, output_shape,
+                                                       (cl_mem)m_output.handle(cv::ACCESS_RW)));
+}
+
+
+void OpenCLBinding::set_input(const cv::UMat& rgba)
+{
+    CV_Assert(rgba.type() == CV_8UC4 && !m_rgb.empty());
+
+    // same size and type every frame, so m_rgb keeps the buffer the input tensor wraps
+    if (rgba.size() == m_input_size)
+    {
+        cv::cvtColor(rgba, m_rgb, cv::COLOR_RGBA2RGB);
+    }
+    else
+    {
+        cv::resize(rgba, m_resized, m_input_size, 0, 0, cv::INTER_LINEAR);
+        cv::cvtColor(m_resized, m_rgb, cv::COLOR_RGBA2RGB);
+    }
+
+    // the plugin works on its own queue
+    cv::ocl::finish();
+}
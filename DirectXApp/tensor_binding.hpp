@@ -0,0 +1,109 @@
+/*
+// Input/output tensor bindings of Cnn: where frames come from and results go
+*/
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "opencv2/core.hpp"
+#include "openvino/openvino.hpp"
+
+class HugePageArena;
+
+// Connects a network to the memory frames live in. A binding decides the input
+// preprocessing compiled into the model, the device or remote context it compiles for,
+// and creates the request's input and output tensors once; they persist across frames,
+// as does any context they belong to, for as long as the binding exists.
+class TensorBinding
+{
+public:
+    virtual ~TensorBinding() {}
+
+    virtual const char* name() const = 0;
+
+    // size of the frames fed to set_input() of the concrete binding
+    virtual cv::Size input_size() const = 0;
+
+    // attach the input preprocessing for this memory
+    virtual std::shared_ptr<ov::Model> prepare(const std::shared_ptr<ov::Model>& model) const = 0;
+
+    virtual ov::CompiledModel compile(ov::Core& core, const std::shared_ptr<ov::Model>& model,
+                                      const ov::AnyMap& config) = 0;
+
+    // create the persistent tensors and set them on `request`
+    virtual void bind(ov::CompiledModel& compiled, ov::InferRequest& request) = 0;
+};
+
+
+// Host memory on any device, the CPU plugin included: RGBA cv::Mat frames, resized and
+// converted to RGB into the input tensor's buffer; the output is a host tensor.
+class HostBinding : public TensorBinding
+{
+public:
+    // with `output`, the output tensor is placed there (e.g. in shared memory) instead of
+    // in memory of its own; it must hold the compiled model's output
+    HostBinding(const std::string& device, cv::Size input_size, void* output = 0);
+
+    // allocate the input and output tensors from `arena`, which must outlive the binding;
+    // before Cnn::Init
+    void use_arena(HugePageArena& arena);
+
+    const char* name() const { return "host"; }
+    cv::Size input_size() const { return m_input_size; }
+
+    std::shared_ptr<ov::Model> prepare(const std::shared_ptr<ov::Model>& model) const;
+    ov::CompiledModel compile(ov::Core& core, const std::shared_ptr<ov::Model>& model, const ov::AnyMap& config);
+    void bind(ov::CompiledModel& compiled, ov::InferRequest& request);
+
+    // RGBA frame of any size
+    void set_input(const cv::Mat& rgba);
+
+    const ov::Tensor& output() const { return m_output; }
+
+    // output as an 8-bit BGR image: the 1x3xHxW RGB output of the style networks, with
+    // values in [0, 255]
+    void output_bgr(cv::Mat& bgr) const;
+
+private:
+    std::string    m_device;
+    cv::Size       m_input_size;
+    cv::Mat        m_resized;
+    cv::Mat        m_rgb;       // backs the input tensor
+    void*          m_output_memory;
+    HugePageArena* m_arena;
+    ov::Tensor     m_output;
+};
+
+
+namespace ov { namespace intel_gpu { namespace ocl { class ClContext; } } }
+
+// OpenCL buffers in the context of OpenCV's OpenCL module, shared with the GPU plugin:
+// RGBA cv::UMat frames are converted on the device into the input buffer, and the output
+// stays on the device. OpenCV's OpenCL context must be initialized before compile().
+class OpenCLBinding : public TensorBinding
+{
+public:
+    explicit OpenCLBinding(cv::Size input_size);
+    ~OpenCLBinding();
+
+    const char* name() const { return "opencl"; }
+    cv::Size input_size() const { return m_input_size; }
+
+    std::shared_ptr<ov::Model> prepare(const std::shared_ptr<ov::Model>& model) const;
+    ov::CompiledModel compile(ov::Core& core, const std::shared_ptr<ov::Model>& model, const ov::AnyMap& config);
+    void bind(ov::CompiledModel& compiled, ov::InferRequest& request);
+
+    // RGBA frame of any size
+    void set_input(const cv::UMat& rgba);
+
+    // flat f32 buffer holding the output tensor
+    const cv::UMat& output() const { return m_output; }
+
+private:
+    cv::Size                                       m_input_size;
+    std::unique_ptr<ov::intel_gpu::ocl::ClContext> m_context;
+    cv::UMat                                       m_resized;
+    cv::UMat                                       m_rgb;      // backs the input tensor
+    cv::UMat                                       m_output;   // backs the output tensor
+};
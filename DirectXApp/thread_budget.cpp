@@ -0,0 +1,136 @@
+/*
+// One thread budget shared by OpenCV, OpenVINO and the TBB pipeline stages
+*/
+#include "thread_budget.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "opencv2/core.hpp"
+#include "tbb/task_scheduler_observer.h"
+
+#include "numa_topology.hpp"
+
+// pins every thread entering an arena to the arena's cores
+class ThreadBudget::Pinner : public tbb::task_scheduler_observer
+{
+public:
+    Pinner(tbb::task_arena& arena, const std::vector<int>& cpus) :
+        tbb::task_scheduler_observer(arena),
+        m_cpus(cpus)
+    {
+        observe(true);
+    }
+
+    ~Pinner() { observe(false); }
+
+    void on_scheduler_entry(bool) { pin_current_thread(m_cpus); }
+
+private:
+    std::vector<int> m_cpus;
+};
+
+
+ThreadBudget::ThreadBudget(const Config& config) :
+    m_config(config)
+{
+    CV_Assert(config.streams > 0 && config.decode_share >= 0 && config.infer_share >= 0 &&
+              config.decode_share + config.infer_share < 1);
+
+    m_cores  = config.cores > 0 ? config.cores : cv::getNumberOfCPUs();
+    m_decode = std::max(1, (int)std::lround(m_cores * config.decode_share));
+    m_infer  = std::max(config.streams, (int)std::lround(m_cores * config.infer_share));
+
+    // at least one thread per pipeline, even if that overcommits a small machine
+    m_pipeline = std::max(1, (m_cores - m_decode - m_infer) / config.streams);
+
+    const std::vector<NumaNode>& nodes = NumaTopology::system().nodes();
+    const int per_node = (config.streams + (int)nodes.size() - 1) / (int)nodes.size();
+
+    for (int i = 0; i < config.streams; i++)
+    {
+        if (config.numa)
+        {
+            const NumaNode& node = nodes[i / per_node];
+            m_nodes.push_back(node.id);
+            m_cpus.push_back(node.cpus);
+        }
+        else if (config.pin)
+        {
+            const int first = std::max(0, m_cores - (i + 1) * m_pipeline);
+            std::vector<int> cpus;
+            for (int cpu = first; cpu < first + m_pipeline; cpu++)
+                cpus.push_back(cpu);
+            m_cpus.push_back(cpus);
+        }
+
+        m_arenas.push_back(std::unique_ptr<tbb::task_arena>(new tbb::task_arena(m_pipeline)));
+        m_arenas.back()->initialize();
+
+        if (!m_cpus.empty())
+            m_pinners.push_back(std::unique_ptr<Pinner>(new Pinner(*m_arenas.back(), m_cpus.back())));
+    }
+}
+
+
+ThreadBudget::~ThreadBudget()
+{
+    // observers go before their arenas
+    m_pinners.clear();
+    m_arenas.clear();
+}
+
+
+void ThreadBudget::apply_opencv() const
+{
+    cv::setNumThreads(m_decode);
+}
+
+
+ov::AnyMap ThreadBudget::openvino_config() const
+{
+    ov::AnyMap config;
+    config.insert(ov::inference_num_threads(m_infer));
+    config.insert(ov::num_streams(m_config.streams));
+    config.insert(ov::affinity(m_config.numa ? ov::Affinity::NUMA :
+                               m_config.pin  ? ov::Affinity::CORE : ov::Affinity::NONE));
+    return config;
+}
+
+
+tbb::task_arena& ThreadBudget::arena(int stream)
+{
+    CV_Assert(stream >= 0 && stream < (int)m_arenas.size());
+    return *m_arenas[stream];
+}
+
+
+int ThreadBudget::node(int stream) const
+{
+    CV_Assert(stream >= 0 && stream < m_config.streams);
+    return m_config.numa ? m_nodes[stream] : -1;
+}
+
+
+cv::MatAllocator* ThreadBudget::allocator(int stream) const
+{
+    const int n = node(stream);
+    return n >= 0 ? numa_allocator(n) : 0;
+}
+
+
+void ThreadBudget::print(std::ostream& out) const
+{
+    out << "[threads] " << m_cores << " cores, " << m_config.streams << " stream(s): "
+        << "decode " << m_decode << ", inference " << m_infer
+        << ", pipeline " << m_pipeline << " per stream"
+        << (m_config.numa ? ", per NUMA node" : m_config.pin ? ", pinned" : "") << std::endl;
+
+    for (size_t i = 0; i < m_cpus.size(); i++)
+    {
+        out << "[threads]   stream " << i;
+        if (m_config.numa)
+            out << ": node " << m_nodes[i] << ", node-local frames,";
+        out << " cores " << cpu_list(m_cpus[i]) << std::endl;
+    }
+}
@@ -0,0 +1,84 @@
+/*
+// One thread budget shared by OpenCV, OpenVINO and the TBB pipeline stages
+*/
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "opencv2/core.hpp"
+#include "openvino/runtime/properties.hpp"
+#include "tbb/task_arena.h"
+
+// Splits the cores of the machine between the three thread pools that would otherwise
+// each size themselves to all cores:
+//   - decode/convert: OpenCV's parallel backend, process wide (cv::setNumThreads)
+//   - inference:      the OpenVINO CPU plugin, one compiled model serving all pipelines
+//                     with one inference stream per pipeline
+//   - pipeline:       one tbb::task_arena per pipeline for its flow graph stages
+//
+// With `pin`, each pipeline arena's threads are bound to a disjoint range of cores,
+// allocated from the highest core downwards, and OpenVINO pins its stream threads itself
+// (Affinity::CORE, starting from the lowest cores). OpenCV's threads are never pinned.
+//
+// With `numa`, each pipeline is placed on one NUMA node instead: its arena's threads may
+// run on any core of the node, its frame buffers come from the node's memory (allocator())
+// and OpenVINO binds its stream threads per node (Affinity::NUMA). Pipelines are given to
+// nodes in the contiguous blocks the CPU plugin uses for its streams, so with one stream
+// per pipeline the pipeline and the stream serving it share a node. Which stream runs a
+// given request is still up to the plugin.
+class ThreadBudget
+{
+public:
+    struct Config
+    {
+        int    cores        = 0;      // 0 - all logical cores
+        int    streams      = 1;      // pipelines sharing the machine
+        double decode_share = 0.25;
+        double infer_share  = 0.5;    // the rest goes to the pipeline stages
+        bool   pin          = false;
+        bool   numa         = false;  // overrides pin
+    };
+
+    explicit ThreadBudget(const Config& config);
+    ~ThreadBudget();
+
+    int cores() const { return m_cores; }
+    int streams() const { return m_config.streams; }
+    int decode_threads() const { return m_decode; }
+    int infer_threads() const { return m_infer; }          // all streams together
+    int pipeline_threads() const { return m_pipeline; }    // per stream
+
+    // size OpenCV's thread pool; process wide, so call once
+    void apply_opencv() const;
+
+    // CPU plugin properties for the model shared by all streams
+    ov::AnyMap openvino_config() const;
+
+    // arena for the flow graph of pipeline `stream`: budget.arena(i).execute([&] { ... })
+    tbb::task_arena& arena(int stream);
+
+    // NUMA node of pipeline `stream`, -1 without numa
+    int node(int stream) const;
+
+    // for the frame buffers of pipeline `stream`: node-local with numa, else 0 (OpenCV's default)
+    cv::MatAllocator* allocator(int stream) const;
+
+    void print(std::ostream& out) const;
+
+private:
+    class Pinner;
+
+    Config m_config;
+    int    m_cores;
+    int    m_decode;
+    int    m_infer;
+    int    m_pipeline;
+
+    std::vector<int>              m_nodes;   // per stream, with numa
+    std::vector<std::vector<int> > m_cpus;   // per stream, pinned ones
+
+    std::vector<std::unique_ptr<tbb::task_arena> > m_arenas;
+    std::vector<std::unique_ptr<Pinner> >          m_pinners;
+};
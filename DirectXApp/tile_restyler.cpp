@@ -0,0 +1,229 @@
+/*
+// Incremental restyling: re-run the network only on tiles where the scene changed
+*/
+#include "tile_restyler.hpp"
+
+#include <algorithm>
+
+#include "opencv2/imgproc.hpp"
+
+TileRestyler::TileRestyler(const Config& config) :
+    m_config(config),
+    m_since_full(0),
+    m_frames(0),
+    m_tiles_inferred(0),
+    m_full_frames(0),
+    m_last_ratio(0),
+    m_ratio_sum(0)
+{
+    CV_Assert(config.tile.width > 0 && config.tile.height > 0 && config.mask_scale > 0);
+    CV_Assert(config.network_input.empty() ||
+              (config.tile.width <= config.network_input.width - 2 * config.halo &&
+               config.tile.height <= config.network_input.height - 2 * config.halo));
+    reset();
+}
+
+
+void TileRestyler::reset()
+{
+    if (m_config.use_knn)
+        m_bgsub = cv::createBackgroundSubtractorKNN();
+    else
+        m_bgsub = cv::createBackgroundSubtractorMOG2();
+
+    m_output.release();
+    m_prev_fg.clear();
+    m_since_full = 0;
+}
+
+
+void TileRestyler::full_frame(const cv::Mat& frame, const InferFn& infer)
+{
+    m_input_size = frame.size();
+    m_grid = cv::Size((frame.cols + m_config.tile.width - 1) / m_config.tile.width,
+                      (frame.rows + m_config.tile.height - 1) / m_config.tile.height);
+
+    if (windowed(frame))
+    {
+        m_output.release();
+        infer_windows(frame, std::vector<uchar>((size_t)m_grid.area(), 1), infer);
+    }
+    else
+    {
+        infer(frame, m_output);
+    }
+
+    m_since_full = 0;
+    m_full_frames++;
+}
+
+
+bool TileRestyler::windowed(const cv::Mat& frame) const
+{
+    const cv::Size& input = m_config.network_input;
+    return !input.empty() && frame.cols >= input.width && frame.rows >= input.height;
+}
+
+
+// Each window takes the first dirty tile not yet stylized as its top left interior tile
+// and covers as many tiles right and down as fit in the input less the halo. The crop
+// around the interior is exactly network_input, shifted inside the frame at its edges.
+void TileRestyler::infer_windows(const cv::Mat& frame, const std::vector<uchar>& dirty, const InferFn& infer)
+{
+    const cv::Size input = m_config.network_input;
+    const cv::Size tile  = m_config.tile;
+    const int h = m_config.halo;
+    const int cols = (input.width - 2 * h) / tile.width;
+    const int rows = (input.height - 2 * h) / tile.height;
+
+    std::vector<uchar> todo(dirty);
+    for (int r = 0; r < m_grid.height; r++)
+    {
+        for (int c = 0; c < m_grid.width; c++)
+        {
+            if (!todo[(size_t)r * m_grid.width + c])
+                continue;
+
+            const int c1 = std::min(c + cols, m_grid.width), r1 = std::min(r + rows, m_grid.height);
+            for (int y = r; y < r1; y++)
+                std::fill(todo.begin() + (size_t)y * m_grid.width + c, todo.begin() + (size_t)y * m_grid.width + c1, 0);
+
+            const cv::Rect interior = cv::Rect(c * tile.width, r * tile.height, (c1 - c) * tile.width, (r1 - r) * tile.height) &
+                                      cv::Rect(0, 0, frame.cols, frame.rows);
+            const cv::Rect crop(std::min(std::max(interior.x - h, 0), frame.cols - input.width),
+                                std::min(std::max(interior.y - h, 0), frame.rows - input.height),
+                                input.width, input.height);
+
+            infer(frame(crop), m_tile_out);
+            if (m_tile_out.size() != crop.size())
+                cv::resize(m_tile_out, m_tile_out, crop.size());
+
+            if (m_output.empty())
+                m_output.create(frame.size(), m_tile_out.type());
+            m_tile_out(interior - crop.tl()).copyTo(m_output(interior));
+        }
+    }
+}
+
+
+// horizontal runs of dirty tiles, each cropped with the halo at any size
+void TileRestyler::infer_runs(const cv::Mat& frame, const std::vector<uchar>& dirty, const InferFn& infer)
+{
+    const cv::Rect frame_rect(0, 0, frame.cols, frame.rows);
+    const cv::Rect output_rect(0, 0, m_output.cols, m_output.rows);
+    const double sx = (double)m_output.cols / frame.cols;
+    const double sy = (double)m_output.rows / frame.rows;
+
+    for (int r = 0; r < m_grid.height; r++)
+    {
+        for (int c = 0; c < m_grid.width;)
+        {
+            if (!dirty[(size_t)r * m_grid.width + c])
+            {
+                c++;
+                continue;
+            }
+
+            const int start = c;
+            while (c < m_grid.width && dirty[(size_t)r * m_grid.width + c])
+                c++;
+
+            const cv::Rect run = cv::Rect(start * m_config.tile.width, r * m_config.tile.height,
+                                          (c - start) * m_config.tile.width, m_config.tile.height) & frame_rect;
+            const int h = m_config.halo;
+            const cv::Rect crop = cv::Rect(run.x - h, run.y - h, run.width + 2 * h, run.height + 2 * h) & frame_rect;
+
+            infer(frame(crop), m_tile_out);
+
+            const cv::Size expected(cvRound(crop.width * sx), cvRound(crop.height * sy));
+            if (m_tile_out.size() != expected)
+                cv::resize(m_tile_out, m_tile_out, expected);
+
+            cv::Rect dst(cvRound(run.x * sx), cvRound(run.y * sy), cvRound(run.width * sx), cvRound(run.height * sy));
+            dst &= output_rect;
+            const cv::Rect src = cv::Rect(cvRound((run.x - crop.x) * sx), cvRound((run.y - crop.y) * sy), dst.width, dst.height) &
+                                 cv::Rect(0, 0, m_tile_out.cols, m_tile_out.rows);
+
+            m_tile_out(src).copyTo(m_output(cv::Rect(dst.x, dst.y, src.width, src.height)));
+        }
+    }
+}
+
+
+// foreground tiles of this frame or the previous one
+void TileRestyler::dirty_tiles(const cv::Mat& frame, std::vector<uchar>& dirty)
+{
+    const double s = m_config.mask_scale;
+    if (s != 1.)
+        cv::resize(frame, m_small, cv::Size(), s, s, cv::INTER_AREA);
+    else
+        m_small = frame;
+
+    // MOG2/KNN mark shadows with 127: only solid foreground counts
+    m_bgsub->apply(m_small, m_fgmask);
+    cv::threshold(m_fgmask, m_fgmask, 200, 255, cv::THRESH_BINARY);
+
+    const size_t ntiles = (size_t)m_grid.area();
+    if (m_prev_fg.size() != ntiles)
+        m_prev_fg.assign(ntiles, 0);
+    dirty.assign(ntiles, 0);
+
+    const cv::Rect bounds(0, 0, m_fgmask.cols, m_fgmask.rows);
+    for (int r = 0; r < m_grid.height; r++)
+    {
+        for (int c = 0; c < m_grid.width; c++)
+        {
+            const int x0 = cvFloor(c * m_config.tile.width * s),  x1 = cvCeil((c + 1) * m_config.tile.width * s);
+            const int y0 = cvFloor(r * m_config.tile.height * s), y1 = cvCeil((r + 1) * m_config.tile.height * s);
+            const cv::Rect roi = cv::Rect(x0, y0, x1 - x0, y1 - y0) & bounds;
+
+            const size_t t = (size_t)r * m_grid.width + c;
+            uchar fg = 0;
+            if (!roi.empty())
+                fg = cv::countNonZero(m_fgmask(roi)) > m_config.min_foreground * roi.area();
+
+            dirty[t] = fg || m_prev_fg[t];
+            m_prev_fg[t] = fg;
+        }
+    }
+}
+
+
+void TileRestyler::process(const cv::Mat& frame, cv::Mat& output, const InferFn& infer)
+{
+    m_frames++;
+
+    const bool full = m_output.empty() || frame.size() != m_input_size ||
+                      (m_config.refresh_interval > 0 && m_since_full >= (size_t)m_config.refresh_interval);
+    if (full)
+        full_frame(frame, infer);
+
+    // the background model keeps learning on full frames as well
+    std::vector<uchar> dirty;
+    dirty_tiles(frame, dirty);
+
+    if (full)
+    {
+        m_last_ratio = 1.;
+        m_ratio_sum += 1.;
+        m_output.copyTo(output);
+        return;
+    }
+
+    m_since_full++;
+
+    const size_t ndirty = (size_t)std::count(dirty.begin(), dirty.end(), (uchar)1);
+    if (ndirty > 0)
+    {
+        if (windowed(frame))
+            infer_windows(frame, dirty, infer);
+        else
+            infer_runs(frame, dirty, infer);
+    }
+
+    m_tiles_inferred += ndirty;
+    m_last_ratio = (double)ndirty / m_grid.area();
+    m_ratio_sum += m_last_ratio;
+
+    m_output.copyTo(output);
+}
@@ -0,0 +1,85 @@
+/*
+// Incremental restyling: re-run the network only on tiles where the scene changed
+*/
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "opencv2/core.hpp"
+#include "opencv2/video/background_segm.hpp"
+
+// Keeps a stylized copy of the whole frame and refreshes only the tiles that changed.
+//
+// Changed tiles are found with background subtraction (MOG2 or KNN, as in the bgfg_segm
+// sample) on a downscaled frame: a tile is dirty if its foreground fraction in the current
+// or the previous frame exceeds `min_foreground` (the previous frame matters because
+// the area an object moved away from has to be redrawn too). Dirty tiles are merged into
+// horizontal runs, each run is cropped with a `halo` of context, stylized, and its
+// interior composited into the cached output.
+//
+// `infer` must accept inputs of any size (a fully convolutional network) and produce an
+// output at the same scale factor as for the full frame. The first frame, size changes
+// and every `refresh_interval` frames run the network on the full frame.
+//
+// A network with a fixed input, such as the sample's 640x480 one, would see every crop
+// resized to that input, so tiles would be stylized at another scale than the full frame
+// and seams would show. With `network_input` set, every call gets a crop of exactly that
+// size at 1:1 scale instead: dirty tiles are covered by windows whose interior is up to
+// `network_input` less the halo on each side, and full frames are stylized as all tiles
+// through the same windows. The output of a window is resized to the window if the
+// network returns another size. Frames smaller than `network_input` are inferred whole.
+class TileRestyler
+{
+public:
+    struct Config
+    {
+        cv::Size tile             = cv::Size(64, 64);  // in input pixels
+        int      halo             = 16;
+        double   min_foreground   = 0.005;
+        bool     use_knn          = false;
+        double   mask_scale       = 0.5;
+        int      refresh_interval = 300;               // 0 - never
+        cv::Size network_input;                        // fixed input of the network (empty - any size)
+    };
+
+    typedef std::function<void(const cv::Mat&, cv::Mat&)> InferFn;
+
+    explicit TileRestyler(const Config& config);
+
+    void process(const cv::Mat& frame, cv::Mat& output, const InferFn& infer);
+
+    void reset();
+
+    // share of tiles re-stylized in the last frame, 1 for full-frame inference
+    double last_tile_ratio() const { return m_last_ratio; }
+    double mean_tile_ratio() const { return m_frames ? m_ratio_sum / m_frames : 0.; }
+    size_t frames() const { return m_frames; }
+    size_t tiles_inferred() const { return m_tiles_inferred; }
+    size_t full_frames() const { return m_full_frames; }
+
+private:
+    void full_frame(const cv::Mat& frame, const InferFn& infer);
+    bool windowed(const cv::Mat& frame) const;
+    void infer_windows(const cv::Mat& frame, const std::vector<uchar>& dirty, const InferFn& infer);
+    void infer_runs(const cv::Mat& frame, const std::vector<uchar>& dirty, const InferFn& infer);
+    void dirty_tiles(const cv::Mat& frame, std::vector<uchar>& dirty);
+
+    Config                                   m_config;
+    cv::Ptr<cv::BackgroundSubtractor>        m_bgsub;
+
+    cv::Mat              m_output;
+    cv::Size             m_input_size;
+    cv::Size             m_grid;
+    cv::Mat              m_small;
+    cv::Mat              m_fgmask;
+    std::vector<uchar>   m_prev_fg;
+    cv::Mat              m_tile_out;
+
+    size_t               m_since_full;
+    size_t               m_frames;
+    size_t               m_tiles_inferred;
+    size_t               m_full_frames;
+    double               m_last_ratio;
+    double               m_ratio_sum;
+};
@@ -0,0 +1,79 @@
+/*
+// Per-resolution UMat pool: device buffers kept across frames, with allocation counts
+*/
+#include "umat_pool.hpp"
+
+#include "opencv2/core/ocl.hpp"
+
+namespace
+{
+
+cv::BufferPoolController* opencl_buffer_pool()
+{
+    if (!cv::ocl::haveOpenCL())
+        return 0;
+    return cv::ocl::getOpenCLAllocator()->getBufferPoolController();
+}
+
+} // namespace
+
+
+UMatPool::UMatPool(size_t reserve_bytes) :
+    m_reserve_bytes(reserve_bytes),
+    m_created(0),
+    m_reused(0)
+{}
+
+
+cv::UMat& UMatPool::get(int slot, cv::Size size, int type)
+{
+    if (m_reserve_bytes > 0)
+    {
+        cv::BufferPoolController* pool = opencl_buffer_pool();
+        if (pool && m_reserve_bytes > pool->getMaxReservedSize())
+            pool->setMaxReservedSize(m_reserve_bytes);
+        m_reserve_bytes = 0;
+    }
+
+    const Key key(slot, size.width, size.height, type);
+
+    std::map<Key, Entry>::iterator it = m_entries.find(key);
+    if (it == m_entries.end())
+    {
+        Entry e;
+        e.mat.create(size, type);
+        e.data = e.mat.u;
+        m_created++;
+        return m_entries.insert(std::make_pair(key, e)).first->second.mat;
+    }
+
+    Entry& e = it->second;
+
+    // replaced by whoever wrote into it last frame, or resized to something else
+    if (e.mat.u != e.data)
+        m_created++;
+    else
+        m_reused++;
+
+    if (e.mat.size() != size || e.mat.type() != type)
+    {
+        e.mat.create(size, type);
+        m_created++;
+    }
+
+    e.data = e.mat.u;
+    return e.mat;
+}
+
+
+size_t UMatPool::reserved_bytes()
+{
+    cv::BufferPoolController* pool = opencl_buffer_pool();
+    return pool ? pool->getReservedSize() : 0;
+}
+
+
+void UMatPool::clear()
+{
+    m_entries.clear();
+}
@@ -0,0 +1,50 @@
+/*
+// Per-resolution UMat pool: device buffers kept across frames, with allocation counts
+*/
+#pragma once
+
+#include <map>
+#include <tuple>
+
+#include "opencv2/core.hpp"
+
+// Persistent UMats for the stages of the GPU path, keyed by slot, size and type. A frame
+// at a known resolution gets back the buffers of the previous frame, so steady-state
+// frames allocate no device memory; a new resolution gets its own set. Functions that
+// write into a pooled UMat call create() on it, which keeps the buffer when size and type
+// match; a buffer that was replaced anyway is counted on the next get().
+class UMatPool
+{
+public:
+    // `reserve_bytes` > 0 also lets OpenCV's OpenCL allocator keep up to that much of
+    // released device memory for reuse, which covers the temporaries of cv:: functions.
+    // Applied on the first get(), so constructing a pool does not initialize OpenCL.
+    explicit UMatPool(size_t reserve_bytes = 0);
+
+    // buffer of `slot` for frames of `size`; contents are those of the previous frame
+    cv::UMat& get(int slot, cv::Size size, int type);
+
+    // device buffers allocated through the pool, and gets served by an existing one
+    size_t created() const { return m_created; }
+    size_t reused() const { return m_reused; }
+
+    // bytes OpenCV's OpenCL allocator holds for reuse
+    static size_t reserved_bytes();
+
+    // drop all buffers, e.g. after the OpenCL context changed
+    void clear();
+
+private:
+    typedef std::tuple<int, int, int, int> Key;   // slot, width, height, type
+
+    struct Entry
+    {
+        cv::UMat      mat;
+        cv::UMatData* data;   // buffer handed out last time
+    };
+
+    std::map<Key, Entry> m_entries;
+    size_t               m_reserve_bytes;
+    size_t               m_created;
+    size_t               m_reused;
+};
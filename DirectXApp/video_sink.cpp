@@ -0,0 +1,241 @@
+/*
+// Frame sink encoding to a video file on a thread of its own
+*/
+#include "video_sink.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "opencv2/imgproc.hpp"
+
+namespace
+{
+
+double ms_since(int64 t0)
+{
+    return (cv::getTickCount() - t0) * 1000. / cv::getTickFrequency();
+}
+
+} // namespace
+
+
+VideoWriterSink::VideoWriterSink(const Config& config, cv::Size frame_size) :
+    m_config(config),
+    m_size(frame_size),
+    m_closing(false),
+    m_consumed(0),
+    m_written(0),
+    m_dropped(0),
+    m_encode_ms_sum(0),
+    m_encode_ms_max(0),
+    m_blocked_ms(0),
+    m_occupancy_sum(0),
+    m_occupancy_max(0)
+{
+    CV_Assert(m_config.fourcc.size() == 4 && m_config.queue_size > 0);
+
+    const std::string& c = m_config.fourcc;
+    if (!m_writer.open(m_config.path, cv::VideoWriter::fourcc(c[0], c[1], c[2], c[3]), m_config.fps, frame_size))
+        throw std::runtime_error("can't create " + m_config.path);
+
+    // allocated once, recycled for the whole run
+    for (size_t i = 0; i < m_config.queue_size; i++)
+    {
+        m_buffers.push_back(std::unique_ptr<Buffer>(new Buffer));
+        m_buffers.back()->rgba.create(frame_size, CV_8UC4);
+        m_free.push_back(m_buffers.back().get());
+    }
+
+    m_thread = std::thread(&VideoWriterSink::encode, this);
+}
+
+
+VideoWriterSink::~VideoWriterSink()
+{
+    close();
+}
+
+
+void VideoWriterSink::consume(const Frame& frame, const cv::Mat& rgba)
+{
+    CV_Assert(rgba.size() == m_size && rgba.type() == CV_8UC4);
+
+    Buffer* buffer = 0;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_closing)
+        {
+            m_dropped++;
+            return;
+        }
+
+        m_consumed++;
+        m_occupancy_sum += m_queue.size();
+        m_occupancy_max  = std::max(m_occupancy_max, m_queue.size());
+
+        if (m_free.empty())
+        {
+            switch (m_config.backpressure)
+            {
+            case BLOCK:
+            {
+                const int64 t0 = cv::getTickCount();
+                m_freed.wait(lock, [&]() { return !m_free.empty() || m_closing; });
+                m_blocked_ms += ms_since(t0);
+                if (m_closing)
+                {
+                    m_dropped++;
+                    return;
+                }
+                break;
+            }
+            case DROP_OLDEST:
+                // with a single buffer, the one the encoder holds, there is none to take
+                if (!m_queue.empty())
+                {
+                    m_free.push_back(m_queue.front());
+                    m_queue.pop_front();
+                    m_dropped++;
+                    break;
+                }
+                // fall through
+            case DROP_NEWEST:
+                m_dropped++;
+                return;
+            }
+        }
+
+        buffer = m_free.back();
+        m_free.pop_back();
+    }
+
+    // outside the lock: the encoder keeps going meanwhile
+    rgba.copyTo(buffer->rgba);
+    buffer->seq = frame.seq;
+
+    {
+        // close() may have come meanwhile, and the encoder may be gone
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closing)
+        {
+            m_free.push_back(buffer);
+            m_dropped++;
+            return;
+        }
+        m_queue.push_back(buffer);
+    }
+    m_queued.notify_one();
+}
+
+
+void VideoWriterSink::encode()
+{
+    cv::Mat bgr;
+    for (;;)
+    {
+        Buffer* buffer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_queued.wait(lock, [&]() { return !m_queue.empty() || m_closing; });
+            if (m_queue.empty())
+                return;
+            buffer = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        const int64 t0 = cv::getTickCount();
+        cv::cvtColor(buffer->rgba, bgr, cv::COLOR_RGBA2BGR);
+        m_writer.write(bgr);
+        const double ms = ms_since(t0);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_free.push_back(buffer);
+            m_written++;
+            m_encode_ms_sum += ms;
+            m_encode_ms_max  = std::max(m_encode_ms_max, ms);
+        }
+        m_freed.notify_one();
+    }
+}
+
+
+void VideoWriterSink::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closing = true;
+    }
+    m_queued.notify_one();
+    m_freed.notify_all();
+
+    if (m_thread.joinable())
+        m_thread.join();
+    m_writer.release();
+}
+
+
+size_t VideoWriterSink::consumed() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_consumed;
+}
+
+
+size_t VideoWriterSink::written() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_written;
+}
+
+
+size_t VideoWriterSink::dropped() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dropped;
+}
+
+
+double VideoWriterSink::mean_encode_ms() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_written ? m_encode_ms_sum / m_written : 0.;
+}
+
+
+double VideoWriterSink::max_encode_ms() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_encode_ms_max;
+}
+
+
+double VideoWriterSink::blocked_ms() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_blocked_ms;
+}
+
+
+double VideoWriterSink::mean_occupancy() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_consumed ? (double)m_occupancy_sum / m_consumed : 0.;
+}
+
+
+size_t VideoWriterSink::max_occupancy() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_occupancy_max;
+}
+
+
+void VideoWriterSink::print(std::ostream& out) const
+{
+    out << cv::format("[writer] %s: %d of %d frames written, %d dropped; encode %.2f ms mean, %.2f ms max; "
+                      "queue %.1f mean, %d max of %d; blocked %.0f ms",
+                      m_config.path.c_str(), (int)written(), (int)consumed(), (int)dropped(), mean_encode_ms(),
+                      max_encode_ms(), mean_occupancy(), (int)max_occupancy(), (int)m_config.queue_size,
+                      blocked_ms()) << std::endl;
+}
@@ -0,0 +1,105 @@
+/*
+// Frame sink encoding to a video file on a thread of its own
+*/
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "opencv2/core.hpp"
+#include "opencv2/videoio.hpp"
+
+#include "pipeline.hpp"
+
+// Writes processed frames with cv::VideoWriter without holding up the pipeline.
+//
+// consume() copies the RGBA frame into a free buffer of a fixed pool and queues it; the
+// encoder thread converts it to BGR, writes it and returns the buffer to the pool. When
+// every buffer is queued the backpressure policy decides:
+//   BLOCK        wait for the encoder: every frame is written, the caller slows down to
+//                encoding speed
+//   DROP_NEWEST  drop the incoming frame
+//   DROP_OLDEST  drop the oldest queued frame and queue the incoming one in its buffer
+class VideoWriterSink : public FrameSink
+{
+public:
+    enum Backpressure
+    {
+        BLOCK,
+        DROP_NEWEST,
+        DROP_OLDEST
+    };
+
+    struct Config
+    {
+        std::string  path;
+        std::string  fourcc       = "MJPG";
+        double       fps          = 30;
+        size_t       queue_size   = 8;
+        Backpressure backpressure = BLOCK;
+    };
+
+    // throws std::runtime_error if the file can't be created
+    VideoWriterSink(const Config& config, cv::Size frame_size);
+
+    // close()s
+    ~VideoWriterSink();
+
+    void consume(const Frame& frame, const cv::Mat& rgba);
+
+    // encode what is queued and finalize the file; frames consumed later, or still being
+    // copied when it comes, are dropped
+    void close();
+
+    size_t consumed() const;
+    size_t written() const;
+    size_t dropped() const;
+
+    double mean_encode_ms() const;
+    double max_encode_ms() const;
+    double blocked_ms() const;           // consume() waiting for a buffer, BLOCK only
+
+    // queued frames seen by consume(), before queueing its own
+    double mean_occupancy() const;
+    size_t max_occupancy() const;
+
+    void print(std::ostream& out) const;
+
+private:
+    struct Buffer
+    {
+        cv::Mat rgba;
+        uint64  seq;
+    };
+
+    void encode();
+
+    Config                                m_config;
+    cv::Size                              m_size;
+    cv::VideoWriter                       m_writer;
+
+    std::vector<std::unique_ptr<Buffer> > m_buffers;
+    std::vector<Buffer*>                  m_free;
+    std::deque<Buffer*>                   m_queue;
+
+    mutable std::mutex                    m_mutex;
+    std::condition_variable               m_queued;     // encoder waits
+    std::condition_variable               m_freed;      // BLOCK producer waits
+    bool                                  m_closing;
+    std::thread                           m_thread;
+
+    size_t m_consumed;
+    size_t m_written;
+    size_t m_dropped;
+    double m_encode_ms_sum;
+    double m_encode_ms_max;
+    double m_blocked_ms;
+    size_t m_occupancy_sum;
+    size_t m_occupancy_max;
+};